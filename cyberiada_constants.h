@@ -31,6 +31,10 @@
 #define VERTEX_POINT_RADIUS 10
 #define COMMENT_ANGLE_CORNER 10
 
+// Level of detail constants: the view scale below which the details are omitted
+#define LOD_OUTLINE_SCALE 0.35
+#define LOD_TITLES_SCALE  0.7
+
 // Metainformation constants
 #define METAINFORMATION_AUTHOR            "Author"
 #define METAINFORMATION_CONTACT           "Contact"
@@ -53,6 +57,13 @@
 
 #define FORMAL_COMMENT_FONT_SIZE 12
 #define FORMAL_COMMENT_FONT_NAME "Courier"
+#define FORMAL_COMMENT_FONT_FILE ":/Fonts/fonts/courier.ttf"
+
+enum class DetailLevel {
+    Outline,  // the shapes only
+    Titles,   // the shapes and the state titles
+    Full
+};
 
 enum class ToolType {
     Select,
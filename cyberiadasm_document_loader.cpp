@@ -0,0 +1,83 @@
+/* -----------------------------------------------------------------------------
+ * The Cyberiada State Machine Editor
+ * -----------------------------------------------------------------------------
+ * 
+ * The Background Document Loader
+ *
+ * Copyright (C) 2024 Alexey Fedoseev <aleksey@fedoseev.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see https://www.gnu.org/licenses/
+ *
+ * ----------------------------------------------------------------------------- */
+
+#include <QElapsedTimer>
+
+#include "cyberiadasm_document_loader.h"
+
+CyberiadaSMDocumentLoader::CyberiadaSMDocumentLoader(const QString& path, bool _reconstruct, bool _reconstruct_sm,
+                                                     QObject* parent):
+    QThread(parent), filePath(path), reconstruct(_reconstruct), reconstructSM(_reconstruct_sm),
+    document(NULL), parseMsec(0)
+{
+}
+
+CyberiadaSMDocumentLoader::~CyberiadaSMDocumentLoader()
+{
+    wait();
+    if (document) {
+        delete document;
+    }
+}
+
+void CyberiadaSMDocumentLoader::cancel()
+{
+    requestInterruption();
+}
+
+bool CyberiadaSMDocumentLoader::isCanceled() const
+{
+    return isInterruptionRequested();
+}
+
+Cyberiada::LocalDocument* CyberiadaSMDocumentLoader::takeDocument()
+{
+    Cyberiada::LocalDocument* doc = document;
+    document = NULL;
+    return doc;
+}
+
+void CyberiadaSMDocumentLoader::run()
+{
+    Cyberiada::LocalDocument* new_doc = new Cyberiada::LocalDocument();
+
+    QElapsedTimer timer;
+    timer.start();
+    try {
+        new_doc->open(filePath.toStdString(), Cyberiada::formatDetect, Cyberiada::geometryFormatQt,
+                      reconstruct, reconstructSM);
+    } catch (const Cyberiada::XMLException& e) {
+        errorMessage = tr("XML grapml error:\n") + QString(e.str().c_str());
+    } catch (const Cyberiada::CybMLException& e) {
+        errorMessage = tr("Wrong format of the Cyberiada grapml file:\n") + QString(e.str().c_str());
+    } catch (const Cyberiada::Exception& e) {
+        errorMessage = tr("Cannot load state machine graph:\n") + QString(e.str().c_str());
+    }
+    parseMsec = timer.elapsed();
+
+    if (hasError() || isInterruptionRequested()) {
+        delete new_doc;
+        return;
+    }
+    document = new_doc;
+}
@@ -0,0 +1,67 @@
+/* -----------------------------------------------------------------------------
+ * The Cyberiada State Machine Editor
+ * -----------------------------------------------------------------------------
+ * 
+ * The Background Document Loader
+ *
+ * Copyright (C) 2024 Alexey Fedoseev <aleksey@fedoseev.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see https://www.gnu.org/licenses/
+ *
+ * ----------------------------------------------------------------------------- */
+
+#ifndef CYBERIADA_SM_DOCUMENT_LOADER_HEADER
+#define CYBERIADA_SM_DOCUMENT_LOADER_HEADER
+
+#include <QThread>
+#include <QString>
+#include <cyberiada/cyberiadamlpp.h>
+
+// Parses the GraphML document in a worker thread. The parsed document is
+// picked up on the GUI thread with takeDocument() after finished() is emitted.
+// The library cannot interrupt the parser, so cancel() only marks the result
+// to be thrown away once the parsing is over.
+class CyberiadaSMDocumentLoader: public QThread {
+Q_OBJECT
+
+public:
+    CyberiadaSMDocumentLoader(const QString& path, bool reconstruct = false, bool reconstruct_sm = false,
+                              QObject* parent = NULL);
+    ~CyberiadaSMDocumentLoader();
+
+    const QString&            path() const { return filePath; }
+    void                      cancel();
+    bool                      isCanceled() const;
+
+    bool                      hasError() const { return !errorMessage.isEmpty(); }
+    const QString&            error() const { return errorMessage; }
+    // parsing time in milliseconds
+    qint64                    parseTime() const { return parseMsec; }
+
+    // the caller takes the ownership of the document
+    Cyberiada::LocalDocument* takeDocument();
+
+protected:
+    void                      run();
+
+private:
+    QString                   filePath;
+    bool                      reconstruct;
+    bool                      reconstructSM;
+    Cyberiada::LocalDocument* document;
+    QString                   errorMessage;
+    qint64                    parseMsec;
+};
+
+#endif
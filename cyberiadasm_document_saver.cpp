@@ -0,0 +1,149 @@
+/* -----------------------------------------------------------------------------
+ * The Cyberiada State Machine Editor
+ * -----------------------------------------------------------------------------
+ * 
+ * The Background Document Saver
+ *
+ * Copyright (C) 2024 Alexey Fedoseev <aleksey@fedoseev.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see https://www.gnu.org/licenses/
+ *
+ * ----------------------------------------------------------------------------- */
+
+#include <QElapsedTimer>
+#include <QMutexLocker>
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <cstdio>
+
+#ifdef Q_OS_WIN
+#include <windows.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "cyberiadasm_document_saver.h"
+
+CyberiadaSMDocumentSaver::CyberiadaSMDocumentSaver(const Cyberiada::LocalDocument* _source, const QString& path,
+                                                   Cyberiada::DocumentFormat format, bool _round,
+                                                   QObject* parent):
+    QThread(parent), source(_source), snapshot(NULL), snapshotReady(false), snapshotMsec(0),
+    filePath(path), fileFormat(format), round(_round), saveMsec(0)
+{
+}
+
+CyberiadaSMDocumentSaver::~CyberiadaSMDocumentSaver()
+{
+    wait();
+    if (snapshot) {
+        delete snapshot;
+    }
+}
+
+void CyberiadaSMDocumentSaver::waitForSnapshot()
+{
+    QMutexLocker locker(&snapshotMutex);
+    while (!snapshotReady) {
+        snapshotCondition.wait(&snapshotMutex);
+    }
+}
+
+void CyberiadaSMDocumentSaver::run()
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    // the deep copy is made here rather than in the GUI thread
+    try {
+        snapshot = new Cyberiada::LocalDocument(*source);
+    } catch (const Cyberiada::Exception& e) {
+        errorMessage = tr("Cannot copy the document:\n") + QString(e.str().c_str());
+    }
+    {
+        QMutexLocker locker(&snapshotMutex);
+        snapshotReady = true;
+        snapshotMsec = timer.elapsed();
+    }
+    snapshotCondition.wakeAll();
+    if (hasError()) {
+        saveMsec = timer.elapsed();
+        return;
+    }
+
+    // the temporary file is placed in the same directory to keep the rename atomic
+    QFileInfo info(filePath);
+    QString tmp_path = info.absoluteDir().filePath("." + info.fileName() + ".tmp");
+
+    try {
+        snapshot->save_as(tmp_path.toStdString(), fileFormat, round);
+    } catch (const Cyberiada::Exception& e) {
+        errorMessage = tr("Cannot save state machine graph:\n") + QString(e.str().c_str());
+    }
+
+    if (!hasError() && !flushFile(tmp_path)) {
+        errorMessage = tr("Cannot flush the file %1").arg(tmp_path);
+    }
+    if (!hasError() && !replaceFile(tmp_path, filePath)) {
+        errorMessage = tr("Cannot replace the file %1").arg(filePath);
+    }
+    if (hasError()) {
+        QFile::remove(tmp_path);
+    }
+
+    saveMsec = timer.elapsed();
+}
+
+bool CyberiadaSMDocumentSaver::flushFile(const QString& path)
+{
+    // the data must reach the disk before the rename, otherwise the renamed file
+    // may turn out empty after a power loss
+    QFile file(path);
+    if (!file.open(QIODevice::ReadWrite)) {
+        return false;
+    }
+#ifdef Q_OS_WIN
+    return FlushFileBuffers(reinterpret_cast<HANDLE>(_get_osfhandle(file.handle()))) != 0;
+#else
+    return ::fsync(file.handle()) == 0;
+#endif
+}
+
+bool CyberiadaSMDocumentSaver::replaceFile(const QString& from, const QString& to)
+{
+#ifdef Q_OS_WIN
+    // the existing file is replaced in one call, the move is flushed before the return
+    QString from_name = QDir::toNativeSeparators(from);
+    QString to_name = QDir::toNativeSeparators(to);
+    return MoveFileExW(reinterpret_cast<const wchar_t*>(from_name.utf16()),
+                       reinterpret_cast<const wchar_t*>(to_name.utf16()),
+                       MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+    QByteArray from_name = QFile::encodeName(from);
+    QByteArray to_name = QFile::encodeName(to);
+    // rename() replaces the existing file atomically on POSIX systems
+    if (std::rename(from_name.constData(), to_name.constData()) != 0) {
+        return false;
+    }
+    // the new directory entry is flushed as well
+    int dir = ::open(QFile::encodeName(QFileInfo(to).absolutePath()).constData(), O_RDONLY);
+    if (dir >= 0) {
+        ::fsync(dir);
+        ::close(dir);
+    }
+    return true;
+#endif
+}
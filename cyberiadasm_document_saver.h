@@ -0,0 +1,81 @@
+/* -----------------------------------------------------------------------------
+ * The Cyberiada State Machine Editor
+ * -----------------------------------------------------------------------------
+ * 
+ * The Background Document Saver
+ *
+ * Copyright (C) 2024 Alexey Fedoseev <aleksey@fedoseev.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see https://www.gnu.org/licenses/
+ *
+ * ----------------------------------------------------------------------------- */
+
+#ifndef CYBERIADA_SM_DOCUMENT_SAVER_HEADER
+#define CYBERIADA_SM_DOCUMENT_SAVER_HEADER
+
+#include <QThread>
+#include <QString>
+#include <QMutex>
+#include <QWaitCondition>
+#include <cyberiada/cyberiadamlpp.h>
+
+// Serializes a snapshot of the document in a worker thread. The snapshot is copied
+// from the document in the worker too: the document must not be changed until
+// waitForSnapshot() returns, the reads of the GUI thread go on meanwhile. The snapshot is
+// written to a temporary file next to the target and then renamed over it,
+// so the target file is either the old or the new version, never a truncated one.
+// The temporary file is flushed to the disk before the rename.
+class CyberiadaSMDocumentSaver: public QThread {
+Q_OBJECT
+
+public:
+    CyberiadaSMDocumentSaver(const Cyberiada::LocalDocument* source, const QString& path,
+                             Cyberiada::DocumentFormat format, bool round = false,
+                             QObject* parent = NULL);
+    ~CyberiadaSMDocumentSaver();
+
+    const QString&            path() const { return filePath; }
+    Cyberiada::DocumentFormat format() const { return fileFormat; }
+
+    bool                      hasError() const { return !errorMessage.isEmpty(); }
+    const QString&            error() const { return errorMessage; }
+    // serialization and replace time in milliseconds
+    qint64                    saveTime() const { return saveMsec; }
+    // the time of copying the document in milliseconds
+    qint64                    snapshotTime() const { return snapshotMsec; }
+
+    // blocks until the worker has copied the document
+    void                      waitForSnapshot();
+
+protected:
+    void                      run();
+
+private:
+    bool                      flushFile(const QString& path);
+    bool                      replaceFile(const QString& from, const QString& to);
+
+    const Cyberiada::LocalDocument* source;
+    Cyberiada::LocalDocument* snapshot;
+    QMutex                    snapshotMutex;
+    QWaitCondition            snapshotCondition;
+    bool                      snapshotReady;
+    qint64                    snapshotMsec;
+    QString                   filePath;
+    Cyberiada::DocumentFormat fileFormat;
+    bool                      round;
+    QString                   errorMessage;
+    qint64                    saveMsec;
+};
+
+#endif
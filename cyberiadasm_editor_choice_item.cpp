@@ -26,6 +26,7 @@
 #include <QColor>
 
 #include "cyberiadasm_editor_choice_item.h"
+#include "cyberiadasm_editor_geometry.h"
 #include "myassert.h"
 
 /* -----------------------------------------------------------------------------
@@ -53,3 +54,15 @@ void CyberiadaSMEditorChoiceItem::paint(QPainter* painter, const QStyleOptionGra
 
     painter->drawConvexPolygon(points, 4);
 }
+
+bool CyberiadaSMEditorChoiceItem::outlineIntersection(const QPointF& start, const QPointF& dir, QPointF* point) const
+{
+    QRectF r = boundingRect();
+    const QPointF points[] = {
+        QPointF(r.left() + r.width() / 2.0, r.top()),
+        QPointF(r.right(), r.top() + r.height() / 2.0),
+        QPointF(r.left() + r.width() / 2.0, r.bottom()),
+        QPointF(r.left(), r.top() + r.height() / 2.0)
+    };
+    return CyberiadaSMEditorGeometry::linePolygon(start, dir, points, 4, point);
+}
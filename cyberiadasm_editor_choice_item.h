@@ -39,6 +39,7 @@ public:
     virtual int type() const { return ChoiceItem; }
 
     virtual void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget);
+    bool outlineIntersection(const QPointF& start, const QPointF& dir, QPointF* point) const override;
 };
 
 
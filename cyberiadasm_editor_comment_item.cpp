@@ -24,12 +24,12 @@
 #include <QDebug>
 #include <QPainter>
 #include <QColor>
-#include <QFontDatabase>
 #include "cyberiadasm_editor_comment_item.h"
 #include "myassert.h"
 #include "cyberiada_constants.h"
 #include "fontmanager.h"
 #include "settings_manager.h"
+#include "cyberiadasm_editor_geometry.h"
 
 /* -----------------------------------------------------------------------------
  * Comment Item
@@ -39,10 +39,10 @@ CyberiadaSMEditorCommentItem::CyberiadaSMEditorCommentItem(QObject *parent_objec
                                                            CyberiadaSMModel *model,
                                                            Cyberiada::Element *element,
                                                            QGraphicsItem *parent,
-                                                           QMap<Cyberiada::ID, QGraphicsItem*>& elementItem) :
+                                                           CyberiadaSMEditorItemRegistry& elementItem) :
     CyberiadaSMEditorAbstractItem(model, element, parent),
     // QObject(parent_object),
-    elementIdToItemMap(elementItem)
+    itemRegistry(elementItem)
 {
     comment = static_cast<const Cyberiada::Comment*>(element);
 
@@ -56,15 +56,7 @@ CyberiadaSMEditorCommentItem::CyberiadaSMEditorCommentItem(QObject *parent_objec
     // connect(body, EditableTextItem::editingFinished, this, CyberiadaSMEditorCommentItem::onBodyChanged);
 
     if (element->get_type() == Cyberiada::elementFormalComment) {
-        int fontId = QFontDatabase::addApplicationFont(":/Fonts/fonts/courier.ttf");
-        if (fontId != -1) {
-            QStringList fontFamilies = QFontDatabase::applicationFontFamilies(fontId);
-            if (!fontFamilies.isEmpty()) {
-                QFont customFont(fontFamilies.at(0), FontManager::instance().getFont().pointSize());
-                body->setFont(customFont);
-                body->setFontStyleChangeable(false);
-            }
-        }
+        body->setFontRole(FontManager::FormalCommentFont);
     }
 
     commentBrush = QBrush(QColor(0xff, 0xcc, 0));
@@ -127,6 +119,8 @@ void CyberiadaSMEditorCommentItem::paint(QPainter* painter, const QStyleOptionGr
 
     painter->drawConvexPolygon(points, 5);
 
+    if (paintDetailLevel(painter) == DetailLevel::Outline) return;
+
     Cyberiada::ElementType type = element->get_type();
     if (type == Cyberiada::elementFormalComment) {
         painter->setBrush(QBrush(Qt::black));
@@ -143,6 +137,19 @@ void CyberiadaSMEditorCommentItem::paint(QPainter* painter, const QStyleOptionGr
     painter->drawConvexPolygon(triangle, 3);
 }
 
+bool CyberiadaSMEditorCommentItem::outlineIntersection(const QPointF& start, const QPointF& dir, QPointF* point) const
+{
+    QRectF r = boundingRect();
+    const QPointF points[] = {
+        QPointF(r.left(), r.top()),
+        QPointF(r.right() - COMMENT_ANGLE_CORNER, r.top()),
+        QPointF(r.right(), r.top() + COMMENT_ANGLE_CORNER),
+        QPointF(r.right(), r.bottom()),
+        QPointF(r.left(), r.bottom())
+    };
+    return CyberiadaSMEditorGeometry::linePolygon(start, dir, points, 5, point);
+}
+
 // TODO
 void CyberiadaSMEditorCommentItem::onBodyChanged()
 {
@@ -156,9 +163,9 @@ void CyberiadaSMEditorCommentItem::setTextPosition()
     body->setPos(oldRect.x() + (oldRect.width() - titleRect.width()) / 2 , oldRect.y());
 }
 
-void CyberiadaSMEditorCommentItem::syncFromModel()
+void CyberiadaSMEditorCommentItem::syncFromModel(CyberiadaSMModel::ChangeKinds kinds)
 {
     // TODO
-    CyberiadaSMEditorAbstractItem::syncFromModel();
+    CyberiadaSMEditorAbstractItem::syncFromModel(kinds);
 }
 
@@ -28,6 +28,7 @@
 #include <QBrush>
 
 #include "cyberiadasm_editor_items.h"
+#include "cyberiadasm_editor_item_registry.h"
 #include "editable_text_item.h"
 
 /* -----------------------------------------------------------------------------
@@ -43,16 +44,17 @@ public:
                          CyberiadaSMModel *model,
                          Cyberiada::Element *element,
                          QGraphicsItem *parent,
-                         QMap<Cyberiada::ID, QGraphicsItem*> &elementItem);
+                         CyberiadaSMEditorItemRegistry& elementItem);
     ~CyberiadaSMEditorCommentItem();
 
     virtual int type() const { return CommentItem; }
 
     QRectF boundingRect() const override;
+    bool outlineIntersection(const QPointF& start, const QPointF& dir, QPointF* point) const override;
 
     void setTextPosition();
 
-    void syncFromModel() override;
+    void syncFromModel(CyberiadaSMModel::ChangeKinds kinds = CyberiadaSMModel::ChangeAll) override;
 
 protected:
     void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget) override;
@@ -65,7 +67,7 @@ private:
     QBrush commentBrush;
 
     const Cyberiada::Comment* comment;
-    QMap<Cyberiada::ID, QGraphicsItem*>& elementIdToItemMap;
+    CyberiadaSMEditorItemRegistry& itemRegistry;
 };
 
 #endif // CYBERIADASM_EDITOR_COMMENT_ITEM_H
@@ -0,0 +1,200 @@
+/* -----------------------------------------------------------------------------
+ * The Cyberiada State Machine Editor
+ * -----------------------------------------------------------------------------
+ *
+ * The State Machine Editor Geometry
+ *
+ * Copyright (C) 2024 Alexey Fedoseev <aleksey@fedoseev.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see https://www.gnu.org/licenses/
+ *
+ * ----------------------------------------------------------------------------- */
+
+#include <QtMath>
+#include <QPolygonF>
+
+#include "cyberiadasm_editor_geometry.h"
+#include "cyberiadasm_editor_items.h"
+
+// the start point of the transition end is searched in the item rect with the margin
+static qreal ITEM_INTERSECTION_MARGIN = 60;
+
+// the line parameter with the least absolute value found so far
+struct NearestParameter {
+    bool  found = false;
+    qreal t = 0;
+
+    void add(qreal candidate) {
+        if (!found || qAbs(candidate) < qAbs(t)) {
+            t = candidate;
+            found = true;
+        }
+    }
+};
+
+static qreal cross(const QPointF& a, const QPointF& b)
+{
+    return a.x() * b.y() - a.y() * b.x();
+}
+
+static void segmentParameter(const QPointF& start, const QPointF& dir,
+                             const QPointF& a, const QPointF& b, NearestParameter& nearest)
+{
+    QPointF edge = b - a;
+    qreal denominator = cross(dir, edge);
+    if (qFuzzyIsNull(denominator)) {
+        // the line is parallel to the segment
+        return;
+    }
+    QPointF ac = a - start;
+    qreal u = cross(ac, dir) / denominator;
+    if (u < 0 || u > 1) {
+        return;
+    }
+    nearest.add(cross(ac, edge) / denominator);
+}
+
+static void circleParameters(const QPointF& start, const QPointF& dir,
+                             const QPointF& center, qreal radius,
+                             qreal* roots, int* count)
+{
+    // |start + t * dir - center|^2 = radius^2
+    QPointF f = start - center;
+    qreal a = QPointF::dotProduct(dir, dir);
+    qreal b = 2 * QPointF::dotProduct(f, dir);
+    qreal c = QPointF::dotProduct(f, f) - radius * radius;
+    qreal discriminant = b * b - 4 * a * c;
+    *count = 0;
+    if (qFuzzyIsNull(a) || discriminant < 0) {
+        return;
+    }
+    qreal root = qSqrt(discriminant);
+    roots[(*count)++] = (-b - root) / (2 * a);
+    roots[(*count)++] = (-b + root) / (2 * a);
+}
+
+static bool result(const QPointF& start, const QPointF& dir, const NearestParameter& nearest, QPointF* point)
+{
+    if (!nearest.found) {
+        return false;
+    }
+    *point = start + dir * nearest.t;
+    return true;
+}
+
+bool CyberiadaSMEditorGeometry::lineRoundedRect(const QPointF& start, const QPointF& dir,
+                                                const QRectF& rect, qreal radius, QPointF* point)
+{
+    QRectF r = rect.normalized();
+    radius = qMax<qreal>(0, qMin(radius, qMin(r.width(), r.height()) / 2));
+    NearestParameter nearest;
+
+    // the straight parts of the sides
+    segmentParameter(start, dir, QPointF(r.left() + radius, r.top()), QPointF(r.right() - radius, r.top()), nearest);
+    segmentParameter(start, dir, QPointF(r.left() + radius, r.bottom()), QPointF(r.right() - radius, r.bottom()), nearest);
+    segmentParameter(start, dir, QPointF(r.left(), r.top() + radius), QPointF(r.left(), r.bottom() - radius), nearest);
+    segmentParameter(start, dir, QPointF(r.right(), r.top() + radius), QPointF(r.right(), r.bottom() - radius), nearest);
+
+    if (radius > 0) {
+        // the corner arcs: the root counts if it lies in the outer quadrant of the corner circle
+        const QPointF centers[] = {
+            QPointF(r.left() + radius, r.top() + radius),
+            QPointF(r.right() - radius, r.top() + radius),
+            QPointF(r.right() - radius, r.bottom() - radius),
+            QPointF(r.left() + radius, r.bottom() - radius)
+        };
+        const qreal signX[] = { -1, 1, 1, -1 };
+        const qreal signY[] = { -1, -1, 1, 1 };
+        for (int i = 0; i < 4; i++) {
+            qreal roots[2];
+            int count;
+            circleParameters(start, dir, centers[i], radius, roots, &count);
+            for (int j = 0; j < count; j++) {
+                QPointF p = start + dir * roots[j] - centers[i];
+                if (p.x() * signX[i] >= 0 && p.y() * signY[i] >= 0) {
+                    nearest.add(roots[j]);
+                }
+            }
+        }
+    }
+    return result(start, dir, nearest, point);
+}
+
+bool CyberiadaSMEditorGeometry::lineCircle(const QPointF& start, const QPointF& dir,
+                                           const QPointF& center, qreal radius, QPointF* point)
+{
+    NearestParameter nearest;
+    qreal roots[2];
+    int count;
+    circleParameters(start, dir, center, radius, roots, &count);
+    for (int i = 0; i < count; i++) {
+        nearest.add(roots[i]);
+    }
+    return result(start, dir, nearest, point);
+}
+
+bool CyberiadaSMEditorGeometry::linePolygon(const QPointF& start, const QPointF& dir,
+                                            const QPointF* points, int count, QPointF* point)
+{
+    NearestParameter nearest;
+    for (int i = 0; i < count; i++) {
+        segmentParameter(start, dir, points[i], points[(i + 1) % count], nearest);
+    }
+    return result(start, dir, nearest, point);
+}
+
+bool CyberiadaSMEditorGeometry::linePath(const QPointF& start, const QPointF& dir,
+                                         const QPainterPath& path, QPointF* point)
+{
+    QPolygonF polygon = path.toFillPolygon();
+    return linePolygon(start, dir, polygon.constData(), polygon.size(), point);
+}
+
+QPointF CyberiadaSMEditorGeometry::itemIntersection(const CyberiadaSMEditorAbstractItem* item,
+                                                    const QPointF& start, const QPointF& end,
+                                                    bool* hasIntersections)
+{
+    if (!item) return QPointF();
+
+    qreal margin = ITEM_INTERSECTION_MARGIN;
+    QRectF adjustedRect = item->sceneBoundingRect().adjusted(-margin, -margin, margin, margin);
+
+    if (!adjustedRect.contains(start)) {
+        *hasIntersections = false;
+        return QPointF();
+    }
+
+    QPointF dir = end - start;
+    if (dir.isNull()) {
+        *hasIntersections = false;
+        return QPointF();
+    }
+
+    if (item->type() == CyberiadaSMEditorAbstractItem::VertexItem) {
+        // the transitions are attached to the centers of the vertices
+        *hasIntersections = true;
+        return item->sceneBoundingRect().center();
+    }
+
+    // the outlines are known in the item coordinates
+    QPointF localStart = item->mapFromScene(start);
+    QPointF localDir = item->mapFromScene(end) - localStart;
+    QPointF localPoint;
+    if (item->outlineIntersection(localStart, localDir, &localPoint)) {
+        *hasIntersections = true;
+        return item->mapToScene(localPoint);
+    }
+    *hasIntersections = false;
+    return QPointF();
+}
@@ -0,0 +1,53 @@
+/* -----------------------------------------------------------------------------
+ * The Cyberiada State Machine Editor
+ * -----------------------------------------------------------------------------
+ *
+ * The State Machine Editor Geometry
+ *
+ * Copyright (C) 2024 Alexey Fedoseev <aleksey@fedoseev.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see https://www.gnu.org/licenses/
+ *
+ * ----------------------------------------------------------------------------- */
+
+#ifndef CYBERIADA_SM_EDITOR_GEOMETRY_HEADER
+#define CYBERIADA_SM_EDITOR_GEOMETRY_HEADER
+
+#include <QPointF>
+#include <QRectF>
+#include <QPainterPath>
+
+class CyberiadaSMEditorAbstractItem;
+
+// The intersections of the line start + t * dir (t of any sign) with the outlines
+// of the items. The functions return the intersection nearest to the start.
+class CyberiadaSMEditorGeometry {
+public:
+    static bool lineRoundedRect(const QPointF& start, const QPointF& dir,
+                                const QRectF& rect, qreal radius, QPointF* point);
+    static bool lineCircle(const QPointF& start, const QPointF& dir,
+                           const QPointF& center, qreal radius, QPointF* point);
+    static bool linePolygon(const QPointF& start, const QPointF& dir,
+                            const QPointF* points, int count, QPointF* point);
+    // the outline of an arbitrary shape is flattened
+    static bool linePath(const QPointF& start, const QPointF& dir,
+                         const QPainterPath& path, QPointF* point);
+
+    // the point where the transition going through start towards end crosses the item outline (in scene coordinates)
+    static QPointF itemIntersection(const CyberiadaSMEditorAbstractItem* item,
+                                    const QPointF& start, const QPointF& end,
+                                    bool* hasIntersections);
+};
+
+#endif
@@ -0,0 +1,171 @@
+/* -----------------------------------------------------------------------------
+ * The Cyberiada State Machine Editor
+ * -----------------------------------------------------------------------------
+ *
+ * The State Machine Editor Item Registry
+ *
+ * Copyright (C) 2024 Alexey Fedoseev <aleksey@fedoseev.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see https://www.gnu.org/licenses/
+ *
+ * ----------------------------------------------------------------------------- */
+
+#include "cyberiadasm_editor_item_registry.h"
+#include "cyberiadasm_editor_spatial_index.h"
+#include "myassert.h"
+
+CyberiadaSMEditorItemRegistry::CyberiadaSMEditorItemRegistry():
+    spatialIndex(NULL)
+{
+}
+
+CyberiadaSMEditorItemRegistry::Handle CyberiadaSMEditorItemRegistry::insert(const Cyberiada::ID& id, QGraphicsItem* item)
+{
+    MY_ASSERT(item);
+    std::unordered_map<Cyberiada::ID, Handle>::iterator i = idToHandle.find(id);
+    if (i != idToHandle.end()) {
+        // the element got a new item: the old handle becomes stale
+        release(i->second);
+        idToHandle.erase(i);
+    }
+    quint32 index;
+    if (freeSlots.isEmpty()) {
+        index = quint32(entries.size());
+        Slot slot;
+        slot.item = NULL;
+        slot.generation = 0;
+        entries.append(slot);
+    } else {
+        index = freeSlots.takeLast();
+    }
+    Slot& slot = entries[int(index)];
+    // generation 0 is never used, so the handle 0 is always invalid
+    slot.generation++;
+    slot.item = item;
+    slot.id = id;
+    Handle h = makeHandle(index, slot.generation);
+    idToHandle[id] = h;
+    itemToHandle.insert(item, h);
+    if (spatialIndex) {
+        spatialIndex->insert(item);
+    }
+    return h;
+}
+
+void CyberiadaSMEditorItemRegistry::remove(const Cyberiada::ID& id)
+{
+    std::unordered_map<Cyberiada::ID, Handle>::iterator i = idToHandle.find(id);
+    if (i == idToHandle.end()) {
+        return;
+    }
+    release(i->second);
+    idToHandle.erase(i);
+}
+
+void CyberiadaSMEditorItemRegistry::rename(const Cyberiada::ID& old_id, const Cyberiada::ID& new_id)
+{
+    std::unordered_map<Cyberiada::ID, Handle>::iterator i = idToHandle.find(old_id);
+    if (i == idToHandle.end() || old_id == new_id) {
+        return;
+    }
+    Handle h = i->second;
+    idToHandle.erase(i);
+    idToHandle[new_id] = h;
+    entries[int(slotIndex(h))].id = new_id;
+}
+
+void CyberiadaSMEditorItemRegistry::clear()
+{
+    // the generations are kept to make the handles issued before stale
+    for (int i = 0; i < entries.size(); i++) {
+        if (entries[i].item) {
+            entries[i].item = NULL;
+            entries[i].id.clear();
+            freeSlots.append(quint32(i));
+        }
+    }
+    idToHandle.clear();
+    itemToHandle.clear();
+    if (spatialIndex) {
+        spatialIndex->clear();
+    }
+}
+
+bool CyberiadaSMEditorItemRegistry::contains(const Cyberiada::ID& id) const
+{
+    return idToHandle.find(id) != idToHandle.end();
+}
+
+QGraphicsItem* CyberiadaSMEditorItemRegistry::value(const Cyberiada::ID& id) const
+{
+    return item(handle(id));
+}
+
+Cyberiada::ID CyberiadaSMEditorItemRegistry::key(const QGraphicsItem* item) const
+{
+    QHash<const QGraphicsItem*, Handle>::const_iterator i = itemToHandle.constFind(item);
+    if (i == itemToHandle.constEnd()) {
+        return Cyberiada::ID();
+    }
+    return entries[int(slotIndex(i.value()))].id;
+}
+
+CyberiadaSMEditorItemRegistry::Handle CyberiadaSMEditorItemRegistry::handle(const Cyberiada::ID& id) const
+{
+    std::unordered_map<Cyberiada::ID, Handle>::const_iterator i = idToHandle.find(id);
+    if (i == idToHandle.end()) {
+        return invalidHandle;
+    }
+    return i->second;
+}
+
+QGraphicsItem* CyberiadaSMEditorItemRegistry::item(Handle h) const
+{
+    quint32 index = slotIndex(h);
+    if (h == invalidHandle || index >= quint32(entries.size())) {
+        return NULL;
+    }
+    const Slot& slot = entries[int(index)];
+    if (slot.generation != slotGeneration(h)) {
+        return NULL;
+    }
+    return slot.item;
+}
+
+QList<QGraphicsItem*> CyberiadaSMEditorItemRegistry::items() const
+{
+    QList<QGraphicsItem*> result;
+    result.reserve(int(idToHandle.size()));
+    for (int i = 0; i < entries.size(); i++) {
+        if (entries[i].item) {
+            result.append(entries[i].item);
+        }
+    }
+    return result;
+}
+
+void CyberiadaSMEditorItemRegistry::release(Handle h)
+{
+    quint32 index = slotIndex(h);
+    MY_ASSERT(index < quint32(entries.size()));
+    Slot& slot = entries[int(index)];
+    itemToHandle.remove(slot.item);
+    if (spatialIndex) {
+        spatialIndex->remove(slot.item);
+    }
+    slot.item = NULL;
+    slot.id.clear();
+    // the next item in the slot gets the next generation
+    freeSlots.append(index);
+}
@@ -0,0 +1,87 @@
+/* -----------------------------------------------------------------------------
+ * The Cyberiada State Machine Editor
+ * -----------------------------------------------------------------------------
+ *
+ * The State Machine Editor Item Registry
+ *
+ * Copyright (C) 2024 Alexey Fedoseev <aleksey@fedoseev.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see https://www.gnu.org/licenses/
+ *
+ * ----------------------------------------------------------------------------- */
+
+#ifndef CYBERIADA_SM_EDITOR_ITEM_REGISTRY_HEADER
+#define CYBERIADA_SM_EDITOR_ITEM_REGISTRY_HEADER
+
+#include <QGraphicsItem>
+#include <QHash>
+#include <QList>
+#include <QVector>
+#include <unordered_map>
+#include <cyberiada/cyberiadamlpp.h>
+
+class CyberiadaSMEditorSpatialIndex;
+
+// The scene items of the document elements. The items are found by the element ID
+// and the ID by the item in constant time. A handle names the registry slot of the
+// item: the items that refer to other items (e.g. the transitions) keep the handles
+// and resolve them without hashing the IDs. The handle of a removed item is stale
+// and resolves to NULL even if its slot is taken by another item.
+class CyberiadaSMEditorItemRegistry {
+public:
+    typedef quint64 Handle;
+    static const Handle invalidHandle = 0;
+
+    CyberiadaSMEditorItemRegistry();
+
+    // the registered items are indexed by their scene rects as well
+    void                  setSpatialIndex(CyberiadaSMEditorSpatialIndex* index) { spatialIndex = index; }
+
+    Handle                insert(const Cyberiada::ID& id, QGraphicsItem* item);
+    void                  remove(const Cyberiada::ID& id);
+    // the element ID was changed, the item stays the same
+    void                  rename(const Cyberiada::ID& old_id, const Cyberiada::ID& new_id);
+    void                  clear();
+
+    bool                  isEmpty() const { return idToHandle.empty(); }
+    int                   size() const { return int(idToHandle.size()); }
+    bool                  contains(const Cyberiada::ID& id) const;
+    QGraphicsItem*        value(const Cyberiada::ID& id) const;
+    Cyberiada::ID         key(const QGraphicsItem* item) const;
+    Handle                handle(const Cyberiada::ID& id) const;
+    QGraphicsItem*        item(Handle h) const;
+    QList<QGraphicsItem*> items() const;
+
+private:
+    struct Slot {
+        QGraphicsItem*    item;
+        Cyberiada::ID     id;
+        quint32           generation;
+    };
+
+    static quint32        slotIndex(Handle h) { return quint32(h & 0xffffffff); }
+    static quint32        slotGeneration(Handle h) { return quint32(h >> 32); }
+    static Handle         makeHandle(quint32 index, quint32 generation) {
+        return (Handle(generation) << 32) | Handle(index);
+    }
+    void                  release(Handle h);
+
+    QVector<Slot>         entries;
+    QVector<quint32>      freeSlots;
+    std::unordered_map<Cyberiada::ID, Handle> idToHandle;
+    QHash<const QGraphicsItem*, Handle> itemToHandle;
+    CyberiadaSMEditorSpatialIndex* spatialIndex;
+};
+
+#endif
@@ -25,8 +25,10 @@
 #include <QPainter>
 #include <QColor>
 #include <QCursor>
+#include <QStyleOptionGraphicsItem>
 
 #include "cyberiadasm_editor_items.h"
+#include "cyberiadasm_editor_geometry.h"
 #include "cyberiadasm_editor_scene.h"
 #include "cyberiadasm_editor_state_item.h"
 #include "settings_manager.h"
@@ -51,6 +53,9 @@ CyberiadaSMEditorAbstractItem::CyberiadaSMEditorAbstractItem(CyberiadaSMModel* _
 
     prevItemUnderCursor = nullptr;
     isHighlighted = false;
+    for (int i = 0; i < 8; i++) {
+        cornerGrabber[i] = nullptr;
+    }
 
     if(parent) {
         CyberiadaSMEditorAbstractItem* newParent = dynamic_cast<CyberiadaSMEditorAbstractItem*>(parent);
@@ -89,6 +94,31 @@ CyberiadaSMEditorAbstractItem::CyberiadaSMEditorAbstractItem(CyberiadaSMModel* _
     }
 }
 
+CyberiadaSMEditorAbstractItem::~CyberiadaSMEditorAbstractItem()
+{
+    CyberiadaSMEditorScene* cScene = dynamic_cast<CyberiadaSMEditorScene*>(scene());
+    if (cScene) {
+        cScene->unmarkGeometryDirty(this);
+    }
+}
+
+DetailLevel paintDetailLevel(const QPainter* painter)
+{
+    qreal lod = QStyleOptionGraphicsItem::levelOfDetailFromTransform(painter->worldTransform());
+    if (lod < LOD_OUTLINE_SCALE) {
+        return DetailLevel::Outline;
+    }
+    if (lod < LOD_TITLES_SCALE) {
+        return DetailLevel::Titles;
+    }
+    return DetailLevel::Full;
+}
+
+bool CyberiadaSMEditorAbstractItem::outlineIntersection(const QPointF& start, const QPointF& dir, QPointF* point) const
+{
+    return CyberiadaSMEditorGeometry::linePath(start, dir, shape(), point);
+}
+
 QVariant CyberiadaSMEditorAbstractItem::data(int key) const
 {
 	if (key == 0) {
@@ -125,13 +155,48 @@ void CyberiadaSMEditorAbstractItem::setHighlighted(bool on)
     }
 }
 
-void CyberiadaSMEditorAbstractItem::syncFromModel()
+void CyberiadaSMEditorAbstractItem::syncFromModel(CyberiadaSMModel::ChangeKinds kinds)
 {
-    setDotsPosition();
+    if (kinds & CyberiadaSMModel::ChangeGeometry) {
+        setDotsPosition();
+        markIndexDirty();
+    }
     update();
 }
 
+void CyberiadaSMEditorAbstractItem::invalidateBounds()
+{
+    // the regions are skipped, the nearest element item is notified
+    for (QGraphicsItem* p = parentItem(); p; p = p->parentItem()) {
+        CyberiadaSMEditorAbstractItem* parent = dynamic_cast<CyberiadaSMEditorAbstractItem*>(p);
+        if (parent) {
+            parent->invalidateBounds();
+            return;
+        }
+    }
+}
+
+void CyberiadaSMEditorAbstractItem::markIndexDirty()
+{
+    CyberiadaSMEditorScene* cScene = dynamic_cast<CyberiadaSMEditorScene*>(scene());
+    if (cScene) {
+        cScene->getSpatialIndex().markDirty(this);
+    }
+}
+
 void CyberiadaSMEditorAbstractItem::onParentGeometryChanged() {
+    // every mouse move of an ancestor reaches here; the scene walks the subtree once per event
+    CyberiadaSMEditorScene* cScene = dynamic_cast<CyberiadaSMEditorScene*>(scene());
+    if (cScene) {
+        cScene->markGeometryDirty(this);
+    } else {
+        applyParentGeometryChange();
+    }
+}
+
+void CyberiadaSMEditorAbstractItem::applyParentGeometryChange()
+{
+    markIndexDirty();
     update();
     emit geometryChanged();
 }
@@ -185,11 +250,17 @@ void CyberiadaSMEditorAbstractItem::updateSizeToFitChildren(CyberiadaSMEditorAbs
 QVariant CyberiadaSMEditorAbstractItem::itemChange(GraphicsItemChange change, const QVariant &value)
 {
     if (change == ItemPositionHasChanged || change == ItemTransformHasChanged) {
+        markIndexDirty();
         emit geometryChanged();
     }
     if (change == ItemParentHasChanged) {
+        markIndexDirty();
         handleParentChange();
     }
+    if (change == ItemSelectedHasChanged && !value.toBool()) {
+        // the grabbers go back to the scene pool
+        hideDots();
+    }
     return QGraphicsItem::itemChange(change, value);
 }
 
@@ -232,6 +303,9 @@ void CyberiadaSMEditorAbstractItem::mouseMoveEvent(QGraphicsSceneMouseEvent *eve
 
     QPointF pt = event->pos();
 
+    // a single move may update this item and all its parents several times
+    model->beginTransaction();
+
     switch (cornerFlags) {
     case Top:
         updatePosGeometry();
@@ -283,6 +357,7 @@ void CyberiadaSMEditorAbstractItem::mouseMoveEvent(QGraphicsSceneMouseEvent *eve
             }
         }
     }
+    model->commitTransaction();
     // emit geometryChanged();
 }
 
@@ -473,10 +548,7 @@ void CyberiadaSMEditorAbstractItem::updatePosGeometry()
 
 void CyberiadaSMEditorAbstractItem::initializeDots()
 {
-    if (!element->has_geometry()) return;
-    for (int i = 0; i < 8; i++){
-        cornerGrabber[i] = new DotSignal(this);
-    }
+    // the grabbers are taken from the scene pool when the item is selected, see showDots
 }
 
 // change of parent
@@ -495,6 +567,7 @@ void CyberiadaSMEditorAbstractItem::handleParentChange() {
 void CyberiadaSMEditorAbstractItem::setDotsPosition()
 {    
     if(!element->has_geometry()) return;
+    if(!cornerGrabber[0]) return;
     QRectF tmpRect = boundingRect();
     cornerGrabber[GrabberTop]->setPos(tmpRect.left() + tmpRect.width()/2, tmpRect.top());
     cornerGrabber[GrabberBottom]->setPos(tmpRect.left() + tmpRect.width()/2, tmpRect.bottom());
@@ -510,6 +583,14 @@ void CyberiadaSMEditorAbstractItem::showDots()
 {
     if(!isSelected()) return;
     if(!element->has_geometry()) return;
+    if(!cornerGrabber[0]) {
+        CyberiadaSMEditorScene* cScene = dynamic_cast<CyberiadaSMEditorScene*>(scene());
+        if (!cScene) return;
+        for(int i = 0; i < 8; i++){
+            cornerGrabber[i] = cScene->acquireDot(this);
+        }
+        setDotsPosition();
+    }
     for(int i = 0; i < 8; i++){
         cornerGrabber[i]->setVisible(true);
     }
@@ -517,28 +598,22 @@ void CyberiadaSMEditorAbstractItem::showDots()
 
 void CyberiadaSMEditorAbstractItem::hideDots()
 {
-    if(!element->has_geometry()) return;
+    if(!cornerGrabber[0]) return;
+    CyberiadaSMEditorScene* cScene = dynamic_cast<CyberiadaSMEditorScene*>(scene());
     for(int i = 0; i < 8; i++){
-        cornerGrabber[i]->setVisible(false);
+        if (cScene) {
+            cScene->releaseDot(cornerGrabber[i]);
+            cornerGrabber[i] = nullptr;
+        } else {
+            cornerGrabber[i]->setVisible(false);
+        }
     }
 }
 
 CyberiadaSMEditorAbstractItem *CyberiadaSMEditorAbstractItem::collectionUnderItem()
 {
+    CyberiadaSMEditorScene* cScene = dynamic_cast<CyberiadaSMEditorScene*>(scene());
+    if (!cScene) return nullptr;
     QPointF center = mapToScene(boundingRect().center());
-    QList<QGraphicsItem*> items = scene()->items(center);
-
-    CyberiadaSMEditorAbstractItem* cItem = nullptr;
-    for (QGraphicsItem* item : items) {
-        cItem = dynamic_cast<CyberiadaSMEditorAbstractItem*>(item);
-        if (!cItem) { continue; }
-        if (cItem == this) { continue; }
-
-        if (cItem->type() == CyberiadaSMEditorAbstractItem::StateItem ||
-            cItem->type() == CyberiadaSMEditorAbstractItem::CompositeStateItem ||
-            cItem->type() == CyberiadaSMEditorAbstractItem::SMItem) {
-            return cItem;
-        }
-    }
-    return nullptr;
+    return cScene->getSpatialIndex().containerAt(center, this);
 }
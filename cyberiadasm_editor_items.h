@@ -29,8 +29,14 @@
 #include <QBrush>
 
 #include "cyberiadasm_model.h"
+#include "cyberiada_constants.h"
 #include "dotsignal.h"
 
+class QPainter;
+
+// the details of the items shown at the current scale of the view
+DetailLevel paintDetailLevel(const QPainter* painter);
+
 /* -----------------------------------------------------------------------------
  * Abstract Item
  * ----------------------------------------------------------------------------- */
@@ -45,7 +51,7 @@ public:
                                   Cyberiada::Element* element,
 								  QGraphicsItem* parent = NULL);
 
-    virtual ~CyberiadaSMEditorAbstractItem() = default;
+    virtual ~CyberiadaSMEditorAbstractItem();
 
 	enum {
         SMItem = UserType + 1,
@@ -87,6 +93,8 @@ public:
     virtual void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget) = 0;
 
     virtual QRectF boundingRect() const = 0;
+    // the outline point nearest to start on the line start + t * dir (in the item coordinates)
+    virtual bool outlineIntersection(const QPointF& start, const QPointF& dir, QPointF* point) const;
 	virtual QVariant data(int key) const;
 
 	static QRectF toQtRect(const Cyberiada::Rect& r) {
@@ -100,14 +108,21 @@ public:
 
     void setHighlighted(bool on);
 
-    virtual void syncFromModel();
+    virtual void syncFromModel(CyberiadaSMModel::ChangeKinds kinds = CyberiadaSMModel::ChangeAll);
+    // the geometry of the element or of its descendants was changed: the cached bounds
+    // up the hierarchy are dropped
+    virtual void invalidateBounds();
     virtual void updateSizeToFitChildren(CyberiadaSMEditorAbstractItem* child);
+    // an ancestor was moved: called once per event by the scene for the whole subtree
+    void applyParentGeometryChange();
 
 protected:
     CyberiadaSMModel* model;
     Cyberiada::Element* element;
 
     void onParentGeometryChanged();
+    // the scene rect of the item was changed
+    void markIndexDirty();
     virtual void onParentSizeChanged(CornerFlags side, qreal d);
     void onChildGeometryChanged();
 
@@ -30,6 +30,10 @@
 #include <QGraphicsScene>
 #include <QCursor>
 #include <QMessageBox>
+#include <QGraphicsSceneMouseEvent>
+#include <QPixmap>
+#include <QDateTime>
+#include <math.h>
 
 #include "cyberiadasm_editor_scene.h"
 #include "cyberiadasm_editor_items.h"
@@ -48,10 +52,24 @@ static double DEFAULT_SCENE_WIDTH = 1000;
 static double DEFAULT_SCENE_HEIGHT = 1000;
 static double DEFAULT_SCENE_DELTA = 0.2;
 static double DEFAULT_SCENE_BORDER_MARGIN = 50;
+// the scene is built in slices of this duration to keep the UI responsive
+static qint64 SCENE_BUILD_SLICE_MSEC = 15;
+// the number of the state machines which items are kept in the scene
+static int SCENE_MAX_PAGES = 4;
+// the hidden state machines are released if they are not shown again during this time
+static int SCENE_PAGE_RELEASE_MSEC = 30000;
+// the minimal and the maximal size of the grid tile in pixels
+static int GRID_TILE_MIN_PIXELS = 64;
+static int GRID_TILE_MAX_PIXELS = 1024;
+// the grid is not shown if the cells are smaller (in pixels)
+static qreal GRID_MIN_CELL_PIXELS = 3;
+// the number of the released grabbers kept for reuse
+static int SCENE_DOT_POOL_SIZE = 64;
 
 CyberiadaSMEditorScene::CyberiadaSMEditorScene(CyberiadaSMModel* _model, QObject *_parent):
-    QGraphicsScene(_parent), model(_model), currentSM(NULL)
+    QGraphicsScene(_parent), model(_model), currentSM(NULL), buildTotal(0), buildDone(0)
 {
+    itemRegistry.setSpatialIndex(&spatialIndex);
     // gridSize = 25;
     // gridEnabled = true;
     // gridSnap = true;
@@ -60,16 +78,31 @@ CyberiadaSMEditorScene::CyberiadaSMEditorScene(CyberiadaSMModel* _model, QObject
 
 	setBackgroundBrush(Qt::white);
     connect(this, &QGraphicsScene::selectionChanged, this, &CyberiadaSMEditorScene::slotSelectionChanged);
-    connect(model, &CyberiadaSMModel::dataChanged, this, &CyberiadaSMEditorScene::slotModelDataChanged);
+    connect(model, &CyberiadaSMModel::elementChanged, this, &CyberiadaSMEditorScene::slotModelElementChanged);
+    connect(model, &CyberiadaSMModel::elementIDChanged, this, &CyberiadaSMEditorScene::slotModelElementIDChanged);
+    connect(model, &CyberiadaSMModel::elementInserted, this, &CyberiadaSMEditorScene::slotModelElementInserted);
+    connect(model, &CyberiadaSMModel::elementAboutToBeRemoved, this, &CyberiadaSMEditorScene::slotModelElementAboutToBeRemoved);
+    buildTimer.setInterval(0);
+    connect(&buildTimer, &QTimer::timeout, this, &CyberiadaSMEditorScene::slotBuildSlice);
+    pageReleaseTimer.setSingleShot(true);
+    connect(&pageReleaseTimer, &QTimer::timeout, this, &CyberiadaSMEditorScene::slotReleaseHiddenPages);
     reset();
 }
 
 CyberiadaSMEditorScene::~CyberiadaSMEditorScene()
 {
+    qDeleteAll(dotPool);
+    dotPool.clear();
 }
 
 void CyberiadaSMEditorScene::reset()
 {
+	stopBuild();
+	pageReleaseTimer.stop();
+	itemRegistry.clear();
+	pages.clear();
+	pageStates.clear();
+	currentSM = NULL;
 	clear();
 	setSceneRect(DEFAULT_SCENE_X,
 				 DEFAULT_SCENE_Y,
@@ -87,7 +120,7 @@ void CyberiadaSMEditorScene::slotSelectionChanged() {
             }
         }
         if (currItem == nullptr) return;
-        Cyberiada::ID item_id = elementIdToItemMap.key(currItem);
+        Cyberiada::ID item_id = itemRegistry.key(currItem);
         const Cyberiada::Element* element = model->idToElement(QString::fromStdString(item_id));
 
         if(!element) return;
@@ -95,7 +128,10 @@ void CyberiadaSMEditorScene::slotSelectionChanged() {
 		QModelIndex index = model->elementToIndex(element);
         CyberiadaSMEditorWindow* p = dynamic_cast<CyberiadaSMEditorWindow*>(parent());
         //p->SMView->setCurrentIndex(index);
-		p->SMView->select(index);
+        // the scene can be used without the window (e.g. by the benchmarks)
+        if (p) {
+            p->SMView->select(index);
+        }
 	}
 }
 
@@ -106,11 +142,20 @@ void CyberiadaSMEditorScene::slotElementSelected(const QModelIndex& index)
         const Cyberiada::ID element_id = element->get_id().c_str();
         MY_ASSERT(element);
 
+        // the other state machine replaces the current one on the scene
+        Cyberiada::Element* sm = element;
+        while (sm && sm->get_type() != Cyberiada::elementSM) {
+            sm = sm->get_parent();
+        }
+        if (sm && sm != currentSM) {
+            activateStateMachine(static_cast<Cyberiada::StateMachine*>(sm));
+        }
+
         blockSignals(true);
         clearSelection();
         blockSignals(false);
 
-        QGraphicsItem* item = elementIdToItemMap.value(element_id);
+        QGraphicsItem* item = itemRegistry.value(element_id);
         if (item) {
             blockSignals(true);
             item->setSelected(true);
@@ -143,7 +188,7 @@ void CyberiadaSMEditorScene::slotElementSelected(const QModelIndex& index)
 
 void CyberiadaSMEditorScene::updateItemsRecursively(CyberiadaSMEditorAbstractItem* parent, Cyberiada::ElementCollection* collection)
 {
-    CyberiadaSMEditorAbstractItem* current_item = static_cast<CyberiadaSMEditorAbstractItem*>(elementIdToItemMap.value(collection->get_id()));
+    CyberiadaSMEditorAbstractItem* current_item = static_cast<CyberiadaSMEditorAbstractItem*>(itemRegistry.value(collection->get_id()));
     current_item->syncFromModel();
 
     // updating children
@@ -158,56 +203,122 @@ void CyberiadaSMEditorScene::updateItemsRecursively(CyberiadaSMEditorAbstractIte
 
 void CyberiadaSMEditorScene::deleteItemsRecursively(Cyberiada::Element *element)
 {
-    Cyberiada::ElementType type = element->get_type();
+    // the transitions connected to the subtree from the outside are found by the model index
+    QList<Cyberiada::Element*> elements = model->incidentTransitions(element);
+    for (Cyberiada::Element* transition : elements) {
+        QGraphicsItem* item = itemRegistry.value(transition->get_id());
+        itemRegistry.remove(transition->get_id());
+        delete item;
+    }
 
-    if(type == Cyberiada::elementCompositeState || type == Cyberiada::elementSM || type == Cyberiada::elementRoot) {
-        while(element->has_children()){
-            Cyberiada::ElementCollection* collection = static_cast<Cyberiada::ElementCollection*>(element);
-            const Cyberiada::ElementList& children = collection->get_children();
-            Cyberiada::Element* child = children.at(0);
-            deleteItemsRecursively(child);
-        }
+    // remove element
+    QGraphicsItem* item = itemRegistry.value(element->get_id());
+    forgetItemsRecursively(element);
+    // the nested items are deleted with their parent
+    delete item;
+
+    elements.append(element);
+    model->deleteElements(elements);
+}
+
+void CyberiadaSMEditorScene::slotModelElementChanged(const QModelIndex& index, CyberiadaSMModel::ChangeKinds kinds)
+{
+    Cyberiada::Element* element = model->indexToElement(index);
+    if (element == nullptr) return;
+    // поиск CyberiadaSMEditorAbstractItem по реестру элементов itemRegistry
+    // updateItemsRecursively(nullptr, static_cast<Cyberiada::ElementCollection*>(element));
+    CyberiadaSMEditorAbstractItem* current_item = dynamic_cast<CyberiadaSMEditorAbstractItem*>(itemRegistry.value(element->get_id()));
+    if (current_item != nullptr) {
+        current_item->syncFromModel(kinds);
+    }
+    if (kinds & (CyberiadaSMModel::ChangeGeometry | CyberiadaSMModel::ChangeParent)) {
+        invalidateBounds(element);
     }
+    // the items repaint themselves; the hierarchy changes may leave traces of the old parents
+    if (kinds & CyberiadaSMModel::ChangeParent) {
+        update();
+    }
+}
 
-    // remove transitions
-    QList<Cyberiada::ID> toRemove;
-    for (auto it = elementIdToItemMap.begin(); it != elementIdToItemMap.end(); ++it) {
-        QGraphicsItem* item = it.value();
+void CyberiadaSMEditorScene::slotModelElementIDChanged(const QModelIndex& index, const QString& old_id)
+{
+    Cyberiada::Element* element = model->indexToElement(index);
+    if (element == nullptr) return;
+    // the item keeps its registry slot, only the key is replaced
+    itemRegistry.rename(old_id.toStdString(), element->get_id());
+}
 
-        auto* transition = dynamic_cast<CyberiadaSMEditorTransitionItem*>(item);
-        if (transition) {
-            if(transition->sourceId() == element->get_id() || transition->targetId() == element->get_id()) {
-                toRemove.append(it.key());
-                QModelIndex i = transition->getIndex();
-                delete transition;
-                model->deleteElement(i);
-            }
+void CyberiadaSMEditorScene::invalidateBounds(Cyberiada::Element* element)
+{
+    // the transitions are top level items, their state machine is found by the elements
+    if (element->get_type() == Cyberiada::elementTransition) {
+        element = element->get_parent();
+    }
+    for (; element; element = element->get_parent()) {
+        CyberiadaSMEditorAbstractItem* item = dynamic_cast<CyberiadaSMEditorAbstractItem*>(itemRegistry.value(element->get_id()));
+        if (item) {
+            item->invalidateBounds();
+            return;
         }
     }
-    for (const Cyberiada::ID& id : toRemove) {
-        elementIdToItemMap.remove(id);
+}
+
+void CyberiadaSMEditorScene::slotModelElementInserted(const QModelIndex& index)
+{
+    if (!index.isValid()) return;
+    Cyberiada::Element* element = model->indexToElement(index);
+    if (element && element->get_parent()) {
+        invalidateBounds(element->get_parent());
     }
+    // the editor creates the items itself, only the elements restored by undo / redo are added here
+    if (!model->isApplyingDelta()) return;
+    if (element == nullptr || itemRegistry.contains(element->get_id())) return;
+    Cyberiada::Element* parent_element = element->get_parent();
+    if (parent_element == nullptr) return;
+    QGraphicsItem* parent_item = containerItem(parent_element);
+    if (parent_item == nullptr) return;
+    addElementItem(parent_item, element);
+}
 
-    // remove element
-    CyberiadaSMEditorAbstractItem* citem = dynamic_cast<CyberiadaSMEditorAbstractItem*>(elementIdToItemMap.value(element->get_id()));
-    Cyberiada::ElementCollection* parent_element = dynamic_cast<Cyberiada::ElementCollection*>(element->get_parent());
-    MY_ASSERT(parent_element);
-    elementIdToItemMap.remove(element->get_id());
-    QModelIndex i = citem->getIndex();
-    delete citem;
-    model->deleteElement(i);
+void CyberiadaSMEditorScene::slotModelElementAboutToBeRemoved(const QModelIndex& index)
+{
+    if (!model->isApplyingDelta() || !index.isValid()) return;
+    Cyberiada::Element* element = model->indexToElement(index);
+    if (element == nullptr) return;
+    QGraphicsItem* item = itemRegistry.value(element->get_id());
+    forgetItemsRecursively(element);
+    // the nested items are deleted with their parent
+    delete item;
 }
 
-void CyberiadaSMEditorScene::slotModelDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight)
+void CyberiadaSMEditorScene::forgetItemsRecursively(Cyberiada::Element* element)
 {
-    Cyberiada::Element* element = model->indexToElement(topLeft);
-    // поиск CyberiadaSMEditorAbstractItem по QMap QMap<Cyberiada::ID, QGraphicsItem*> elementIdToItemMap;
-    // updateItemsRecursively(nullptr, static_cast<Cyberiada::ElementCollection*>(element));
-    CyberiadaSMEditorAbstractItem* current_item = dynamic_cast<CyberiadaSMEditorAbstractItem*>(elementIdToItemMap.value(element->get_id()));
-    if (current_item != nullptr) {
-        current_item->syncFromModel();
+    itemRegistry.remove(element->get_id());
+    if (element->get_type() == Cyberiada::elementSM) {
+        pages.removeAll(element->get_id());
+        pageStates.erase(element->get_id());
+        if (element == currentSM) {
+            currentSM = NULL;
+        }
     }
-    update();
+    if (element->has_children()) {
+        const Cyberiada::ElementList& children = static_cast<Cyberiada::ElementCollection*>(element)->get_children();
+        for (Cyberiada::ElementList::const_iterator i = children.begin(); i != children.end(); i++) {
+            QGraphicsItem* child_item = itemRegistry.value((*i)->get_id());
+            forgetItemsRecursively(*i);
+            // the transitions are top level items, they are not deleted with the item of their parent
+            if ((*i)->get_type() == Cyberiada::elementTransition) {
+                delete child_item;
+            }
+        }
+    }
+}
+
+void CyberiadaSMEditorScene::mouseReleaseEvent(QGraphicsSceneMouseEvent* event)
+{
+    QGraphicsScene::mouseReleaseEvent(event);
+    // the drag is over: the next geometry change starts a new undo command
+    model->undoStack()->seal();
 }
 
 void CyberiadaSMEditorScene::slotSMSizeChanged(CyberiadaSMEditorAbstractItem::CornerFlags side, qreal d)
@@ -215,8 +326,112 @@ void CyberiadaSMEditorScene::slotSMSizeChanged(CyberiadaSMEditorAbstractItem::Co
     // TODO
 }
 
+void CyberiadaSMEditorScene::scheduleDirtyFlush()
+{
+    if (!dirtyFlushScheduled) {
+        // the queued call is delivered before the repaint requested by the moves of this event
+        dirtyFlushScheduled = true;
+        QMetaObject::invokeMethod(this, "slotFlushDirtyTransitions", Qt::QueuedConnection);
+    }
+}
+
+void CyberiadaSMEditorScene::markTransitionDirty(CyberiadaSMEditorTransitionItem* transition)
+{
+    dirtyTransitions.insert(transition);
+    scheduleDirtyFlush();
+}
+
+void CyberiadaSMEditorScene::unmarkTransitionDirty(CyberiadaSMEditorTransitionItem* transition)
+{
+    dirtyTransitions.remove(transition);
+}
+
+void CyberiadaSMEditorScene::markGeometryDirty(CyberiadaSMEditorAbstractItem* item)
+{
+    // the descendants reached from the flush are already in the walked subtree
+    if (geometryFlushing) return;
+    dirtyGeometry.insert(item);
+    scheduleDirtyFlush();
+}
+
+void CyberiadaSMEditorScene::unmarkGeometryDirty(CyberiadaSMEditorAbstractItem* item)
+{
+    dirtyGeometry.remove(item);
+}
+
+void CyberiadaSMEditorScene::flushDirtyGeometry()
+{
+    if (dirtyGeometry.isEmpty()) return;
+    QSet<CyberiadaSMEditorAbstractItem*> roots;
+    roots.swap(dirtyGeometry);
+    QSet<QGraphicsItem*> visited;
+    QList<QGraphicsItem*> stack;
+    geometryFlushing = true;
+    for (QSet<CyberiadaSMEditorAbstractItem*>::const_iterator i = roots.constBegin(); i != roots.constEnd(); i++) {
+        stack.append(*i);
+        while (!stack.isEmpty()) {
+            QGraphicsItem* item = stack.takeLast();
+            if (visited.contains(item)) continue;
+            visited.insert(item);
+            CyberiadaSMEditorAbstractItem* a = dynamic_cast<CyberiadaSMEditorAbstractItem*>(item);
+            if (a) {
+                // the transitions connected to the item are marked dirty and flushed below
+                a->applyParentGeometryChange();
+            }
+            stack.append(item->childItems());
+        }
+    }
+    geometryFlushing = false;
+}
+
+DotSignal* CyberiadaSMEditorScene::acquireDot(QGraphicsItem* owner, const QPointF& pos)
+{
+    MY_ASSERT(owner);
+    DotSignal* dot;
+    if (dotPool.isEmpty()) {
+        dot = new DotSignal(pos, owner);
+    } else {
+        dot = dotPool.takeLast();
+        dot->setPos(pos);
+        dot->setParentItem(owner);
+        dot->setVisible(true);
+    }
+    return dot;
+}
+
+void CyberiadaSMEditorScene::releaseDot(DotSignal* dot)
+{
+    MY_ASSERT(dot);
+    dot->setVisible(false);
+    // the dot without the parent is a top level item of the scene until it is removed
+    dot->setParentItem(NULL);
+    if (dot->scene()) {
+        dot->scene()->removeItem(dot);
+    }
+    if (dotPool.size() >= SCENE_DOT_POOL_SIZE) {
+        // the dot may be released from its own signal
+        dot->deleteLater();
+        return;
+    }
+    dot->reset();
+    dotPool.append(dot);
+}
+
+void CyberiadaSMEditorScene::slotFlushDirtyTransitions()
+{
+    flushDirtyGeometry();
+    dirtyFlushScheduled = false;
+    QSet<CyberiadaSMEditorTransitionItem*> transitions;
+    transitions.swap(dirtyTransitions);
+    for (QSet<CyberiadaSMEditorTransitionItem*>::const_iterator i = transitions.constBegin(); i != transitions.constEnd(); i++) {
+        (*i)->updateEndsGeometry();
+    }
+}
+
 void CyberiadaSMEditorScene::slotGridSettingsChanged()
 {
+    gridTile = QPixmap();
+    gridTileScale = 0;
     update();
 }
 
@@ -224,92 +439,90 @@ void CyberiadaSMEditorScene::addItemsRecursively(QGraphicsItem* parent, Cyberiad
 {
 	Cyberiada::ElementType parent_type = collection->get_type();
     QGraphicsItem* new_parent = parent;
-    qDebug() << "parent=null" <<  (new_parent == NULL);
 
     if (parent_type == Cyberiada::elementSM) {
         new_parent = new CyberiadaSMEditorSMItem(model, collection, parent);
-        elementIdToItemMap.insert(collection->get_id(), new_parent);
+        itemRegistry.insert(collection->get_id(), new_parent);
         addItem(new_parent);
         new_parent->setSelected(true);
     }
 
-    qDebug() << "PARENT: " << collection->get_id().c_str();
     if (collection->has_children()) {
 		const Cyberiada::ElementList& children = collection->get_children();
 		for (Cyberiada::ElementList::const_iterator i = children.begin(); i != children.end(); i++) {
-			Cyberiada::Element* child = *i;
-            Cyberiada::ElementType type = child->get_type();
-
-			switch(type) {
-            case Cyberiada::elementCompositeState: {
-                CyberiadaSMEditorStateItem* state = new CyberiadaSMEditorStateItem(this, model, child, new_parent);
-                elementIdToItemMap.insert(child->get_id(), state);
-                qDebug() << "add item" << child->get_id().c_str() << "type" << type << "parent" << elementIdToItemMap.key(new_parent).c_str() << model->elementToIndex(child);
-                addItemsRecursively(state->getRegion(), static_cast<Cyberiada::ElementCollection*>(child));
-                addItem(state);
-                break;
-            }
-            case Cyberiada::elementSimpleState: {
-                CyberiadaSMEditorStateItem* state = new CyberiadaSMEditorStateItem(this, model, child, new_parent);
-                elementIdToItemMap.insert(child->get_id(), state);
-                addItem(state);
-                qDebug() << "add item" << child->get_id().c_str() << "type" << type << "parent" << elementIdToItemMap.key(new_parent).c_str() << model->elementToIndex(child);
-				break;
-            }
-            case Cyberiada::elementInitial: {
-                CyberiadaSMEditorVertexItem* initial = new CyberiadaSMEditorVertexItem(model, child, new_parent);
-                elementIdToItemMap.insert(child->get_id(), initial);
-                addItem(initial);
-                qDebug() << "add item" << child->get_id().c_str() << "type" << type << "parent" << elementIdToItemMap.key(new_parent).c_str() << model->elementToIndex(child);
-                break;
-            }
-            case Cyberiada::elementFinal: {
-                CyberiadaSMEditorVertexItem* final = new CyberiadaSMEditorVertexItem(model, child, new_parent);
-                elementIdToItemMap.insert(child->get_id(), final);
-                addItem(final);
-                qDebug() << "add item" << child->get_id().c_str() << "type" << type << "parent" << elementIdToItemMap.key(new_parent).c_str() << model->elementToIndex(child);
-                break;
-            }
-            case Cyberiada::elementTerminate: {
-                CyberiadaSMEditorVertexItem* terminate = new CyberiadaSMEditorVertexItem(model, child, new_parent);
-                elementIdToItemMap.insert(child->get_id(), terminate);
-                addItem(terminate);
-                qDebug() << "add item" << child->get_id().c_str() << "type" << type << "parent" << elementIdToItemMap.key(new_parent).c_str() << model->elementToIndex(child);
-                break;
-            }
-			case Cyberiada::elementChoice:
-                // new CyberiadaSMEditorChoiceItem(model, child, new_parent);
-				break;
-            case Cyberiada::elementComment: {
-                if (!child->has_geometry()) break;
-                CyberiadaSMEditorCommentItem* comment = new CyberiadaSMEditorCommentItem(this, model, child, new_parent, elementIdToItemMap);
-                elementIdToItemMap.insert(child->get_id(), comment);
-                addItem(comment);
-                qDebug() << "add item" << child->get_id().c_str() << "type" << type << "parent" << elementIdToItemMap.key(new_parent).c_str() << model->elementToIndex(child);
-                break;
-            }
-            case Cyberiada::elementFormalComment: {
-                if (!child->has_geometry()) break;
-                CyberiadaSMEditorCommentItem* formalComment = new CyberiadaSMEditorCommentItem(this, model, child, new_parent, elementIdToItemMap);
-                elementIdToItemMap.insert(child->get_id(), formalComment);
-                addItem(formalComment);
-                qDebug() << "add item" << child->get_id().c_str() << "type" << type << "parent" << elementIdToItemMap.key(new_parent).c_str() << model->elementToIndex(child);
-                break;
-            }
-            case Cyberiada::elementTransition: {
-                CyberiadaSMEditorTransitionItem* transition = new CyberiadaSMEditorTransitionItem(this, model, child, NULL, elementIdToItemMap);
-                elementIdToItemMap.insert(child->get_id(), transition);
-                addItem(transition);
-                qDebug() << "add item" << child->get_id().c_str() << "type" << type << "parent" << elementIdToItemMap.key(new_parent).c_str() << model->elementToIndex(child);
-                break;
-            }
-			default:
-				MY_ASSERT(false);
-			}
+			addElementItem(new_parent, *i);
 		}
     }
 }
 
+void CyberiadaSMEditorScene::addElementItem(QGraphicsItem* new_parent, Cyberiada::Element* child, bool recursive)
+{
+    Cyberiada::ElementType type = child->get_type();
+
+    switch(type) {
+    case Cyberiada::elementCompositeState: {
+        CyberiadaSMEditorStateItem* state = new CyberiadaSMEditorStateItem(this, model, child, new_parent);
+        itemRegistry.insert(child->get_id(), state);
+        if (recursive) {
+            addItemsRecursively(state->getRegion(), static_cast<Cyberiada::ElementCollection*>(child));
+        }
+        addItem(state);
+        break;
+    }
+    case Cyberiada::elementSimpleState: {
+        CyberiadaSMEditorStateItem* state = new CyberiadaSMEditorStateItem(this, model, child, new_parent);
+        itemRegistry.insert(child->get_id(), state);
+        addItem(state);
+        break;
+    }
+    case Cyberiada::elementInitial: {
+        CyberiadaSMEditorVertexItem* initial = new CyberiadaSMEditorVertexItem(model, child, new_parent);
+        itemRegistry.insert(child->get_id(), initial);
+        addItem(initial);
+        break;
+    }
+    case Cyberiada::elementFinal: {
+        CyberiadaSMEditorVertexItem* final = new CyberiadaSMEditorVertexItem(model, child, new_parent);
+        itemRegistry.insert(child->get_id(), final);
+        addItem(final);
+        break;
+    }
+    case Cyberiada::elementTerminate: {
+        CyberiadaSMEditorVertexItem* terminate = new CyberiadaSMEditorVertexItem(model, child, new_parent);
+        itemRegistry.insert(child->get_id(), terminate);
+        addItem(terminate);
+        break;
+    }
+    case Cyberiada::elementChoice:
+        // new CyberiadaSMEditorChoiceItem(model, child, new_parent);
+        break;
+    case Cyberiada::elementComment: {
+        if (!child->has_geometry()) break;
+        CyberiadaSMEditorCommentItem* comment = new CyberiadaSMEditorCommentItem(this, model, child, new_parent, itemRegistry);
+        itemRegistry.insert(child->get_id(), comment);
+        addItem(comment);
+        break;
+    }
+    case Cyberiada::elementFormalComment: {
+        if (!child->has_geometry()) break;
+        CyberiadaSMEditorCommentItem* formalComment = new CyberiadaSMEditorCommentItem(this, model, child, new_parent, itemRegistry);
+        itemRegistry.insert(child->get_id(), formalComment);
+        addItem(formalComment);
+        break;
+    }
+    case Cyberiada::elementTransition: {
+        CyberiadaSMEditorTransitionItem* transition = new CyberiadaSMEditorTransitionItem(this, model, child, NULL, itemRegistry);
+        itemRegistry.insert(child->get_id(), transition);
+        // the transitions are top level items: the one restored by undo on a hidden page stays hidden
+        transition->setVisible(stateMachineOf(child) == currentSM);
+        addItem(transition);
+        break;
+    }
+    default:
+        MY_ASSERT(false);
+    }
+}
+
 // void CyberiadaSMEditorScene::setGridSize(int newSize)
 // {
 //     if (newSize > 0) {
@@ -332,34 +545,298 @@ void CyberiadaSMEditorScene::addItemsRecursively(QGraphicsItem* parent, Cyberiad
 void CyberiadaSMEditorScene::setGridPen(const QPen &pen)
 {
     gridPen = pen;
+    gridTile = QPixmap();
+    gridTileScale = 0;
     update();
 }
 
 void CyberiadaSMEditorScene::loadScene()
 {
-    elementIdToItemMap.clear();
+    stopBuild();
+    pageReleaseTimer.stop();
+    itemRegistry.clear();
+    pages.clear();
+    pageStates.clear();
+    currentSM = NULL;
 
     clear();
 
-    MY_ASSERT(elementIdToItemMap.isEmpty());
+    MY_ASSERT(itemRegistry.isEmpty());
     MY_ASSERT(items().isEmpty());
 
     Cyberiada::StateMachine* sm = static_cast<Cyberiada::StateMachine*>(model->indexToElement(model->firstSMIndex()));
+    activateStateMachine(sm);
+}
+
+void CyberiadaSMEditorScene::activateStateMachine(Cyberiada::StateMachine* sm)
+{
+    MY_ASSERT(sm);
+    if (sm == currentSM) return;
+    // the unfinished page is completed when it is activated next time
+    stopBuild();
+    if (currentSM) {
+        hidePage(currentSM);
+    }
     currentSM = sm;
-    addItemsRecursively(NULL, sm);
-    for (auto item : items()) {
-        if (auto smItem = dynamic_cast<CyberiadaSMEditorSMItem*>(item)) {
-            connect(smItem, &CyberiadaSMEditorAbstractItem::sizeChanged, this, &CyberiadaSMEditorScene::slotSMSizeChanged);
+    buildClock.start();
+
+    CyberiadaSMEditorSMItem* smItem = static_cast<CyberiadaSMEditorSMItem*>(itemRegistry.value(sm->get_id()));
+    bool built = smItem != nullptr;
+    if (built) {
+        setPageVisible(sm, true);
+    } else {
+        // the state machine item is created at once to set up the view, the rest is built in slices
+        smItem = new CyberiadaSMEditorSMItem(model, sm, NULL);
+        itemRegistry.insert(sm->get_id(), smItem);
+        addItem(smItem);
+        connect(smItem, &CyberiadaSMEditorAbstractItem::sizeChanged, this, &CyberiadaSMEditorScene::slotSMSizeChanged);
+    }
+    blockSignals(true);
+    clearSelection();
+    smItem->setSelected(true);
+    blockSignals(false);
+
+    pages.removeAll(sm->get_id());
+    pages.prepend(sm->get_id());
+    while (pages.size() > SCENE_MAX_PAGES) {
+        releasePage(pages.takeLast());
+    }
+
+    qreal margin = DEFAULT_SCENE_BORDER_MARGIN;
+    QRectF bounds = smItem->sceneBoundingRect();
+    if (built) {
+        bounds |= smItem->mapRectToScene(smItem->childrenBoundingRect());
+    }
+    setSceneRect(bounds.adjusted(-margin, -margin, margin, margin));
+    QGraphicsView* view = views().first();
+    std::unordered_map<Cyberiada::ID, PageState>::iterator state = pageStates.find(sm->get_id());
+    if (built && state != pageStates.end()) {
+        // the page is shown with the zoom and the scroll it was left with
+        view->setTransform(state->second.transform);
+        view->centerOn(state->second.center);
+    } else {
+        view->fitInView(sceneRect(), Qt::KeepAspectRatio);
+    }
+    if (state != pageStates.end()) {
+        pageStates.erase(state);
+    }
+    buildVisibleRect = view->mapToScene(view->viewport()->rect()).boundingRect();
+
+    buildTotal = countElements(sm, false);
+    buildDone = countElements(sm, true);
+    enqueueChildren(sm);
+    // the visible part is shown with the first frame
+    slotBuildSlice();
+}
+
+void CyberiadaSMEditorScene::setPageVisible(Cyberiada::Element* element, bool visible)
+{
+    QGraphicsItem* item = itemRegistry.value(element->get_id());
+    // the nested items follow their parents, only the state machine and the transitions are top level items
+    if (item && (element->get_type() == Cyberiada::elementSM || element->get_type() == Cyberiada::elementTransition)) {
+        item->setVisible(visible);
+    }
+    if (element->has_children()) {
+        const Cyberiada::ElementList& children = static_cast<Cyberiada::ElementCollection*>(element)->get_children();
+        for (Cyberiada::ElementList::const_iterator i = children.begin(); i != children.end(); i++) {
+            setPageVisible(*i, visible);
+        }
+    }
+}
+
+void CyberiadaSMEditorScene::hidePage(Cyberiada::Element* sm)
+{
+    setPageVisible(sm, false);
+    PageState state;
+    state.hiddenAt = QDateTime::currentMSecsSinceEpoch();
+    if (!views().isEmpty()) {
+        QGraphicsView* view = views().first();
+        state.transform = view->transform();
+        state.center = view->mapToScene(view->viewport()->rect().center());
+    }
+    pageStates[sm->get_id()] = state;
+    if (!pageReleaseTimer.isActive()) {
+        pageReleaseTimer.start(SCENE_PAGE_RELEASE_MSEC);
+    }
+}
+
+void CyberiadaSMEditorScene::releasePage(const Cyberiada::ID& sm_id)
+{
+    pageStates.erase(sm_id);
+    Cyberiada::Element* sm = model->idToElement(QString::fromStdString(sm_id));
+    if (sm == nullptr || sm == currentSM) return;
+    QGraphicsItem* item = itemRegistry.value(sm_id);
+    forgetItemsRecursively(sm);
+    delete item;
+}
+
+void CyberiadaSMEditorScene::slotReleaseHiddenPages()
+{
+    // the pages hidden for SCENE_PAGE_RELEASE_MSEC are released, the timer waits for the next one
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    qint64 next = -1;
+    QList<Cyberiada::ID> hidden = pages;
+    for (int i = 0; i < hidden.size(); i++) {
+        if (currentSM && hidden[i] == currentSM->get_id()) continue;
+        std::unordered_map<Cyberiada::ID, PageState>::const_iterator state = pageStates.find(hidden[i]);
+        if (state == pageStates.end()) continue;
+        qint64 left = SCENE_PAGE_RELEASE_MSEC - (now - state->second.hiddenAt);
+        if (left <= 0) {
+            pages.removeAll(hidden[i]);
+            releasePage(hidden[i]);
+        } else if (next < 0 || left < next) {
+            next = left;
+        }
+    }
+    if (next >= 0) {
+        pageReleaseTimer.start(int(next));
+    }
+}
+
+Cyberiada::Element* CyberiadaSMEditorScene::stateMachineOf(Cyberiada::Element* element) const
+{
+    while (element && element->get_type() != Cyberiada::elementSM) {
+        element = element->get_parent();
+    }
+    return element;
+}
+
+void CyberiadaSMEditorScene::slotStateMachineCollapsed(const QModelIndex& index)
+{
+    if (!model->isSMIndex(index)) return;
+    Cyberiada::Element* sm = model->indexToElement(index);
+    if (sm == nullptr || sm == currentSM) return;
+    pages.removeAll(sm->get_id());
+    releasePage(sm->get_id());
+}
+
+bool CyberiadaSMEditorScene::isBuilding() const
+{
+    return buildTimer.isActive();
+}
+
+void CyberiadaSMEditorScene::stopBuild()
+{
+    buildTimer.stop();
+    buildQueue.clear();
+    buildTransitions.clear();
+    buildTotal = buildDone = 0;
+}
+
+int CyberiadaSMEditorScene::countElements(const Cyberiada::Element* element, bool built) const
+{
+    int count = 0;
+    if (element->has_children()) {
+        const Cyberiada::ElementList& children = static_cast<const Cyberiada::ElementCollection*>(element)->get_children();
+        for (Cyberiada::ElementList::const_iterator i = children.begin(); i != children.end(); i++) {
+            if (!built || itemRegistry.contains((*i)->get_id())) {
+                count++;
+            }
+            count += countElements(*i, built);
+        }
+    }
+    return count;
+}
+
+QGraphicsItem* CyberiadaSMEditorScene::containerItem(Cyberiada::Element* element)
+{
+    QGraphicsItem* item = itemRegistry.value(element->get_id());
+    if (item == nullptr) return nullptr;
+    if (element->get_type() == Cyberiada::elementCompositeState ||
+        element->get_type() == Cyberiada::elementSimpleState) {
+        CyberiadaSMEditorStateItem* state = static_cast<CyberiadaSMEditorStateItem*>(item);
+        if (state->getRegion() == nullptr) {
+            // the region appears when the state becomes composite
+            state->syncFromModel(CyberiadaSMModel::ChangeParent);
+        }
+        if (state->getRegion() != nullptr) {
+            return state->getRegion();
+        }
+    }
+    return item;
+}
+
+void CyberiadaSMEditorScene::enqueueChildren(Cyberiada::Element* element)
+{
+    if (!element->has_children()) return;
+    QGraphicsItem* container = containerItem(element);
+    if (container == nullptr) return;
+    // the queue keeps the ids: the elements can be deleted or replaced before their turn comes
+    const Cyberiada::ElementList& children = static_cast<Cyberiada::ElementCollection*>(element)->get_children();
+    QList<Cyberiada::ID> visible;
+    for (Cyberiada::ElementList::const_iterator i = children.begin(); i != children.end(); i++) {
+        Cyberiada::Element* child = *i;
+        if (itemRegistry.contains(child->get_id())) {
+            // the page was built partially before
+            if (child->get_type() == Cyberiada::elementCompositeState) {
+                enqueueChildren(child);
+            }
+            continue;
+        }
+        if (child->get_type() == Cyberiada::elementTransition) {
+            // the transitions need the items of both ends
+            buildTransitions.append(child->get_id());
+            continue;
+        }
+        Cyberiada::Rect r = child->get_bound_rect(*(model->rootDocument()));
+        if (r.valid && container->mapRectToScene(QRectF(r.x, r.y, r.width, r.height)).intersects(buildVisibleRect)) {
+            visible.append(child->get_id());
+        } else {
+            buildQueue.append(child->get_id());
+        }
+    }
+    for (int i = visible.size() - 1; i >= 0; i--) {
+        buildQueue.prepend(visible[i]);
+    }
+}
+
+void CyberiadaSMEditorScene::slotBuildSlice()
+{
+    QElapsedTimer slice;
+    slice.start();
+    while (slice.elapsed() < SCENE_BUILD_SLICE_MSEC) {
+        if (!buildQueue.isEmpty()) {
+            Cyberiada::ID id = buildQueue.takeFirst();
+            Cyberiada::Element* element = model->idToElement(QString::fromStdString(id));
+            buildDone++;
+            if (element == nullptr || itemRegistry.contains(id) || element->get_parent() == nullptr) continue;
+            QGraphicsItem* container = containerItem(element->get_parent());
+            if (container == nullptr) continue;
+            addElementItem(container, element, false);
+            if (element->get_type() == Cyberiada::elementCompositeState) {
+                enqueueChildren(element);
+            }
+        } else if (!buildTransitions.isEmpty()) {
+            Cyberiada::ID id = buildTransitions.takeFirst();
+            Cyberiada::Element* element = model->idToElement(QString::fromStdString(id));
+            buildDone++;
+            if (element == nullptr || itemRegistry.contains(id)) continue;
+            // the transitions are taken after the state queue is drained: every end that gets an item has it,
+            // the transitions to the ends without items (choices, comments without geometry) use the centers
+            addElementItem(nullptr, element, false);
+        } else {
             break;
         }
     }
-    // qreal margin = std::max(itemsBoundingRect().width(), itemsBoundingRect().height()) * DEFAULT_SCENE_BORDER_MARGIN_PERCENT;
-    qreal margin = DEFAULT_SCENE_BORDER_MARGIN;
-    setSceneRect(itemsBoundingRect().adjusted(-margin, -margin, margin, margin));
-    qDebug() << "new scene rect" << sceneRect();
-    // views().first()->fitInView(itemsBoundingRect(), Qt::KeepAspectRatio);
-    views().first()->fitInView(sceneRect(), Qt::KeepAspectRatio);
-    update();
+
+    if (buildQueue.isEmpty() && buildTransitions.isEmpty()) {
+        buildTimer.stop();
+        // the hidden pages are not taken into account
+        QGraphicsItem* smItem = currentSM ? itemRegistry.value(currentSM->get_id()) : nullptr;
+        if (smItem) {
+            qreal margin = DEFAULT_SCENE_BORDER_MARGIN;
+            QRectF bounds = smItem->sceneBoundingRect() | smItem->mapRectToScene(smItem->childrenBoundingRect());
+            setSceneRect(bounds.adjusted(-margin, -margin, margin, margin));
+        }
+        emit buildProgress(buildTotal, buildTotal);
+        emit buildFinished(buildClock.elapsed());
+        buildTotal = buildDone = 0;
+    } else {
+        if (!buildTimer.isActive()) {
+            buildTimer.start();
+        }
+        emit buildProgress(buildDone, buildTotal);
+    }
 }
 
 void CyberiadaSMEditorScene::setCurrentTool(ToolType tool) {
@@ -388,19 +865,18 @@ void CyberiadaSMEditorScene::addSMItem(Cyberiada::ElementType type)
         if (currentSM == nullptr) {
             Cyberiada::Element* element = model->newStateMachine("New State Machine");
             currentSM = static_cast<Cyberiada::StateMachine*>(element);
+            pages.prepend(element->get_id());
             CyberiadaSMEditorSMItem* sm = new CyberiadaSMEditorSMItem(model, element, nullptr);
             parentCItem = sm;
             parentColl = static_cast<Cyberiada::ElementCollection*>(element);
-            elementIdToItemMap.insert(element->get_id(), sm);
+            itemRegistry.insert(element->get_id(), sm);
             addItem(sm);
             qDebug() << "add item" << element->get_id().c_str() << "type" << type;
         } else {
-            for (auto item : items()) {
-                if (auto smItem = dynamic_cast<CyberiadaSMEditorSMItem*>(item)) {
-                    parentCItem = smItem;
-                    parentColl = static_cast<Cyberiada::ElementCollection*>(smItem->getElement());
-                    break;
-                }
+            // the other state machines can be kept hidden on the scene
+            if (auto smItem = dynamic_cast<CyberiadaSMEditorSMItem*>(itemRegistry.value(currentSM->get_id()))) {
+                parentCItem = smItem;
+                parentColl = static_cast<Cyberiada::ElementCollection*>(smItem->getElement());
             }
         }
     }
@@ -422,9 +898,15 @@ void CyberiadaSMEditorScene::addSMItem(Cyberiada::ElementType type)
     case Cyberiada::elementSM: {
         try {
             Cyberiada::Element* element = model->newStateMachine("New State Machine", Cyberiada::Rect(sceneRect().center().x(), sceneRect().center().y(), 200, 100));
+            // the new state machine gets its own page
+            stopBuild();
+            if (currentSM) {
+                hidePage(currentSM);
+            }
             currentSM = static_cast<Cyberiada::StateMachine*>(element);
+            pages.prepend(element->get_id());
             CyberiadaSMEditorSMItem* sm = new CyberiadaSMEditorSMItem(model, element, nullptr);
-            elementIdToItemMap.insert(element->get_id(), sm);
+            itemRegistry.insert(element->get_id(), sm);
             addItem(sm);
             qDebug() << "add item" << element->get_id().c_str() << "type" << type;
             sm->setSelected(true);
@@ -442,9 +924,9 @@ void CyberiadaSMEditorScene::addSMItem(Cyberiada::ElementType type)
             Cyberiada::Element* element = model->newState(parentColl, "New state", Cyberiada::Action(),
                                                           Cyberiada::Rect(center.x(), center.y(), 200, 100));
             CyberiadaSMEditorStateItem* state = new CyberiadaSMEditorStateItem(this, model, element, parentCItem);
-            elementIdToItemMap.insert(element->get_id(), state);
+            itemRegistry.insert(element->get_id(), state);
             addItem(state);
-            qDebug() << "add item" << element->get_id().c_str() << "type" << type << "parent" << elementIdToItemMap.key(parentCItem).c_str();
+            qDebug() << "add item" << element->get_id().c_str() << "type" << type << "parent" << itemRegistry.key(parentCItem).c_str();
             state->setSelected(true);
             break;
         } catch (const Cyberiada::ParametersException& e){
@@ -462,9 +944,9 @@ void CyberiadaSMEditorScene::addSMItem(Cyberiada::ElementType type)
         try {
             Cyberiada::Element* element = model->newInitial(parentColl, Cyberiada::Point(center.x(), center.y()));
             CyberiadaSMEditorVertexItem* initial = new CyberiadaSMEditorVertexItem(model, element, parentCItem);
-            elementIdToItemMap.insert(element->get_id(), initial);
+            itemRegistry.insert(element->get_id(), initial);
             addItem(initial);
-            qDebug() << "add item" << element->get_id().c_str() << "type" << type << "parent" << elementIdToItemMap.key(parentCItem).c_str();
+            qDebug() << "add item" << element->get_id().c_str() << "type" << type << "parent" << itemRegistry.key(parentCItem).c_str();
             initial->setSelected(true);
             break;
         } catch (const Cyberiada::ParametersException& e){
@@ -478,9 +960,9 @@ void CyberiadaSMEditorScene::addSMItem(Cyberiada::ElementType type)
         try {
             Cyberiada::Element* element = model->newFinal(parentColl, Cyberiada::Point(center.x(), center.y()));
             CyberiadaSMEditorVertexItem* final = new CyberiadaSMEditorVertexItem(model, element, parentCItem);
-            elementIdToItemMap.insert(element->get_id(), final);
+            itemRegistry.insert(element->get_id(), final);
             addItem(final);
-            qDebug() << "add item" << element->get_id().c_str() << "type" << type << "parent" << elementIdToItemMap.key(parentCItem).c_str();
+            qDebug() << "add item" << element->get_id().c_str() << "type" << type << "parent" << itemRegistry.key(parentCItem).c_str();
             final->setSelected(true);
             break;
         } catch (const Cyberiada::ParametersException& e){
@@ -494,9 +976,9 @@ void CyberiadaSMEditorScene::addSMItem(Cyberiada::ElementType type)
         try {
             Cyberiada::Element* element = model->newTerminate(parentColl, Cyberiada::Point(center.x(), center.y()));
             CyberiadaSMEditorVertexItem* terminate = new CyberiadaSMEditorVertexItem(model, element, parentCItem);
-            elementIdToItemMap.insert(element->get_id(), terminate);
+            itemRegistry.insert(element->get_id(), terminate);
             addItem(terminate);
-            qDebug() << "add item" << element->get_id().c_str() << "type" << type << "parent" << elementIdToItemMap.key(parentCItem).c_str();
+            qDebug() << "add item" << element->get_id().c_str() << "type" << type << "parent" << itemRegistry.key(parentCItem).c_str();
             terminate->setSelected(true);
             break;
         } catch (const Cyberiada::ParametersException& e){
@@ -512,10 +994,10 @@ void CyberiadaSMEditorScene::addSMItem(Cyberiada::ElementType type)
     case Cyberiada::elementComment: {
         try {
             Cyberiada::Element* element = model->newComment(parentColl, "New comment", Cyberiada::Rect(center.x(), center.y(), 200, 100));
-            CyberiadaSMEditorCommentItem* comment = new CyberiadaSMEditorCommentItem(this, model, element, parentCItem, elementIdToItemMap);
-            elementIdToItemMap.insert(element->get_id(), comment);
+            CyberiadaSMEditorCommentItem* comment = new CyberiadaSMEditorCommentItem(this, model, element, parentCItem, itemRegistry);
+            itemRegistry.insert(element->get_id(), comment);
             addItem(comment);
-            qDebug() << "add item" << element->get_id().c_str() << "type" << type << "parent" << elementIdToItemMap.key(parentCItem).c_str();
+            qDebug() << "add item" << element->get_id().c_str() << "type" << type << "parent" << itemRegistry.key(parentCItem).c_str();
             comment->setSelected(true);
             break;
         } catch (const Cyberiada::ParametersException& e){
@@ -528,10 +1010,10 @@ void CyberiadaSMEditorScene::addSMItem(Cyberiada::ElementType type)
     case Cyberiada::elementFormalComment: {
         try {
             Cyberiada::Element* element = model->newFormalComment(parentColl, "New formal comment", Cyberiada::Rect(center.x(), center.y(), 200, 100));
-            CyberiadaSMEditorCommentItem* formalComment = new CyberiadaSMEditorCommentItem(this, model, element, parentCItem, elementIdToItemMap);
-            elementIdToItemMap.insert(element->get_id(), formalComment);
+            CyberiadaSMEditorCommentItem* formalComment = new CyberiadaSMEditorCommentItem(this, model, element, parentCItem, itemRegistry);
+            itemRegistry.insert(element->get_id(), formalComment);
             addItem(formalComment);
-            qDebug() << "add item" << element->get_id().c_str() << "type" << type << "parent" << elementIdToItemMap.key(parentCItem).c_str();
+            qDebug() << "add item" << element->get_id().c_str() << "type" << type << "parent" << itemRegistry.key(parentCItem).c_str();
             formalComment->setSelected(true);
             break;
         } catch (const Cyberiada::ParametersException& e){
@@ -544,10 +1026,10 @@ void CyberiadaSMEditorScene::addSMItem(Cyberiada::ElementType type)
     case Cyberiada::elementTransition: {
         try {
             // Cyberiada::Element* element = d->new_transition(currentSM, "New state", Cyberiada::Point(center.x(), center.y()));
-            // CyberiadaSMEditorTransitionItem* transition = new CyberiadaSMEditorTransitionItem(this, model, element, settings, NULL, elementIdToItemMap);
-            // elementIdToItemMap.insert(element->get_id(), transition);
+            // CyberiadaSMEditorTransitionItem* transition = new CyberiadaSMEditorTransitionItem(this, model, element, settings, NULL, itemRegistry);
+            // itemRegistry.insert(element->get_id(), transition);
             // addItem(transition);
-            // qDebug() << "add item" << element->get_id().c_str() << "type" << type << "parent" << elementIdToItemMap.key(parentCItem).c_str();
+            // qDebug() << "add item" << element->get_id().c_str() << "type" << type << "parent" << itemRegistry.key(parentCItem).c_str();
             break;
         } catch (const Cyberiada::ParametersException& e){
             QMessageBox::critical(NULL, tr("Create new transition"),
@@ -576,8 +1058,8 @@ void CyberiadaSMEditorScene::addTransitionFromTempopary(TemporaryTransition* ttr
                                                         ttrans->getSourcePoint(), ttrans->getTargetPoint());
         delete ttrans;
         CyberiadaSMEditorTransitionItem* transition =
-            new CyberiadaSMEditorTransitionItem(this, model, element, NULL, elementIdToItemMap);
-        elementIdToItemMap.insert(element->get_id(), transition);
+            new CyberiadaSMEditorTransitionItem(this, model, element, NULL, itemRegistry);
+        itemRegistry.insert(element->get_id(), transition);
         addItem(transition);
         transition->setSelected(true);
     } catch (const Cyberiada::ParametersException& e){
@@ -590,13 +1072,13 @@ void CyberiadaSMEditorScene::addTransitionFromTempopary(TemporaryTransition* ttr
 
 TemporaryTransition *CyberiadaSMEditorScene::addTemporaryTransition(CyberiadaSMEditorAbstractItem* source, QPointF targetPoint)
 {
-    TemporaryTransition* ttrans = new TemporaryTransition(this, model, NULL, elementIdToItemMap, source, targetPoint);
+    TemporaryTransition* ttrans = new TemporaryTransition(this, model, NULL, itemRegistry, source, targetPoint);
     addItem(ttrans);
     connect(ttrans, &TemporaryTransition::signalReady, this, &CyberiadaSMEditorScene::addTransitionFromTempopary);
     return ttrans;
 }
 
-void CyberiadaSMEditorScene::drawBackground(QPainter* painter, const QRectF &)
+void CyberiadaSMEditorScene::drawBackground(QPainter* painter, const QRectF& exposed)
 {
     SettingsManager& sm = SettingsManager::instance();
 
@@ -614,22 +1096,75 @@ void CyberiadaSMEditorScene::drawBackground(QPainter* painter, const QRectF &)
 		return ;
 	}
 
-	painter->setPen(gridPen);
-
-	QRectF rect = sceneRect();
+    QRectF rect = exposed & sceneRect();
+    if (rect.isEmpty()) {
+        return;
+    }
 
     int gridSize = sm.getGridSpacing();
+    qreal scale = painter->worldTransform().m11();
+    if (gridSize * scale < GRID_MIN_CELL_PIXELS) {
+        return;
+    }
 
-	double left = int(rect.left()) - (int(rect.left()) % gridSize);
-	double top = int(rect.top()) - (int(rect.top()) % gridSize);
+    // the tile is rendered at the exact scale of the view: a resampled tile blurs the 1 px lines
+    if (scale != gridTileScale) {
+        updateGridTile(gridSize, scale);
+    }
 
-	QVarLengthArray<QLineF, 100> lines;
+    if (gridTile.isNull()) {
+        // the tile would be too large, there are few lines to draw on the exposed part anyway
+        painter->setPen(gridPen);
+        double left = floor(rect.left() / gridSize) * gridSize;
+        double top = floor(rect.top() / gridSize) * gridSize;
+        QVector<QLineF> lines;
+        for (double x = left; x < rect.right(); x += gridSize)
+            lines.append(QLineF(x, rect.top(), x, rect.bottom()));
+        for (double y = top; y < rect.bottom(); y += gridSize)
+            lines.append(QLineF(rect.left(), y, rect.right(), y));
+        painter->drawLines(lines);
+        return;
+    }
 
-	for (double x = left; x < rect.right(); x += gridSize)
-		lines.append(QLineF(x, rect.top(), x, rect.bottom()));
-	for (double y = top; y < rect.bottom(); y += gridSize)
-		lines.append(QLineF(rect.left(), y, rect.right(), y));
+    // the tiles are aligned to the origin of the scene and drawn in the device pixels one by one,
+    // so the rounding of the tile size does not add up across the view
+    QTransform world = painter->worldTransform();
+    qreal left = floor(rect.left() / gridTileSize) * gridTileSize;
+    qreal top = floor(rect.top() / gridTileSize) * gridTileSize;
+    painter->save();
+    painter->setWorldTransform(QTransform());
+    painter->setClipRect(world.mapRect(rect), Qt::IntersectClip);
+    for (qreal y = top; y < rect.bottom(); y += gridTileSize) {
+        for (qreal x = left; x < rect.right(); x += gridTileSize) {
+            painter->drawPixmap(world.map(QPointF(x, y)).toPoint(), gridTile);
+        }
+    }
+    painter->restore();
+}
 
-	painter->drawLines(lines.data(), lines.size());
+void CyberiadaSMEditorScene::updateGridTile(int gridSize, qreal scale)
+{
+    gridTileScale = scale;
+    int cells = qMax(1, int(ceil(GRID_TILE_MIN_PIXELS / (gridSize * scale))));
+    int pixels = int(ceil(cells * gridSize * scale));
+    if (pixels > GRID_TILE_MAX_PIXELS) {
+        gridTile = QPixmap();
+        return;
+    }
+
+    gridTileSize = cells * gridSize;
+    gridTile = QPixmap(pixels, pixels);
+    gridTile.fill(Qt::transparent);
+
+    QPainter painter(&gridTile);
+    painter.setPen(gridPen);
+    painter.scale(scale, scale);
+    QVector<QLineF> lines;
+    // the lines on the far edges belong to the next tiles
+    for (int i = 0; i < cells; i++) {
+        lines.append(QLineF(i * gridSize, 0, i * gridSize, gridTileSize));
+        lines.append(QLineF(0, i * gridSize, gridTileSize, i * gridSize));
+    }
+    painter.drawLines(lines);
 }
 
@@ -34,11 +34,18 @@
 #include <QByteArrayList>
 #include <QList>
 #include <QGraphicsItem>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QPixmap>
+#include <QTransform>
 #include <QDebug>
 #include <string>
+#include <unordered_map>
 
 #include "cyberiadasm_model.h"
 #include "cyberiadasm_editor_items.h"
+#include "cyberiadasm_editor_item_registry.h"
+#include "cyberiadasm_editor_spatial_index.h"
 #include "cyberiadasm_editor_state_item.h"
 #include "cyberiadasm_editor_transition_item.h"
 #include "temporary_transition.h"
@@ -62,9 +69,14 @@ public:
     void  setGridPen(const QPen& gridPen);
     const QPen& getGridPen() const { return gridPen; }
 
+    // the items are created in time slices, visible ones first; see buildProgress / buildFinished
     void  loadScene();
+    bool  isBuilding() const;
+    // shows the state machine, the items of the recently shown ones are kept hidden
+    void  activateStateMachine(Cyberiada::StateMachine* sm);
 
-    QMap<Cyberiada::ID, QGraphicsItem*>& getMap() { return elementIdToItemMap; }
+    CyberiadaSMEditorItemRegistry& getRegistry() { return itemRegistry; }
+    CyberiadaSMEditorSpatialIndex& getSpatialIndex() { return spatialIndex; }
 
     void  setCurrentTool(ToolType tool);
     ToolType getCurrentTool() { return currentTool; }
@@ -75,34 +87,106 @@ public:
 
     void  deleteItemsRecursively(Cyberiada::Element* element);
 
+    // the transition is updated after its ends stop moving in the current event
+    void  markTransitionDirty(CyberiadaSMEditorTransitionItem* transition);
+    void  unmarkTransitionDirty(CyberiadaSMEditorTransitionItem* transition);
+    // the subtree of the item is updated together with the transitions
+    void  markGeometryDirty(CyberiadaSMEditorAbstractItem* item);
+    void  unmarkGeometryDirty(CyberiadaSMEditorAbstractItem* item);
+
+    // the grabbers are shown for the selected items only and are reused between the items
+    DotSignal* acquireDot(QGraphicsItem* owner, const QPointF& pos = QPointF());
+    void  releaseDot(DotSignal* dot);
+
 public slots:
 	void  slotElementSelected(const QModelIndex& index);
-    void  slotModelDataChanged(const QModelIndex & topLeft, const QModelIndex & bottomRight);
+    void  slotModelElementChanged(const QModelIndex& index, CyberiadaSMModel::ChangeKinds kinds);
+    void  slotModelElementIDChanged(const QModelIndex& index, const QString& old_id);
+    void  slotModelElementInserted(const QModelIndex& index);
+    void  slotModelElementAboutToBeRemoved(const QModelIndex& index);
     void  slotSMSizeChanged(CyberiadaSMEditorAbstractItem::CornerFlags side, qreal d);
 	
     // void  enableGrid(bool on = true);
     // void  enableGridSnap(bool on = true);
     void  slotGridSettingsChanged();
     void  slotSelectionChanged();
+    void  slotStateMachineCollapsed(const QModelIndex& index);
+    void  slotReleaseHiddenPages();
+
+signals:
+    void  buildProgress(int built, int total);
+    void  buildFinished(qint64 msec);
+
+private slots:
+    void  slotBuildSlice();
+    void  slotFlushDirtyTransitions();
 
 protected:
-    void  drawBackground(QPainter *painter, const QRectF &);
+    void  drawBackground(QPainter *painter, const QRectF& exposed);
+    void  mouseReleaseEvent(QGraphicsSceneMouseEvent* event) override;
 
 private:
     void  addItemsRecursively(QGraphicsItem* parent, Cyberiada::ElementCollection* element);
     void  updateItemsRecursively(CyberiadaSMEditorAbstractItem* parent, Cyberiada::ElementCollection* element);
+    void  addElementItem(QGraphicsItem* parent, Cyberiada::Element* element, bool recursive = true);
+    void  forgetItemsRecursively(Cyberiada::Element* element);
+    // the cached bounds of the items that contain the element are dropped
+    void  invalidateBounds(Cyberiada::Element* element);
+    // the item that holds the children items of the element
+    QGraphicsItem* containerItem(Cyberiada::Element* element);
+
+    void  stopBuild();
+    int   countElements(const Cyberiada::Element* element, bool built) const;
+    void  enqueueChildren(Cyberiada::Element* element);
+    void  setPageVisible(Cyberiada::Element* element, bool visible);
+    void  hidePage(Cyberiada::Element* sm);
+    void  releasePage(const Cyberiada::ID& sm_id);
+    Cyberiada::Element* stateMachineOf(Cyberiada::Element* element) const;
+    void  updateGridTile(int gridSize, qreal scale);
+    void  scheduleDirtyFlush();
+    void  flushDirtyGeometry();
 
 
     CyberiadaSMModel*              model;
 	Cyberiada::StateMachine*       currentSM;
-    QMap<Cyberiada::ID, QGraphicsItem*> elementIdToItemMap;
+    CyberiadaSMEditorSpatialIndex  spatialIndex;
+    CyberiadaSMEditorItemRegistry  itemRegistry;
 	
     // int                            gridSize;
     // bool                           gridEnabled;
     // bool                           gridSnap;
     QPen                           gridPen;
+    // the pre-rendered grid cells for the current zoom
+    QPixmap                        gridTile;
+    qreal                          gridTileSize = 0;
+    // the scale of the view the tile is rendered for
+    qreal                          gridTileScale = 0;
 
     ToolType currentTool = ToolType::Select;
+
+    QTimer                         buildTimer;
+    QElapsedTimer                  buildClock;
+    QTimer                         pageReleaseTimer;
+    QList<Cyberiada::ID>           buildQueue;
+    QList<Cyberiada::ID>           buildTransitions;
+    QRectF                         buildVisibleRect;
+    int                            buildTotal;
+    int                            buildDone;
+    QSet<CyberiadaSMEditorTransitionItem*> dirtyTransitions;
+    QSet<CyberiadaSMEditorAbstractItem*> dirtyGeometry;
+    bool                           dirtyFlushScheduled = false;
+    bool                           geometryFlushing = false;
+    // the released grabbers out of the scene
+    QList<DotSignal*>              dotPool;
+    // the ids of the state machines with the items, the most recently shown first
+    QList<Cyberiada::ID>           pages;
+    // the hidden pages are released after a while and shown again with the same view
+    struct PageState {
+        qint64                     hiddenAt;
+        QTransform                 transform;
+        QPointF                    center;
+    };
+    std::unordered_map<Cyberiada::ID, PageState> pageStates;
 };
 
 #endif
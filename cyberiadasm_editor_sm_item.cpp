@@ -53,6 +53,10 @@ CyberiadaSMEditorSMItem::CyberiadaSMEditorSMItem(CyberiadaSMModel* model,
 
 QRectF CyberiadaSMEditorSMItem::boundingRect() const
 {
+    if (boundsValid) {
+        return cachedBounds;
+    }
+
     MY_ASSERT(model);
     MY_ASSERT(model->rootDocument());
     MY_ASSERT(element);
@@ -61,9 +65,20 @@ QRectF CyberiadaSMEditorSMItem::boundingRect() const
     QRectF rect = toQtRect(r);
 
     if(!element->has_geometry()) {
-        return QRectF(rect.x() - rect.width() / 2, rect.y() - rect.height() / 2, rect.width(), rect.height());
+        cachedBounds = QRectF(rect.x() - rect.width() / 2, rect.y() - rect.height() / 2, rect.width(), rect.height());
+    } else {
+        cachedBounds = QRectF(- rect.width() / 2, - rect.height() / 2, rect.width(), rect.height());
     }
-    return QRectF(- rect.width() / 2, - rect.height() / 2, rect.width(), rect.height());
+    boundsValid = true;
+    return cachedBounds;
+}
+
+void CyberiadaSMEditorSMItem::invalidateBounds()
+{
+    if (!boundsValid) return;
+    // the scene index is updated with the old bounds still cached
+    prepareGeometryChange();
+    boundsValid = false;
 }
 
 
@@ -84,6 +99,7 @@ void CyberiadaSMEditorSMItem::paint(QPainter* painter, const QStyleOptionGraphic
     painter->setPen(pen);
     QRectF r = boundingRect();
     painter->drawRect(r);
+    if (paintDetailLevel(painter) == DetailLevel::Outline) return;
     const QPointF name_frame[] = {
         QPointF(r.left(), r.top()),
         QPointF(r.left() + 50, r.top()),
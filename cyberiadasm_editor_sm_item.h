@@ -40,6 +40,7 @@ public:
 
     // virtual QRectF boundingRect() const;
     QRectF boundingRect() const override;
+    void invalidateBounds() override;
 
     // virtual void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget);
 
@@ -47,6 +48,10 @@ public:
 
 private:
     void updateSizeToFitChildren(CyberiadaSMEditorAbstractItem* child) override;
+
+    // the bounds of the whole state machine are computed only after the changes
+    mutable QRectF cachedBounds;
+    mutable bool boundsValid = false;
 };
 
 
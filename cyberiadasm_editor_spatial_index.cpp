@@ -0,0 +1,377 @@
+/* -----------------------------------------------------------------------------
+ * The Cyberiada State Machine Editor
+ * -----------------------------------------------------------------------------
+ *
+ * The State Machine Editor Spatial Index
+ *
+ * Copyright (C) 2024 Alexey Fedoseev <aleksey@fedoseev.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see https://www.gnu.org/licenses/
+ *
+ * ----------------------------------------------------------------------------- */
+
+#include "cyberiadasm_editor_spatial_index.h"
+#include "cyberiadasm_editor_items.h"
+#include "myassert.h"
+
+// the node capacity of the R-tree
+static int SPATIAL_INDEX_MAX_ENTRIES = 16;
+static int SPATIAL_INDEX_MIN_ENTRIES = 4;
+
+static qreal rectArea(const QRectF& r)
+{
+    return r.width() * r.height();
+}
+
+static qreal enlargement(const QRectF& r, const QRectF& added)
+{
+    return rectArea(r.united(added)) - rectArea(r);
+}
+
+CyberiadaSMEditorSpatialIndex::CyberiadaSMEditorSpatialIndex()
+{
+    root = new Node;
+    root->parent = nullptr;
+    root->leaf = true;
+}
+
+CyberiadaSMEditorSpatialIndex::~CyberiadaSMEditorSpatialIndex()
+{
+    deleteNode(root);
+}
+
+void CyberiadaSMEditorSpatialIndex::insert(QGraphicsItem* item)
+{
+    MY_ASSERT(item);
+    // the item may be not in the scene yet, so its rect is taken by the next query
+    pending.insert(item);
+}
+
+void CyberiadaSMEditorSpatialIndex::remove(QGraphicsItem* item)
+{
+    pending.remove(item);
+    if (leafOf.contains(item)) {
+        removeEntry(item);
+    }
+}
+
+void CyberiadaSMEditorSpatialIndex::markDirty(QGraphicsItem* item)
+{
+    if (leafOf.contains(item)) {
+        pending.insert(item);
+    }
+}
+
+void CyberiadaSMEditorSpatialIndex::clear()
+{
+    deleteNode(root);
+    root = new Node;
+    root->parent = nullptr;
+    root->leaf = true;
+    leafOf.clear();
+    pending.clear();
+}
+
+CyberiadaSMEditorAbstractItem* CyberiadaSMEditorSpatialIndex::containerAt(const QPointF& point, const QGraphicsItem* ignored)
+{
+    return innermostAt(point, ignored, false);
+}
+
+CyberiadaSMEditorAbstractItem* CyberiadaSMEditorSpatialIndex::connectableAt(const QPointF& point)
+{
+    return innermostAt(point, nullptr, true);
+}
+
+void CyberiadaSMEditorSpatialIndex::flush()
+{
+    for (QSet<QGraphicsItem*>::const_iterator i = pending.constBegin(); i != pending.constEnd(); i++) {
+        QGraphicsItem* item = *i;
+        if (leafOf.contains(item)) {
+            removeEntry(item);
+        }
+        CyberiadaSMEditorAbstractItem* cItem = dynamic_cast<CyberiadaSMEditorAbstractItem*>(item);
+        if (cItem == nullptr || item->scene() == nullptr) {
+            continue;
+        }
+        int type = cItem->type();
+        if (type == CyberiadaSMEditorAbstractItem::SMItem ||
+            type == CyberiadaSMEditorAbstractItem::StateItem ||
+            type == CyberiadaSMEditorAbstractItem::CompositeStateItem ||
+            type == CyberiadaSMEditorAbstractItem::VertexItem) {
+            Entry entry;
+            entry.item = item;
+            entry.rect = item->sceneBoundingRect();
+            insertEntry(entry);
+        }
+    }
+    pending.clear();
+}
+
+CyberiadaSMEditorAbstractItem* CyberiadaSMEditorSpatialIndex::innermostAt(const QPointF& point, const QGraphicsItem* ignored, bool connectable)
+{
+    flush();
+    QVector<QGraphicsItem*> candidates;
+    search(root, point, candidates);
+
+    CyberiadaSMEditorAbstractItem* result = nullptr;
+    int resultDepth = -1;
+    for (int i = 0; i < candidates.size(); i++) {
+        QGraphicsItem* item = candidates[i];
+        // the items of the hidden state machines stay in the index
+        if (!item->isVisible()) continue;
+        if (ignored && (item == ignored || ignored->isAncestorOf(item))) continue;
+        CyberiadaSMEditorAbstractItem* cItem = static_cast<CyberiadaSMEditorAbstractItem*>(item);
+        int type = cItem->type();
+        if (connectable ? type == CyberiadaSMEditorAbstractItem::SMItem
+                        : type == CyberiadaSMEditorAbstractItem::VertexItem) {
+            continue;
+        }
+        if (!item->contains(item->mapFromScene(point))) continue;
+        int depth = 0;
+        for (QGraphicsItem* p = item->parentItem(); p; p = p->parentItem()) {
+            depth++;
+        }
+        if (depth > resultDepth ||
+            (depth == resultDepth && item->zValue() > result->zValue())) {
+            result = cItem;
+            resultDepth = depth;
+        }
+    }
+    return result;
+}
+
+void CyberiadaSMEditorSpatialIndex::search(const Node* node, const QPointF& point, QVector<QGraphicsItem*>& result) const
+{
+    if (node->leaf) {
+        for (int i = 0; i < node->entries.size(); i++) {
+            if (node->entries[i].rect.contains(point)) {
+                result.append(node->entries[i].item);
+            }
+        }
+        return;
+    }
+    for (int i = 0; i < node->children.size(); i++) {
+        if (node->children[i]->bounds.contains(point)) {
+            search(node->children[i], point, result);
+        }
+    }
+}
+
+void CyberiadaSMEditorSpatialIndex::insertEntry(const Entry& entry)
+{
+    Node* leaf = chooseLeaf(entry.rect);
+    leaf->entries.append(entry);
+    leafOf.insert(entry.item, leaf);
+
+    Node* node = leaf;
+    while (node) {
+        Node* sibling = nullptr;
+        if (node->count() > SPATIAL_INDEX_MAX_ENTRIES) {
+            sibling = split(node);
+        }
+        updateBounds(node);
+        if (sibling) {
+            updateBounds(sibling);
+            if (node == root) {
+                // the tree grows at the root
+                Node* newRoot = new Node;
+                newRoot->parent = nullptr;
+                newRoot->leaf = false;
+                newRoot->children.append(node);
+                newRoot->children.append(sibling);
+                node->parent = newRoot;
+                sibling->parent = newRoot;
+                root = newRoot;
+                updateBounds(root);
+                return;
+            }
+            sibling->parent = node->parent;
+            node->parent->children.append(sibling);
+        }
+        node = node->parent;
+    }
+}
+
+void CyberiadaSMEditorSpatialIndex::removeEntry(QGraphicsItem* item)
+{
+    Node* leaf = leafOf.take(item);
+    MY_ASSERT(leaf);
+    for (int i = 0; i < leaf->entries.size(); i++) {
+        if (leaf->entries[i].item == item) {
+            leaf->entries.remove(i);
+            break;
+        }
+    }
+
+    // the underfull nodes are dissolved and their entries are inserted again
+    QVector<Entry> orphans;
+    Node* node = leaf;
+    while (node != root) {
+        Node* parent = node->parent;
+        if (node->count() < SPATIAL_INDEX_MIN_ENTRIES) {
+            parent->children.removeOne(node);
+            collectEntries(node, orphans);
+            deleteNode(node);
+        } else {
+            updateBounds(node);
+        }
+        node = parent;
+    }
+    updateBounds(root);
+    while (!root->leaf && root->children.size() == 1) {
+        Node* child = root->children.first();
+        root->children.clear();
+        deleteNode(root);
+        root = child;
+        root->parent = nullptr;
+    }
+    if (!root->leaf && root->children.isEmpty()) {
+        root->leaf = true;
+    }
+
+    for (int i = 0; i < orphans.size(); i++) {
+        leafOf.remove(orphans[i].item);
+    }
+    for (int i = 0; i < orphans.size(); i++) {
+        insertEntry(orphans[i]);
+    }
+}
+
+CyberiadaSMEditorSpatialIndex::Node* CyberiadaSMEditorSpatialIndex::chooseLeaf(const QRectF& rect) const
+{
+    Node* node = root;
+    while (!node->leaf) {
+        Node* best = nullptr;
+        qreal bestEnlargement = 0;
+        for (int i = 0; i < node->children.size(); i++) {
+            Node* child = node->children[i];
+            qreal e = enlargement(child->bounds, rect);
+            if (best == nullptr || e < bestEnlargement ||
+                (e == bestEnlargement && rectArea(child->bounds) < rectArea(best->bounds))) {
+                best = child;
+                bestEnlargement = e;
+            }
+        }
+        node = best;
+    }
+    return node;
+}
+
+CyberiadaSMEditorSpatialIndex::Node* CyberiadaSMEditorSpatialIndex::split(Node* node)
+{
+    // the quadratic split by Guttman
+    int count = node->count();
+    QVector<QRectF> rects(count);
+    for (int i = 0; i < count; i++) {
+        rects[i] = node->leaf ? node->entries[i].rect : node->children[i]->bounds;
+    }
+
+    int seed1 = 0, seed2 = 1;
+    qreal worst = -1;
+    for (int i = 0; i < count; i++) {
+        for (int j = i + 1; j < count; j++) {
+            qreal waste = rectArea(rects[i].united(rects[j])) - rectArea(rects[i]) - rectArea(rects[j]);
+            if (waste > worst) {
+                worst = waste;
+                seed1 = i;
+                seed2 = j;
+            }
+        }
+    }
+
+    QVector<int> group(count, -1);
+    group[seed1] = 0;
+    group[seed2] = 1;
+    QRectF bounds[2] = { rects[seed1], rects[seed2] };
+    int sizes[2] = { 1, 1 };
+    int left = count - 2;
+    for (int i = 0; i < count; i++) {
+        if (group[i] >= 0) continue;
+        int g;
+        // the group is filled up to the minimum with the rest of the entries
+        if (sizes[0] + left == SPATIAL_INDEX_MIN_ENTRIES) {
+            g = 0;
+        } else if (sizes[1] + left == SPATIAL_INDEX_MIN_ENTRIES) {
+            g = 1;
+        } else {
+            qreal e0 = enlargement(bounds[0], rects[i]);
+            qreal e1 = enlargement(bounds[1], rects[i]);
+            if (e0 != e1) {
+                g = e0 < e1 ? 0 : 1;
+            } else {
+                g = sizes[0] <= sizes[1] ? 0 : 1;
+            }
+        }
+        group[i] = g;
+        bounds[g] = bounds[g].united(rects[i]);
+        sizes[g]++;
+        left--;
+    }
+
+    Node* sibling = new Node;
+    sibling->parent = node->parent;
+    sibling->leaf = node->leaf;
+    if (node->leaf) {
+        QVector<Entry> entries = node->entries;
+        node->entries.clear();
+        for (int i = 0; i < count; i++) {
+            Node* target = group[i] == 0 ? node : sibling;
+            target->entries.append(entries[i]);
+            leafOf.insert(entries[i].item, target);
+        }
+    } else {
+        QVector<Node*> children = node->children;
+        node->children.clear();
+        for (int i = 0; i < count; i++) {
+            Node* target = group[i] == 0 ? node : sibling;
+            target->children.append(children[i]);
+            children[i]->parent = target;
+        }
+    }
+    return sibling;
+}
+
+void CyberiadaSMEditorSpatialIndex::updateBounds(Node* node)
+{
+    QRectF bounds;
+    if (node->leaf) {
+        for (int i = 0; i < node->entries.size(); i++) {
+            bounds = i == 0 ? node->entries[i].rect : bounds.united(node->entries[i].rect);
+        }
+    } else {
+        for (int i = 0; i < node->children.size(); i++) {
+            bounds = i == 0 ? node->children[i]->bounds : bounds.united(node->children[i]->bounds);
+        }
+    }
+    node->bounds = bounds;
+}
+
+void CyberiadaSMEditorSpatialIndex::collectEntries(Node* node, QVector<Entry>& entries)
+{
+    if (node->leaf) {
+        entries += node->entries;
+        return;
+    }
+    for (int i = 0; i < node->children.size(); i++) {
+        collectEntries(node->children[i], entries);
+    }
+}
+
+void CyberiadaSMEditorSpatialIndex::deleteNode(Node* node)
+{
+    for (int i = 0; i < node->children.size(); i++) {
+        deleteNode(node->children[i]);
+    }
+    delete node;
+}
@@ -0,0 +1,88 @@
+/* -----------------------------------------------------------------------------
+ * The Cyberiada State Machine Editor
+ * -----------------------------------------------------------------------------
+ *
+ * The State Machine Editor Spatial Index
+ *
+ * Copyright (C) 2024 Alexey Fedoseev <aleksey@fedoseev.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see https://www.gnu.org/licenses/
+ *
+ * ----------------------------------------------------------------------------- */
+
+#ifndef CYBERIADA_SM_EDITOR_SPATIAL_INDEX_HEADER
+#define CYBERIADA_SM_EDITOR_SPATIAL_INDEX_HEADER
+
+#include <QGraphicsItem>
+#include <QHash>
+#include <QSet>
+#include <QRectF>
+#include <QVector>
+
+class CyberiadaSMEditorAbstractItem;
+
+// The R-tree of the scene rects of the state machine, state and vertex items.
+// The editor asks it for the new parent of the dragged state and for the end of
+// the dragged transition instead of testing all scene items under the point.
+// The registered and the moved items are (re)indexed lazily by the next query.
+class CyberiadaSMEditorSpatialIndex {
+public:
+    CyberiadaSMEditorSpatialIndex();
+    ~CyberiadaSMEditorSpatialIndex();
+
+    void                            insert(QGraphicsItem* item);
+    void                            remove(QGraphicsItem* item);
+    // the scene rect of the item was changed; the unknown items are ignored
+    void                            markDirty(QGraphicsItem* item);
+    void                            clear();
+
+    // the innermost state or state machine at the point, the ignored item and its children are skipped
+    CyberiadaSMEditorAbstractItem*  containerAt(const QPointF& point, const QGraphicsItem* ignored = nullptr);
+    // the innermost state or vertex at the point the transition can be connected to
+    CyberiadaSMEditorAbstractItem*  connectableAt(const QPointF& point);
+
+private:
+    struct Entry {
+        QGraphicsItem*              item;
+        QRectF                      rect;
+    };
+
+    struct Node {
+        Node*                       parent;
+        bool                        leaf;
+        QRectF                      bounds;
+        QVector<Node*>              children;
+        QVector<Entry>              entries;
+
+        int count() const { return leaf ? entries.size() : children.size(); }
+    };
+
+    void                            flush();
+    CyberiadaSMEditorAbstractItem*  innermostAt(const QPointF& point, const QGraphicsItem* ignored, bool connectable);
+    void                            search(const Node* node, const QPointF& point, QVector<QGraphicsItem*>& result) const;
+
+    void                            insertEntry(const Entry& entry);
+    void                            removeEntry(QGraphicsItem* item);
+    Node*                           chooseLeaf(const QRectF& rect) const;
+    Node*                           split(Node* node);
+    void                            updateBounds(Node* node);
+    void                            collectEntries(Node* node, QVector<Entry>& entries);
+    void                            deleteNode(Node* node);
+
+    Node*                           root;
+    QHash<QGraphicsItem*, Node*>    leafOf;
+    QSet<QGraphicsItem*>            pending;
+};
+
+#endif
@@ -35,6 +35,7 @@
 #include "cyberiadasm_editor_state_item.h"
 #include "cyberiadasm_editor_sm_item.h"
 #include "cyberiadasm_editor_scene.h"
+#include "cyberiadasm_editor_geometry.h"
 #include "dialogs/stateactiondialog.h"
 #include "settings_manager.h"
 
@@ -62,6 +63,7 @@ CyberiadaSMEditorStateItem::CyberiadaSMEditorStateItem(QObject *parent_object,
     state = static_cast<const Cyberiada::State*>(element);
 
     setPos(QPointF(x(), y()));
+    syncedSize = rect().size();
     CyberiadaSMEditorAbstractItem::setPreviousPosition(QPointF(x(), y()));
 
     title = new StateTitle(name(), this);
@@ -108,6 +110,11 @@ QPainterPath CyberiadaSMEditorStateItem::shape() const {
     return path;
 }
 
+bool CyberiadaSMEditorStateItem::outlineIntersection(const QPointF& start, const QPointF& dir, QPointF* point) const
+{
+    return CyberiadaSMEditorGeometry::lineRoundedRect(start, dir, rect(), ROUNDED_RECT_RADIUS, point);
+}
+
 void CyberiadaSMEditorStateItem::setRect(qreal x, qreal y, qreal w, qreal h)
 {
     setRect(QRectF(x, y, w, h));
@@ -253,17 +260,26 @@ void CyberiadaSMEditorStateItem::setTextPosition()
 
 
 
-void CyberiadaSMEditorStateItem::syncFromModel()
+void CyberiadaSMEditorStateItem::syncFromModel(CyberiadaSMModel::ChangeKinds kinds)
 {
-    // qDebug() << "synk" << name() << boundingRect() << pos() - QPointF(x(), y());
-    QRectF r1 = mapRectToParent(boundingRect());
-    // qDebug() << "before" << r1 << name();
-    setPos(QPointF(x(), y()));
-    QRectF r2 = mapRectToParent(boundingRect());
-    // qDebug() << "after" << r2 << name();
-    initializeActions();
-    if (title->toPlainText() != name()) {
-        title->setPlainText(name());
+    if (kinds & CyberiadaSMModel::ChangeGeometry) {
+        setPos(QPointF(x(), y()));
+        if (kinds == CyberiadaSMModel::ChangeGeometry && rect().size() == syncedSize) {
+            // pure position change: the content of the state is positioned relative to the item
+            return;
+        }
+        syncedSize = rect().size();
+    }
+
+    if (kinds & CyberiadaSMModel::ChangeActions) {
+        initializeActions();
+    } else if (kinds & CyberiadaSMModel::ChangeGeometry) {
+        setTextPosition();
+    }
+    if (kinds & CyberiadaSMModel::ChangeTitle) {
+        if (title->toPlainText() != name()) {
+            title->setPlainText(name());
+        }
     }
     if (state->is_composite_state()) {
         if (region == nullptr) {
@@ -273,49 +289,58 @@ void CyberiadaSMEditorStateItem::syncFromModel()
         updateRegion();
     }
 
-    CyberiadaSMEditorAbstractItem* cParent = dynamic_cast<CyberiadaSMEditorAbstractItem*>(parentItem());
-    if (cParent == nullptr) {
-        // try to find region parent
-        cParent = dynamic_cast<CyberiadaSMEditorAbstractItem*>(parentItem()->parentItem());
-        MY_ASSERT(cParent);
-    }
+    if (kinds & CyberiadaSMModel::ChangeParent) {
+        CyberiadaSMEditorAbstractItem* cParent = dynamic_cast<CyberiadaSMEditorAbstractItem*>(parentItem());
+        if (cParent == nullptr) {
+            // try to find region parent
+            cParent = dynamic_cast<CyberiadaSMEditorAbstractItem*>(parentItem()->parentItem());
+            MY_ASSERT(cParent);
+        }
 
-    if (cParent->getId() != element->get_parent()->get_id()) {
-        QGraphicsItem* newcParent = (dynamic_cast<CyberiadaSMEditorScene*>(scene())->getMap()).value(element->get_parent()->get_id());
-        QPointF posInThis = mapFromParent(pos());
-        QPointF newCoords = mapToItem(newcParent, posInThis);
-        Cyberiada::Rect newRect = Cyberiada::Rect(newCoords.x(), newCoords.y(), width(), height());
-        setParentItem(newcParent);
-        model->updateGeometry(model->elementToIndex(element), newRect);
-        prevItemUnderCursor = static_cast<CyberiadaSMEditorAbstractItem*>(newcParent);
+        if (cParent->getId() != element->get_parent()->get_id()) {
+            QGraphicsItem* newcParent = (dynamic_cast<CyberiadaSMEditorScene*>(scene())->getRegistry()).value(element->get_parent()->get_id());
+            QPointF posInThis = mapFromParent(pos());
+            QPointF newCoords = mapToItem(newcParent, posInThis);
+            Cyberiada::Rect newRect = Cyberiada::Rect(newCoords.x(), newCoords.y(), width(), height());
+            setParentItem(newcParent);
+            model->updateGeometry(model->elementToIndex(element), newRect);
+            prevItemUnderCursor = static_cast<CyberiadaSMEditorAbstractItem*>(newcParent);
+        }
     }
-    CyberiadaSMEditorAbstractItem::syncFromModel();
+    CyberiadaSMEditorAbstractItem::syncFromModel(kinds);
 }
 
 void CyberiadaSMEditorStateItem::initializeActions()
 {
-    // TODO
-    for (StateAction* action : actions) {
-        delete action;
+    // the existing items are reused in the order of the actions, only the difference is created or deleted
+    const std::vector<Cyberiada::Action>& stateActions = state->get_actions();
+    size_t count = stateActions.size();
+    while (actions.size() > count) {
+        delete actions.back();
+        actions.pop_back();
     }
-    actions.clear();
     entry = nullptr;
     exit = nullptr;
 
-    int actionIndex = 0;
-    for (std::vector<Cyberiada::Action>::const_iterator i = state->get_actions().begin(); i != state->get_actions().end(); i++) {
-        StateAction* action = new StateAction(&(*i), this);
-        Cyberiada::ActionType type = i->get_type();
+    for (size_t i = 0; i < count; i++) {
+        const Cyberiada::Action* a = &stateActions[i];
+        StateAction* action;
+        if (i < actions.size()) {
+            action = actions[i];
+            action->setAction(a);
+        } else {
+            action = new StateAction(a, this);
+            connect(action, &EditableTextItem::sizeChanged, this, &CyberiadaSMEditorStateItem::onTextItemSizeChanged);
+            connect(action, &StateAction::actionDeleted, this, &CyberiadaSMEditorStateItem::onActionDeleted);
+            connect(action, &StateAction::actionUpdated, this, &CyberiadaSMEditorStateItem::onActionChanged);
+            actions.push_back(action);
+        }
+        Cyberiada::ActionType type = a->get_type();
         if (type == Cyberiada::actionEntry) {
             entry = action;
         } else if (type == Cyberiada::actionExit) {
             exit = action;
         }
-        connect(action, &EditableTextItem::sizeChanged, this, &CyberiadaSMEditorStateItem::onTextItemSizeChanged);
-        connect(action, &StateAction::actionDeleted, this, &CyberiadaSMEditorStateItem::onActionDeleted);
-        connect(action, &StateAction::actionUpdated, this, &CyberiadaSMEditorStateItem::onActionChanged);
-        actions.push_back(action);
-        actionIndex++;
     }
 
     setTextPosition();
@@ -453,7 +478,7 @@ void CyberiadaSMEditorStateItem::paint(QPainter *painter, const QStyleOptionGrap
     Q_UNUSED(option)
     Q_UNUSED(widget)
 
-    qreal titleHeight = title->boundingRect().height();
+    DetailLevel detail = paintDetailLevel(painter);
 
     QPen pen = QPen(Qt::black, 2, Qt::SolidLine);
     if (isSelected() || isHighlighted) {
@@ -470,7 +495,10 @@ void CyberiadaSMEditorStateItem::paint(QPainter *painter, const QStyleOptionGrap
     QPainterPath path;
     QRectF tmpRect = rect();
     path.addRoundedRect(tmpRect, ROUNDED_RECT_RADIUS, ROUNDED_RECT_RADIUS);
-    painter->drawLine(QPointF(tmpRect.x(), tmpRect.y() + titleHeight), QPointF(tmpRect.right(), tmpRect.y() + titleHeight));
+    if (detail != DetailLevel::Outline) {
+        qreal titleHeight = title->boundingRect().height();
+        painter->drawLine(QPointF(tmpRect.x(), tmpRect.y() + titleHeight), QPointF(tmpRect.right(), tmpRect.y() + titleHeight));
+    }
     painter->drawPath(path);
 
     if (SettingsManager::instance().getInspectorMode()) {
@@ -596,6 +624,7 @@ StateTitle::StateTitle(const QString &text, QGraphicsItem *parent):
     EditableTextItem(text, parent) {
     setTextAlignment(Qt::AlignCenter);
     setTextMargin(0);
+    setMinimumDetail(DetailLevel::Titles);
 }
 
 void StateTitle::focusOutEvent(QFocusEvent *event)
@@ -669,7 +698,7 @@ void StateTitle::mousePressEvent(QGraphicsSceneMouseEvent *event) {
         event->accept();
         return;
     }
-    QGraphicsTextItem::mousePressEvent(event);
+    EditableTextItem::mousePressEvent(event);
 }
 
 void StateTitle::mouseMoveEvent(QGraphicsSceneMouseEvent *event)
@@ -697,6 +726,7 @@ void StateTitle::mouseMoveEvent(QGraphicsSceneMouseEvent *event)
                                                 state->pos().y() + delta.y(),
                                                 state->boundingRect().width(),
                                                 state->boundingRect().height());
+            state->model->beginTransaction();
             state->model->updateGeometry(state->model->elementToIndex(state->element), r);
             startPos = event->scenePos();
 
@@ -713,6 +743,7 @@ void StateTitle::mouseMoveEvent(QGraphicsSceneMouseEvent *event)
                     }
                 }
             }
+            state->model->commitTransaction();
 
             CyberiadaSMEditorAbstractItem* newParent = state->collectionUnderItem();
 
@@ -730,7 +761,7 @@ void StateTitle::mouseMoveEvent(QGraphicsSceneMouseEvent *event)
         }
         return;
     }
-    QGraphicsTextItem::mouseMoveEvent(event);
+    EditableTextItem::mouseMoveEvent(event);
 }
 
 void StateTitle::mouseReleaseEvent(QGraphicsSceneMouseEvent *event) {
@@ -753,7 +784,7 @@ void StateTitle::mouseReleaseEvent(QGraphicsSceneMouseEvent *event) {
         return;
     }
 
-    QGraphicsTextItem::mouseReleaseEvent(event);
+    EditableTextItem::mouseReleaseEvent(event);
 }
 
 /* -----------------------------------------------------------------------------
@@ -784,8 +815,15 @@ void StateRegion::paint(QPainter *painter, const QStyleOptionGraphicsItem *optio
 
 StateAction::StateAction(const Cyberiada::Action* action, QGraphicsItem *parent):
     EditableTextItem(parent),
-    action(action) {
+    action(nullptr) {
     setTextMargin(30);
+    setAction(action);
+}
+
+void StateAction::setAction(const Cyberiada::Action* newAction)
+{
+    // the actions are kept in a vector of the state, the pointer changes when the vector grows
+    action = newAction;
 
     Cyberiada::ActionType type = action->get_type();
     switch(type) {
@@ -800,7 +838,10 @@ StateAction::StateAction(const Cyberiada::Action* action, QGraphicsItem *parent)
         typeText = QString("");
     }
 
-    setPlainText(typeText + QString(action->get_behavior().c_str()));
+    QString text = typeText + QString(action->get_behavior().c_str());
+    if (toPlainText() != text) {
+        setPlainText(text);
+    }
 }
 
 QString StateAction::getBehavior()
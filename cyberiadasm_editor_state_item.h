@@ -60,6 +60,7 @@ public:
     virtual int type() const { return StateItem; }
 
     QPainterPath shape() const override;
+    bool outlineIntersection(const QPointF& start, const QPointF& dir, QPointF* point) const override;
     void setPreviousPosition(const QPointF previousPosition);
 
     void setRect(qreal x, qreal y, qreal w, qreal h);
@@ -76,7 +77,7 @@ public:
 
     QRectF boundingRect() const override;
 
-    void syncFromModel() override;
+    void syncFromModel(CyberiadaSMModel::ChangeKinds kinds = CyberiadaSMModel::ChangeAll) override;
 
     void setTextPosition();
 
@@ -115,6 +116,7 @@ private:
     StateAction* exit = nullptr;
 
     QRectF m_rect;
+    QSizeF syncedSize;
     StateRegion* region = nullptr;
     const Cyberiada::State* state;
     std::vector<StateAction*> actions;
@@ -199,6 +201,8 @@ public:
 
     QString getText();
     QString getBehavior();
+    // the item is reused for the action, the text is replaced only if it differs
+    void setAction(const Cyberiada::Action* newAction);
 
 signals:
     void actionDeleted(StateAction* signalOwner);
@@ -36,6 +36,7 @@
 #include "cyberiadasm_editor_transition_item.h"
 #include "cyberiada_constants.h"
 #include "cyberiadasm_editor_scene.h"
+#include "cyberiadasm_editor_geometry.h"
 #include "settings_manager.h"
 
 /* -----------------------------------------------------------------------------
@@ -46,10 +47,12 @@ CyberiadaSMEditorTransitionItem::CyberiadaSMEditorTransitionItem(QObject *parent
                                                                  CyberiadaSMModel *model,
                                                                  Cyberiada::Element *element,
                                                                  QGraphicsItem *parent,
-                                                                 QMap<Cyberiada::ID, QGraphicsItem*>& elementItem) :
+                                                                 CyberiadaSMEditorItemRegistry& elementItem) :
     CyberiadaSMEditorAbstractItem(model, element, parent),
     // QObject(parent_object),
-    elementIdToItemMap(elementItem)
+    itemRegistry(elementItem),
+    sourceHandle(CyberiadaSMEditorItemRegistry::invalidHandle),
+    targetHandle(CyberiadaSMEditorItemRegistry::invalidHandle)
 {
     setAcceptHoverEvents(true);
     setFlags(ItemIsSelectable|ItemSendsGeometryChanges);
@@ -70,12 +73,15 @@ CyberiadaSMEditorTransitionItem::CyberiadaSMEditorTransitionItem(QObject *parent
     connect(source(), &CyberiadaSMEditorAbstractItem::sizeChanged, this, &CyberiadaSMEditorTransitionItem::onSourceSizeChanged);
 
     updateActionPosition();
-    initializeDots();
-    hideDots();
+    // the dots are created on selection, see showDots
 }
 
 CyberiadaSMEditorTransitionItem::~CyberiadaSMEditorTransitionItem()
 {
+    CyberiadaSMEditorScene* cScene = dynamic_cast<CyberiadaSMEditorScene*>(scene());
+    if (cScene) {
+        cScene->unmarkTransitionDirty(this);
+    }
     if(actionItem) { delete actionItem; }
 
     if(!listDots.isEmpty()){
@@ -90,7 +96,8 @@ QRectF CyberiadaSMEditorTransitionItem::boundingRect() const
 {
     MY_ASSERT(model);
     MY_ASSERT(model->rootDocument());
-    return path().boundingRect().adjusted(-10, -10, 10, 10); // Увеличиваем область для стрелки
+    updatePathCache();
+    return cachedBoundingRect;
 }
 
 void CyberiadaSMEditorTransitionItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget)
@@ -106,19 +113,38 @@ void CyberiadaSMEditorTransitionItem::paint(QPainter *painter, const QStyleOptio
     painter->setBrush(Qt::NoBrush);
     painter->drawPath(path());
 
-    drawArrow(painter);
+    // the arrow head is lost at the small scales anyway
+    if (paintDetailLevel(painter) != DetailLevel::Outline) {
+        drawArrow(painter);
+    }
 }
 
 QPainterPath CyberiadaSMEditorTransitionItem::shape() const
 {
-    QPainterPathStroker stroker;
-    stroker.setWidth(5);
-    return stroker.createStroke(path());
+    updatePathCache();
+    if (!shapeValid) {
+        QPainterPathStroker stroker;
+        stroker.setWidth(5);
+        cachedShape = stroker.createStroke(cachedPath);
+        shapeValid = true;
+    }
+    return cachedShape;
+}
+
+QGraphicsItem *CyberiadaSMEditorTransitionItem::endItem(CyberiadaSMEditorItemRegistry::Handle& handle, const Cyberiada::ID& id) const
+{
+    QGraphicsItem* item = itemRegistry.item(handle);
+    if (item == nullptr) {
+        // the end was not resolved yet or its item was replaced
+        handle = itemRegistry.handle(id);
+        item = itemRegistry.item(handle);
+    }
+    return item;
 }
 
 CyberiadaSMEditorAbstractItem *CyberiadaSMEditorTransitionItem::source() const
 {
-    return static_cast<CyberiadaSMEditorAbstractItem*>(elementIdToItemMap.value(transition->source_element_id()));
+    return static_cast<CyberiadaSMEditorAbstractItem*>(endItem(sourceHandle, transition->source_element_id()));
 }
 
 void CyberiadaSMEditorTransitionItem::setSource(CyberiadaSMEditorAbstractItem *newSource)
@@ -162,16 +188,14 @@ void CyberiadaSMEditorTransitionItem::setSourcePoint(const Cyberiada::Point &poi
 
 QPointF CyberiadaSMEditorTransitionItem::sourceCenter() const
 {
-    Cyberiada::ID id = transition->source_element_id();
-
-    if(!elementIdToItemMap.value(id)) return QPoint(); //костыль
-    MY_ASSERT(elementIdToItemMap.value(id));
-    return (elementIdToItemMap.value(id))->sceneBoundingRect().center();
+    QGraphicsItem* item = source();
+    if(!item) return QPoint(); //костыль
+    return item->sceneBoundingRect().center();
 }
 
 CyberiadaSMEditorAbstractItem *CyberiadaSMEditorTransitionItem::target() const
 {
-    return static_cast<CyberiadaSMEditorAbstractItem*>(elementIdToItemMap.value(transition->target_element_id()));
+    return static_cast<CyberiadaSMEditorAbstractItem*>(endItem(targetHandle, transition->target_element_id()));
 }
 
 void CyberiadaSMEditorTransitionItem::setTarget(CyberiadaSMEditorAbstractItem *newTarget)
@@ -208,23 +232,54 @@ void CyberiadaSMEditorTransitionItem::setTargetPoint(const QPointF &point)
 
 QPointF CyberiadaSMEditorTransitionItem::targetCenter() const
 {
-    if(!elementIdToItemMap.value(transition->target_element_id())) return QPoint(); //костыль
-    MY_ASSERT(elementIdToItemMap.value(transition->target_element_id()));
-    return (elementIdToItemMap.value(transition->target_element_id()))->sceneBoundingRect().center();
+    QGraphicsItem* item = target();
+    if(!item) return QPoint(); //костыль
+    return item->sceneBoundingRect().center();
 }
 
 QPainterPath CyberiadaSMEditorTransitionItem::path() const
+{
+    updatePathCache();
+    return cachedPath;
+}
+
+void CyberiadaSMEditorTransitionItem::invalidatePath()
+{
+    pathValid = false;
+}
+
+void CyberiadaSMEditorTransitionItem::updatePathCache() const
+{
+    // the moves of the ends invalidate the path after prepareGeometryChange(), see scheduleEndsUpdate;
+    // the path is not rebuilt on its own, so the scene index never sees a changed rect unannounced
+    bool tracking = isSourceTraking || isTargetTraking;
+    if (pathValid &&
+        isSourceTraking == cachedSourceTracking &&
+        isTargetTraking == cachedTargetTracking &&
+        (!tracking || prevPosition == cachedPrevPosition)) {
+        return;
+    }
+    cachedPath = buildPath(sourceCenter(), targetCenter());
+    cachedBoundingRect = cachedPath.boundingRect().adjusted(-10, -10, 10, 10); // Увеличиваем область для стрелки
+    cachedSourceTracking = isSourceTraking;
+    cachedTargetTracking = isTargetTraking;
+    cachedPrevPosition = prevPosition;
+    pathValid = true;
+    shapeValid = false;
+}
+
+QPainterPath CyberiadaSMEditorTransitionItem::buildPath(const QPointF& srcCenter, const QPointF& tgtCenter) const
 {
     MY_ASSERT(model);
     QPainterPath path = QPainterPath();
 
     // loop
     if (source() == target() && !(isSourceTraking || isTargetTraking)) {
-        QPointF p1 = sourcePoint() + sourceCenter();
-        QPointF p2 = targetPoint() + targetCenter();
+        QPointF p1 = sourcePoint() + srcCenter;
+        QPointF p2 = targetPoint() + tgtCenter;
 
-        QPointF v1 = p1 - sourceCenter();
-        QPointF v2 = p2 - sourceCenter();
+        QPointF v1 = p1 - srcCenter;
+        QPointF v2 = p2 - srcCenter;
 
         double cross = v1.x() * v2.y() - v1.y() * v2.x();
 
@@ -281,19 +336,19 @@ QPainterPath CyberiadaSMEditorTransitionItem::path() const
     if (isSourceTraking) {
         path.moveTo(prevPosition);
     } else {
-        path.moveTo(sourcePoint() + sourceCenter());
+        path.moveTo(sourcePoint() + srcCenter);
     }
 
     if(transition->has_polyline()) {
         for (const auto& point : transition->get_geometry_polyline()) {
-            path.lineTo(QPointF(point.x, point.y) + sourceCenter());
+            path.lineTo(QPointF(point.x, point.y) + srcCenter);
         }
     }
 
     if (isTargetTraking) {
         path.lineTo(prevPosition);
     } else {
-        path.lineTo(targetPoint() + targetCenter());
+        path.lineTo(targetPoint() + tgtCenter);
     }
 
     return path;
@@ -368,87 +423,16 @@ void CyberiadaSMEditorTransitionItem::drawArrow(QPainter* painter)
 
 CyberiadaSMEditorAbstractItem *CyberiadaSMEditorTransitionItem::itemUnderCursor()
 {
-    QList<QGraphicsItem*> items = scene()->items(prevPosition);
-
-    CyberiadaSMEditorAbstractItem* cItem = nullptr;
-    for (QGraphicsItem* item : items) {
-        cItem = dynamic_cast<CyberiadaSMEditorAbstractItem*>(item);
-        if (!cItem) { continue; }
-
-        if (cItem->type() == CyberiadaSMEditorAbstractItem::StateItem ||
-            cItem->type() == CyberiadaSMEditorAbstractItem::CompositeStateItem ||
-            cItem->type() == CyberiadaSMEditorAbstractItem::VertexItem) {
-            return cItem;
-        }
-    }
-    return nullptr;
+    CyberiadaSMEditorScene* cScene = dynamic_cast<CyberiadaSMEditorScene*>(scene());
+    if (!cScene) return nullptr;
+    return cScene->getSpatialIndex().connectableAt(prevPosition);
 }
 
 QPointF CyberiadaSMEditorTransitionItem::findIntersectionWithItem(const CyberiadaSMEditorAbstractItem *item,
                                                                   const QPointF& start, const QPointF& end,
                                                                   bool* hasIntersections)
 {
-    if (!item) return QPointF();
-
-    int margin = 60;
-    QRectF adjustedRect = item->sceneBoundingRect().adjusted(-margin, -margin, margin, margin);
-
-    if (!adjustedRect.contains(start)) {
-        *hasIntersections = false;
-        return QPointF();
-    }
-
-    QPointF dir = end - start;
-    if (dir.isNull()) {
-        return QPointF();
-    }
-
-    if (item->type() == CyberiadaSMEditorAbstractItem::VertexItem) {
-        *hasIntersections = true;
-        return item->sceneBoundingRect().center();
-    }
-
-    QLineF rayForward(start, start + dir * 1e5);
-    QLineF rayBackward(start, start - dir * 1e5);
-
-    QPainterPath shape = item->shape();
-    QPainterPath sceneShape = item->sceneTransform().map(shape);
-    QPolygonF polygon = sceneShape.toFillPolygon();
-
-    QPointF closestIntersection;
-    qreal minDist = std::numeric_limits<qreal>::max();
-
-    for (int i = 0; i < polygon.size(); ++i) {
-        QPointF p1 = polygon[i];
-        QPointF p2 = polygon[(i + 1) % polygon.size()];
-
-        QLineF edge(p1, p2);
-        QPointF intersectionPoint;
-
-        // find closest intersection to start point
-        if (rayForward.intersect(edge, &intersectionPoint) == QLineF::BoundedIntersection) {
-            qreal dist = QLineF(start, intersectionPoint).length();
-            if (dist < minDist) {
-                minDist = dist;
-                closestIntersection = intersectionPoint;
-            }
-        }
-        if (rayBackward.intersect(edge, &intersectionPoint) == QLineF::BoundedIntersection) {
-            qreal dist = QLineF(start, intersectionPoint).length();
-            if (dist < minDist) {
-                minDist = dist;
-                closestIntersection = intersectionPoint;
-            }
-        }
-    }
-
-    if (minDist < std::numeric_limits<qreal>::max()) {
-        *hasIntersections = true;
-        return closestIntersection;
-    } else {
-        *hasIntersections = false;
-        return QPointF();
-    }
+    return CyberiadaSMEditorGeometry::itemIntersection(item, start, end, hasIntersections);
 }
 
 void CyberiadaSMEditorTransitionItem::updateCoordinates(CornerFlags side, QPointF& point, qreal d)
@@ -533,25 +517,55 @@ void CyberiadaSMEditorTransitionItem::setActionVisibility(bool visible) {
     actionItem->setVisible(visible);
 }
 
-void CyberiadaSMEditorTransitionItem::syncFromModel()
+void CyberiadaSMEditorTransitionItem::syncFromModel(CyberiadaSMModel::ChangeKinds kinds)
 {
-    prepareGeometryChange();
-    updateAction();
-    updateDots();
-    setDotsPosition();
-    CyberiadaSMEditorAbstractItem::syncFromModel();
+    bool geometry = kinds & (CyberiadaSMModel::ChangeGeometry | CyberiadaSMModel::ChangeEndpoints);
+    if (kinds & CyberiadaSMModel::ChangeEndpoints) {
+        sourceHandle = targetHandle = CyberiadaSMEditorItemRegistry::invalidHandle;
+    }
+    if (geometry) {
+        prepareGeometryChange();
+        invalidatePath();
+        updateDots();
+    }
+    if (kinds & CyberiadaSMModel::ChangeActions) {
+        updateAction();
+    } else if (geometry) {
+        updateActionPosition();
+    }
+    if (geometry) {
+        // the base class moves the dots
+        kinds |= CyberiadaSMModel::ChangeGeometry;
+    }
+    CyberiadaSMEditorAbstractItem::syncFromModel(kinds);
 }
 
 void CyberiadaSMEditorTransitionItem::onSourceGeomertyChanged()
 {
-    prepareGeometryChange();
-    updateActionPosition();
-    setDotsPosition();
+    scheduleEndsUpdate();
 }
 
 void CyberiadaSMEditorTransitionItem::onTargetGeomertyChanged()
 {
+    scheduleEndsUpdate();
+}
+
+void CyberiadaSMEditorTransitionItem::scheduleEndsUpdate()
+{
+    // the scene learns about the new rect at once, the path is rebuilt on the next query
     prepareGeometryChange();
+    invalidatePath();
+    // an end moved together with many other items reports every move, the scene moves the label and the dots once
+    CyberiadaSMEditorScene* cScene = dynamic_cast<CyberiadaSMEditorScene*>(scene());
+    if (cScene) {
+        cScene->markTransitionDirty(this);
+    } else {
+        updateEndsGeometry();
+    }
+}
+
+void CyberiadaSMEditorTransitionItem::updateEndsGeometry()
+{
     updateActionPosition();
     setDotsPosition();
 }
@@ -876,41 +890,52 @@ void CyberiadaSMEditorTransitionItem::hoverLeaveEvent(QGraphicsSceneHoverEvent *
 
 void CyberiadaSMEditorTransitionItem::initializeDots()
 {
+    if (!dynamic_cast<CyberiadaSMEditorScene*>(scene())) return;
     if (source() == target()) {
         // source
-        DotSignal *dotS = new DotSignal(sourcePoint() + sourceCenter(), this);
-        connect(dotS, &DotSignal::signalMove, this, &CyberiadaSMEditorTransitionItem::slotMoveDot);
-        connect(dotS, &DotSignal::signalMouseRelease, this, &CyberiadaSMEditorTransitionItem::slotMouseReleaseDot);
-        connect(dotS, &DotSignal::signalDelete, this, &CyberiadaSMEditorTransitionItem::slotDeleteDot);
-        dotS->setDotFlags(DotSignal::Movable);
-        dotS->setDeleteable(true);
-        listDots.append(dotS);
+        listDots.append(acquireDot(sourcePoint() + sourceCenter()));
         // target
-        DotSignal *dotT = new DotSignal(targetPoint() + targetCenter(), this);
-        connect(dotT, &DotSignal::signalMove, this, &CyberiadaSMEditorTransitionItem::slotMoveDot);
-        connect(dotT, &DotSignal::signalMouseRelease, this, &CyberiadaSMEditorTransitionItem::slotMouseReleaseDot);
-        connect(dotT, &DotSignal::signalDelete, this, &CyberiadaSMEditorTransitionItem::slotDeleteDot);
-        dotT->setDotFlags(DotSignal::Movable);
-        dotT->setDeleteable(true);
-        listDots.append(dotT);
+        listDots.append(acquireDot(targetPoint() + targetCenter()));
         return;
     }
     // polyline
     QPainterPath linePath = path();
     for(int i = 0; i < linePath.elementCount(); i++) {
         QPointF point = linePath.elementAt(i);
-        DotSignal *dot = new DotSignal(point, this);
-        connect(dot, &DotSignal::signalMove, this, &CyberiadaSMEditorTransitionItem::slotMoveDot);
-        connect(dot, &DotSignal::signalMouseRelease, this, &CyberiadaSMEditorTransitionItem::slotMouseReleaseDot);
-        connect(dot, &DotSignal::signalDelete, this, &CyberiadaSMEditorTransitionItem::slotDeleteDot);
-        dot->setDotFlags(DotSignal::Movable);
-        dot->setDeleteable(true);
-        listDots.append(dot);
+        listDots.append(acquireDot(point));
+    }
+}
+
+DotSignal* CyberiadaSMEditorTransitionItem::acquireDot(const QPointF& pos)
+{
+    CyberiadaSMEditorScene* cScene = dynamic_cast<CyberiadaSMEditorScene*>(scene());
+    MY_ASSERT(cScene);
+    DotSignal *dot = cScene->acquireDot(this, pos);
+    connect(dot, &DotSignal::signalMove, this, &CyberiadaSMEditorTransitionItem::slotMoveDot);
+    connect(dot, &DotSignal::signalMouseRelease, this, &CyberiadaSMEditorTransitionItem::slotMouseReleaseDot);
+    connect(dot, &DotSignal::signalDelete, this, &CyberiadaSMEditorTransitionItem::slotDeleteDot);
+    dot->setDotFlags(DotSignal::Movable);
+    dot->setDeleteable(true);
+    return dot;
+}
+
+void CyberiadaSMEditorTransitionItem::releaseDot(DotSignal* dot)
+{
+    CyberiadaSMEditorScene* cScene = dynamic_cast<CyberiadaSMEditorScene*>(scene());
+    if (cScene) {
+        cScene->releaseDot(dot);
+    } else {
+        dot->deleteLater();
     }
 }
 
 void CyberiadaSMEditorTransitionItem::updateDots()
 {
+    // no dots until the transition is selected
+    if (listDots.isEmpty()) {
+        return;
+    }
+
     int n = 2;
     if(source() != target() && transition->has_polyline()) {
         n += transition->get_geometry_polyline().size();
@@ -922,7 +947,7 @@ void CyberiadaSMEditorTransitionItem::updateDots()
 
     if (listDots.size() > 2) {
         for (int i = 1; i < listDots.size() - 1; ++i) {
-            listDots[i]->deleteLater();
+            releaseDot(listDots[i]);
         }
 
         DotSignal *first = listDots.first();
@@ -940,14 +965,11 @@ void CyberiadaSMEditorTransitionItem::updateDots()
     // polyline
     if(source() != target() && transition->has_polyline()) {
         Cyberiada::Polyline pol = transition->get_geometry_polyline();
+        bool visible = listDots.first()->isVisible();
         for(int i = 0; i < n - 2; i++) {
             QPointF point = QPointF(pol.at(i).x, pol.at(i).y);
-            DotSignal *dot = new DotSignal(point, this);
-            connect(dot, &DotSignal::signalMove, this, &CyberiadaSMEditorTransitionItem::slotMoveDot);
-            connect(dot, &DotSignal::signalMouseRelease, this, &CyberiadaSMEditorTransitionItem::slotMouseReleaseDot);
-            connect(dot, &DotSignal::signalDelete, this, &CyberiadaSMEditorTransitionItem::slotDeleteDot);
-            dot->setDotFlags(DotSignal::Movable);
-            dot->setDeleteable(true);
+            DotSignal *dot = acquireDot(point);
+            dot->setVisible(visible);
             listDots.insert(i + 1, dot);
         }
         return;
@@ -971,6 +993,10 @@ void CyberiadaSMEditorTransitionItem::updateDots()
 
 void CyberiadaSMEditorTransitionItem::showDots()
 {
+    if (listDots.isEmpty()) {
+        initializeDots();
+        setDotsPosition();
+    }
     foreach( DotSignal* dot, listDots ) {
         dot->setVisible(true);
     }
@@ -981,10 +1007,27 @@ void CyberiadaSMEditorTransitionItem::hideDots()
     foreach( DotSignal* dot, listDots ) {
         dot->setVisible(false);
     }
+    if (isSelected() || listDots.isEmpty()) {
+        return;
+    }
+    // the dot being dragged or deleted is kept until the next deselection
+    QGraphicsScene* s = scene();
+    foreach( DotSignal* dot, listDots ) {
+        if (s && (s->mouseGrabberItem() == dot || s->focusItem() == dot)) {
+            return;
+        }
+    }
+    foreach( DotSignal* dot, listDots ) {
+        releaseDot(dot);
+    }
+    listDots.clear();
 }
 
 void CyberiadaSMEditorTransitionItem::setDotsPosition()
 {
+    if (listDots.isEmpty()) {
+        return;
+    }
     if (isSourceTraking) {
         listDots.first()->setPos(prevPosition);
         return;
@@ -1046,6 +1089,9 @@ QString TransitionAction::getBehaviour() const
 }
 
 void TransitionAction::paint(QPainter *painter, const QStyleOptionGraphicsItem *o, QWidget *w) {
+    if (!isEdit && paintDetailLevel(painter) < DetailLevel::Full) {
+        return;
+    }
     if (!toPlainText().isEmpty()) {
         QColor color = painter->background().color();
         color.setAlpha(150);
@@ -1053,7 +1099,7 @@ void TransitionAction::paint(QPainter *painter, const QStyleOptionGraphicsItem *
         painter->setPen(Qt::NoPen);
         painter->drawRect(boundingRect());
     }
-    QGraphicsTextItem::paint(painter, o, w);
+    EditableTextItem::paint(painter, o, w);
 }
 
 void TransitionAction::focusOutEvent(QFocusEvent *event)
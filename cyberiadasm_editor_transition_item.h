@@ -35,6 +35,7 @@
 #include <QPainter>
 
 #include "cyberiadasm_editor_items.h"
+#include "cyberiadasm_editor_item_registry.h"
 #include "dotsignal.h"
 #include "editable_text_item.h"
 
@@ -57,7 +58,7 @@ public:
                         CyberiadaSMModel *model,
                         Cyberiada::Element *element,
                         QGraphicsItem *parent,
-                        QMap<Cyberiada::ID, QGraphicsItem*> &elementItem);
+                        CyberiadaSMEditorItemRegistry& elementItem);
     ~CyberiadaSMEditorTransitionItem();
 
     virtual int type() const { return TransitionItem; }
@@ -95,7 +96,9 @@ public:
     void updateActionPosition();
     void setActionVisibility(bool visible);
 
-    void syncFromModel() override;
+    void syncFromModel(CyberiadaSMModel::ChangeKinds kinds = CyberiadaSMModel::ChangeAll) override;
+    // the label and the dots follow the moved ends; called by the scene once per frame
+    void updateEndsGeometry();
 
 signals:
     // void clicked(CyberiadaSMEditorTransitionItem *rect);
@@ -121,6 +124,13 @@ protected:
 
 private:
     void drawArrow(QPainter* painter);
+    void scheduleEndsUpdate();
+    // the path, its bounding rect and its shape are rebuilt only when the geometry changes
+    QPainterPath buildPath(const QPointF& srcCenter, const QPointF& tgtCenter) const;
+    void updatePathCache() const;
+    void invalidatePath();
+    // resolves the cached handle of the transition end, looks up the id only when it is stale
+    QGraphicsItem* endItem(CyberiadaSMEditorItemRegistry::Handle& handle, const Cyberiada::ID& id) const;
     CyberiadaSMEditorAbstractItem* itemUnderCursor();
     QPointF findIntersectionWithItem(const CyberiadaSMEditorAbstractItem *item,
                                      const QPointF& start, const QPointF& end,
@@ -138,7 +148,18 @@ private:
 
     QList<DotSignal *> listDots;
 
-    QMap<Cyberiada::ID, QGraphicsItem*>& elementIdToItemMap;
+    CyberiadaSMEditorItemRegistry& itemRegistry;
+    mutable CyberiadaSMEditorItemRegistry::Handle sourceHandle;
+    mutable CyberiadaSMEditorItemRegistry::Handle targetHandle;
+
+    mutable bool pathValid = false;
+    mutable bool shapeValid = false;
+    mutable QPainterPath cachedPath;
+    mutable QPainterPath cachedShape;
+    mutable QRectF cachedBoundingRect;
+    mutable QPointF cachedPrevPosition;
+    mutable bool cachedSourceTracking = false;
+    mutable bool cachedTargetTracking = false;
 
     bool isLeftMouseButtonPressed;
     bool isMouseTraking;
@@ -146,6 +167,9 @@ private:
     bool isTargetTraking;
 
     void initializeDots() override;
+    // the dot is taken from the scene pool and connected to the transition
+    DotSignal* acquireDot(const QPointF& pos);
+    void releaseDot(DotSignal* dot);
     void updateDots();
     void showDots() override;
     void hideDots() override;
@@ -106,7 +106,11 @@ void CyberiadaSMEditorVertexItem::paint(QPainter* painter, const QStyleOptionGra
     }
     painter->setPen(QPen(color, 1, Qt::SolidLine));
     Cyberiada::ElementType type = element->get_type();
-    if (type == Cyberiada::elementInitial) {
+    if (paintDetailLevel(painter) == DetailLevel::Outline) {
+        // the vertex is a dot at the small scales
+        painter->setBrush(QBrush(color));
+        painter->drawEllipse(fullCircle());
+    } else if (type == Cyberiada::elementInitial) {
         painter->setBrush(QBrush(color));
         painter->drawEllipse(fullCircle());
     } else if (type == Cyberiada::elementFinal) {
@@ -0,0 +1,383 @@
+/* -----------------------------------------------------------------------------
+ * The Cyberiada State Machine Editor
+ * -----------------------------------------------------------------------------
+ * 
+ * The Model Edit Journal
+ *
+ * Copyright (C) 2024 Alexey Fedoseev <aleksey@fedoseev.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see https://www.gnu.org/licenses/
+ *
+ * ----------------------------------------------------------------------------- */
+
+#include <QFileInfo>
+#include <QDebug>
+
+#if defined(Q_OS_WIN)
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "cyberiadasm_journal.h"
+#include "myassert.h"
+
+#define JOURNAL_MAGIC              0x43594a4e
+#define JOURNAL_VERSION            1
+#define JOURNAL_FLUSH_INTERVAL     1000                 // ms
+#define JOURNAL_COMPACTION_SIZE    (8 * 1024 * 1024)    // bytes
+
+CyberiadaSMJournal::CyberiadaSMJournal(const QString& document_path, QObject* parent):
+    QObject(parent), docPath(document_path), nextBase(baseDocument), checkpointing(false)
+{
+    flushTimer.setSingleShot(true);
+    flushTimer.setInterval(JOURNAL_FLUSH_INTERVAL);
+    connect(&flushTimer, &QTimer::timeout, this, &CyberiadaSMJournal::slotFlushTimeout);
+}
+
+CyberiadaSMJournal::~CyberiadaSMJournal()
+{
+    flush();
+    closeJournal();
+}
+
+QString CyberiadaSMJournal::journalPath() const
+{
+    return docPath + ".journal";
+}
+
+QString CyberiadaSMJournal::snapshotPath() const
+{
+    return docPath + ".journal.base";
+}
+
+QString CyberiadaSMJournal::prevPath() const
+{
+    return docPath + ".journal.prev";
+}
+
+bool CyberiadaSMJournal::hasRecovery() const
+{
+    Base base;
+    QList<QByteArray> records;
+    if (QFile::exists(prevPath())) {
+        return true;
+    }
+    return readJournal(journalPath(), base, records) && !records.isEmpty();
+}
+
+QString CyberiadaSMJournal::recoveryBase() const
+{
+    Base base = baseDocument;
+    QList<QByteArray> records;
+    // the rotated journal is older, so it defines the base
+    if (!readJournal(prevPath(), base, records)) {
+        readJournal(journalPath(), base, records);
+    }
+    if (base == baseSnapshot && QFile::exists(snapshotPath())) {
+        return snapshotPath();
+    }
+    return docPath;
+}
+
+QList<QByteArray> CyberiadaSMJournal::recoveryRecords() const
+{
+    Base base;
+    QList<QByteArray> records;
+    readJournal(prevPath(), base, records);
+    readJournal(journalPath(), base, records);
+    return records;
+}
+
+void CyberiadaSMJournal::resume()
+{
+    if (QFile::exists(prevPath())) {
+        endCheckpoint(false);
+    }
+    Base base = baseDocument;
+    QList<QByteArray> records;
+    readJournal(journalPath(), base, records);
+    nextBase = base;
+    // the journal is rewritten to drop a truncated tail left by the crash
+    writeJournal(journalPath(), base, records);
+}
+
+void CyberiadaSMJournal::discard()
+{
+    flushTimer.stop();
+    buffer.clear();
+    closeJournal();
+    QFile::remove(journalPath());
+    QFile::remove(prevPath());
+    QFile::remove(snapshotPath());
+    nextBase = baseDocument;
+    checkpointing = false;
+}
+
+void CyberiadaSMJournal::append(const QByteArray& record)
+{
+    QDataStream stream(&buffer, QIODevice::WriteOnly | QIODevice::Append);
+    stream.setVersion(QDataStream::Qt_5_0);
+    stream << quint32(record.size()) << qChecksum(record.constData(), uint(record.size()));
+    stream.writeRawData(record.constData(), record.size());
+    if (!flushTimer.isActive()) {
+        flushTimer.start();
+    }
+}
+
+void CyberiadaSMJournal::flush()
+{
+    flushTimer.stop();
+    if (buffer.isEmpty()) return;
+    if (!file.isOpen() && !openJournal(nextBase)) {
+        qWarning() << "Cannot open the journal" << journalPath();
+        buffer.clear();
+        return;
+    }
+    file.write(buffer);
+    file.flush();
+    syncFile();
+    buffer.clear();
+}
+
+qint64 CyberiadaSMJournal::size() const
+{
+    return (file.isOpen() ? file.size() : 0) + buffer.size();
+}
+
+QString CyberiadaSMJournal::beginCheckpoint(Base base)
+{
+    MY_ASSERT(!checkpointing);
+    flush();
+    closeJournal();
+    if (QFile::exists(journalPath())) {
+        QFile::remove(prevPath());
+        QFile::rename(journalPath(), prevPath());
+    }
+    nextBase = base;
+    checkpointing = true;
+    return base == baseSnapshot ? snapshotPath() : docPath;
+}
+
+void CyberiadaSMJournal::endCheckpoint(bool success)
+{
+    checkpointing = false;
+    if (success) {
+        QFile::remove(prevPath());
+        if (nextBase == baseDocument) {
+            QFile::remove(snapshotPath());
+        }
+        return;
+    }
+    // the base was not rewritten: the records made since the rotation go after the old ones
+    flush();
+    closeJournal();
+    Base base = baseDocument, current_base;
+    QList<QByteArray> records;
+    if (!readJournal(prevPath(), base, records)) {
+        return;
+    }
+    readJournal(journalPath(), current_base, records);
+    if (writeJournal(journalPath(), base, records)) {
+        QFile::remove(prevPath());
+        nextBase = base;
+    }
+}
+
+void CyberiadaSMJournal::slotFlushTimeout()
+{
+    flush();
+    if (!checkpointing && size() > JOURNAL_COMPACTION_SIZE) {
+        emit compactionNeeded();
+    }
+}
+
+bool CyberiadaSMJournal::openJournal(Base base)
+{
+    file.setFileName(journalPath());
+    bool exists = file.exists() && file.size() > 0;
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        return false;
+    }
+    if (!exists) {
+        QDataStream stream(&file);
+        stream.setVersion(QDataStream::Qt_5_0);
+        stream << quint32(JOURNAL_MAGIC) << quint16(JOURNAL_VERSION) << quint8(base);
+    }
+    return true;
+}
+
+void CyberiadaSMJournal::closeJournal()
+{
+    if (file.isOpen()) {
+        file.close();
+    }
+}
+
+void CyberiadaSMJournal::syncFile()
+{
+#if defined(Q_OS_WIN)
+    _commit(file.handle());
+#else
+    ::fsync(file.handle());
+#endif
+}
+
+bool CyberiadaSMJournal::readHeader(QDataStream& stream, Base& base)
+{
+    quint32 magic = 0;
+    quint16 version = 0;
+    quint8 b = 0;
+    stream >> magic >> version >> b;
+    if (stream.status() != QDataStream::Ok || magic != JOURNAL_MAGIC || version != JOURNAL_VERSION) {
+        return false;
+    }
+    base = b == baseSnapshot ? baseSnapshot : baseDocument;
+    return true;
+}
+
+bool CyberiadaSMJournal::readJournal(const QString& path, Base& base, QList<QByteArray>& records)
+{
+    QFile f(path);
+    if (!f.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    QDataStream stream(&f);
+    stream.setVersion(QDataStream::Qt_5_0);
+    if (!readHeader(stream, base)) {
+        return false;
+    }
+    // the tail may be truncated by the crash: stop at the first incomplete or damaged record
+    while (!stream.atEnd()) {
+        quint32 length = 0;
+        quint16 checksum = 0;
+        stream >> length >> checksum;
+        if (stream.status() != QDataStream::Ok || length > quint32(f.size())) {
+            break;
+        }
+        QByteArray record(int(length), Qt::Uninitialized);
+        if (stream.readRawData(record.data(), int(length)) != int(length) ||
+            qChecksum(record.constData(), length) != checksum) {
+            break;
+        }
+        records.append(record);
+    }
+    return true;
+}
+
+bool CyberiadaSMJournal::writeJournal(const QString& path, Base base, const QList<QByteArray>& records)
+{
+    QFile f(path);
+    if (!f.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return false;
+    }
+    QDataStream stream(&f);
+    stream.setVersion(QDataStream::Qt_5_0);
+    stream << quint32(JOURNAL_MAGIC) << quint16(JOURNAL_VERSION) << quint8(base);
+    foreach (const QByteArray& record, records) {
+        stream << quint32(record.size()) << qChecksum(record.constData(), uint(record.size()));
+        stream.writeRawData(record.constData(), record.size());
+    }
+    f.flush();
+#if defined(Q_OS_WIN)
+    _commit(f.handle());
+#else
+    ::fsync(f.handle());
+#endif
+    return stream.status() == QDataStream::Ok;
+}
+
+QDataStream& operator<<(QDataStream& stream, const std::string& s)
+{
+    return stream << QByteArray(s.data(), int(s.size()));
+}
+
+QDataStream& operator>>(QDataStream& stream, std::string& s)
+{
+    QByteArray data;
+    stream >> data;
+    s = std::string(data.constData(), size_t(data.size()));
+    return stream;
+}
+
+QDataStream& operator<<(QDataStream& stream, const Cyberiada::Point& p)
+{
+    return stream << p.valid << double(p.x) << double(p.y);
+}
+
+QDataStream& operator>>(QDataStream& stream, Cyberiada::Point& p)
+{
+    bool valid = false;
+    double x = 0, y = 0;
+    stream >> valid >> x >> y;
+    p = valid ? Cyberiada::Point(x, y) : Cyberiada::Point();
+    return stream;
+}
+
+QDataStream& operator<<(QDataStream& stream, const Cyberiada::Rect& r)
+{
+    return stream << r.valid << double(r.x) << double(r.y) << double(r.width) << double(r.height);
+}
+
+QDataStream& operator>>(QDataStream& stream, Cyberiada::Rect& r)
+{
+    bool valid = false;
+    double x = 0, y = 0, width = 0, height = 0;
+    stream >> valid >> x >> y >> width >> height;
+    r = valid ? Cyberiada::Rect(x, y, width, height) : Cyberiada::Rect();
+    return stream;
+}
+
+QDataStream& operator<<(QDataStream& stream, const Cyberiada::Polyline& pl)
+{
+    stream << quint32(pl.size());
+    for (Cyberiada::Polyline::const_iterator i = pl.begin(); i != pl.end(); i++) {
+        stream << *i;
+    }
+    return stream;
+}
+
+QDataStream& operator>>(QDataStream& stream, Cyberiada::Polyline& pl)
+{
+    quint32 n = 0;
+    stream >> n;
+    pl.clear();
+    for (quint32 i = 0; i < n && stream.status() == QDataStream::Ok; i++) {
+        Cyberiada::Point p;
+        stream >> p;
+        pl.push_back(p);
+    }
+    return stream;
+}
+
+QDataStream& operator<<(QDataStream& stream, const Cyberiada::Action& a)
+{
+    return stream << quint8(a.get_type()) << a.get_trigger() << a.get_guard() << a.get_behavior();
+}
+
+QDataStream& operator>>(QDataStream& stream, Cyberiada::Action& a)
+{
+    quint8 type = 0;
+    std::string trigger, guard, behavior;
+    stream >> type >> trigger >> guard >> behavior;
+    Cyberiada::ActionType action_type = static_cast<Cyberiada::ActionType>(type);
+    if (trigger.empty() && guard.empty() && behavior.empty()) {
+        a = Cyberiada::Action();
+    } else if (action_type == Cyberiada::actionTransition) {
+        a = Cyberiada::Action(trigger, guard, behavior);
+    } else {
+        a = Cyberiada::Action(action_type, behavior);
+    }
+    return stream;
+}
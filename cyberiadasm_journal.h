@@ -0,0 +1,162 @@
+/* -----------------------------------------------------------------------------
+ * The Cyberiada State Machine Editor
+ * -----------------------------------------------------------------------------
+ * 
+ * The Model Edit Journal
+ *
+ * Copyright (C) 2024 Alexey Fedoseev <aleksey@fedoseev.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see https://www.gnu.org/licenses/
+ *
+ * ----------------------------------------------------------------------------- */
+
+#ifndef CYBERIADA_SM_JOURNAL_HEADER
+#define CYBERIADA_SM_JOURNAL_HEADER
+
+#include <QObject>
+#include <QFile>
+#include <QTimer>
+#include <QByteArray>
+#include <QDataStream>
+#include <QList>
+#include <string>
+#include <cyberiada/cyberiadamlpp.h>
+
+// Append-only journal of the model edits kept next to the document (<document>.journal).
+//
+// Every edit is stored as a binary record: quint32 length, quint16 checksum, payload.
+// The records are buffered and written with fsync in batches. The journal refers to a base:
+// either the document file itself or the full snapshot <document>.journal.base made by the
+// compaction. When the base is being rewritten (saving the document or compacting), the
+// current journal is rotated to <document>.journal.prev, so a crash in the middle keeps the
+// old base + the old records. The records are replayed idempotently (creating an existing
+// element or deleting a missing one is skipped), so the short window between replacing
+// the base and dropping the rotated journal is harmless.
+//
+// A journal that is present when the document is opened means the editor was not closed
+// properly; a clean close discards it.
+class CyberiadaSMJournal: public QObject {
+Q_OBJECT
+
+public:
+    enum RecordType {
+        recordID = 1,
+        recordTitle,
+        recordUpdateAction,
+        recordNewAction,
+        recordDeleteAction,
+        recordPoint,
+        recordRect,
+        recordEnds,
+        recordPolyline,
+        recordEndpoints,
+        recordMove,
+        recordNewSM,
+        recordNewState,
+        recordNewInitial,
+        recordNewFinal,
+        recordNewTerminate,
+        recordNewChoice,
+        recordNewTransition,
+        recordNewComment,
+        recordNewFormalComment,
+        recordDelete,
+        recordInsertAction
+    };
+
+    enum Base {
+        baseDocument = 0,
+        baseSnapshot = 1
+    };
+
+    CyberiadaSMJournal(const QString& document_path, QObject* parent = NULL);
+    ~CyberiadaSMJournal();
+
+    const QString&      documentPath() const { return docPath; }
+    QString             journalPath() const;
+    QString             snapshotPath() const;
+
+    // RECOVERY
+    bool                hasRecovery() const;
+    // the document the recovered records should be applied to
+    QString             recoveryBase() const;
+    QList<QByteArray>   recoveryRecords() const;
+    // continue the recovered journal
+    void                resume();
+    // remove all journal files
+    void                discard();
+
+    // RECORDING
+    void                append(const QByteArray& record);
+    void                flush();
+    qint64              size() const;
+
+    // CHECKPOINTS
+    // rotates the journal before the base is rewritten and returns the path of the new base
+    QString             beginCheckpoint(Base base);
+    void                endCheckpoint(bool success);
+    bool                isCheckpointing() const { return checkpointing; }
+
+    template<typename... Args>
+    static QByteArray   encode(RecordType type, const Args&... args);
+
+signals:
+    // the journal has grown enough to be compacted into a full snapshot
+    void                compactionNeeded();
+
+private slots:
+    void                slotFlushTimeout();
+
+private:
+    QString             prevPath() const;
+    bool                openJournal(Base base);
+    void                closeJournal();
+    void                syncFile();
+    static bool         readHeader(QDataStream& stream, Base& base);
+    static bool         readJournal(const QString& path, Base& base, QList<QByteArray>& records);
+    static bool         writeJournal(const QString& path, Base base, const QList<QByteArray>& records);
+
+    QString             docPath;
+    QFile               file;
+    Base                nextBase;
+    QByteArray          buffer;
+    QTimer              flushTimer;
+    bool                checkpointing;
+};
+
+// serialization of the document types used in the records
+QDataStream& operator<<(QDataStream& stream, const std::string& s);
+QDataStream& operator>>(QDataStream& stream, std::string& s);
+QDataStream& operator<<(QDataStream& stream, const Cyberiada::Point& p);
+QDataStream& operator>>(QDataStream& stream, Cyberiada::Point& p);
+QDataStream& operator<<(QDataStream& stream, const Cyberiada::Rect& r);
+QDataStream& operator>>(QDataStream& stream, Cyberiada::Rect& r);
+QDataStream& operator<<(QDataStream& stream, const Cyberiada::Polyline& pl);
+QDataStream& operator>>(QDataStream& stream, Cyberiada::Polyline& pl);
+QDataStream& operator<<(QDataStream& stream, const Cyberiada::Action& a);
+QDataStream& operator>>(QDataStream& stream, Cyberiada::Action& a);
+
+template<typename... Args>
+QByteArray CyberiadaSMJournal::encode(RecordType type, const Args&... args)
+{
+    QByteArray record;
+    QDataStream stream(&record, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_5_0);
+    stream << quint8(type);
+    int unpack[] = {0, ((stream << args), 0)...};
+    (void)unpack;
+    return record;
+}
+
+#endif
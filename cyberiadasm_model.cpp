@@ -28,6 +28,8 @@
 #include <QMessageBox>
 
 #include "cyberiadasm_model.h"
+#include "cyberiadasm_document_saver.h"
+#include "settings_manager.h"
 #include "myassert.h"
 #include "cyberiada_constants.h"
 
@@ -35,6 +37,21 @@ CyberiadaSMModel::CyberiadaSMModel(QObject *parent):
 	QAbstractItemModel(parent)
 {
 	root = NULL;
+	transactionLevel = 0;
+	documentFormat = Cyberiada::formatCyberiada10;
+	saver = NULL;
+	saveQueued = false;
+	queuedFormat = Cyberiada::formatCyberiada10;
+	queuedRound = false;
+	journal = NULL;
+	compactor = NULL;
+	replaying = false;
+	history = new CyberiadaSMUndoStack(this);
+	pendingCommand = NULL;
+	applyingDelta = false;
+	fetchChunk = SettingsManager::instance().getTreeFetchChunk();
+	connect(&SettingsManager::instance(), &SettingsManager::treeSettingsChanged,
+			this, &CyberiadaSMModel::slotTreeSettingsChanged);
 	icons[Cyberiada::elementRoot] = QIcon(":/Icons/images/sm-root.png");
 	icons[Cyberiada::elementSM] = QIcon(":/Icons/images/sm.png");
 	icons[Cyberiada::elementSimpleState] = QIcon(":/Icons/images/state.png");
@@ -46,12 +63,26 @@ CyberiadaSMModel::CyberiadaSMModel(QObject *parent):
 	icons[Cyberiada::elementChoice] = QIcon(":/Icons/images/choice.png");
 	icons[Cyberiada::elementTerminate] = QIcon(":/Icons/images/terminate.png");
 	icons[Cyberiada::elementTransition] = QIcon(":/Icons/images/trans.png");;
+	for (QMap<Cyberiada::ElementType, QIcon>::const_iterator i = icons.constBegin(); i != icons.constEnd(); i++) {
+		iconVariants.insert(i.key(), QVariant(i.value()));
+	}
 
 	cyberiadaStateMimeType = CYBERIADA_MIME_TYPE_STATE;
 }
 
 CyberiadaSMModel::~CyberiadaSMModel()
 {
+	if (saver) {
+		// waits for the save in progress
+		delete saver;
+	}
+	if (compactor) {
+		delete compactor;
+	}
+	if (journal) {
+		// clean close
+		journal->discard();
+	}
 	if (root) {
 		delete root;
 	}
@@ -59,10 +90,19 @@ CyberiadaSMModel::~CyberiadaSMModel()
 
 void CyberiadaSMModel::reset()
 {
+	waitForSnapshot();
 	beginResetModel();
 	if (root) {
 		root->reset();
-	}	
+	}
+	idIndex.clear();
+	adjacency.clear();
+	transitionEnds.clear();
+	invalidateRows();
+	fetchedRows.clear();
+	displayCache.clear();
+	pendingChanges.clear();
+	pendingChangeKinds.clear();
 	endResetModel();	
 }
 
@@ -95,26 +135,513 @@ void CyberiadaSMModel::loadDocument(const QString& path, bool reconstruct, bool
 	}
 
 	if (new_doc) {
-		beginResetModel();
-		if (root) {
-			delete root;
-		}
-		root = new_doc;
-		endResetModel();
+		setDocument(new_doc);
+	}
+}
+
+void CyberiadaSMModel::setDocument(Cyberiada::LocalDocument* new_doc)
+{
+	MY_ASSERT(new_doc);
+	if (journal) {
+		// the previous document is closed cleanly
+		journal->discard();
+		delete journal;
+		journal = NULL;
 	}
+	replaceDocument(new_doc);
+	documentPath = QString(root->get_file_path().c_str());
+	documentFormat = root->get_file_format();
+	startJournal();
+}
+
+void CyberiadaSMModel::replaceDocument(Cyberiada::LocalDocument* new_doc)
+{
+	waitForSnapshot();
+	beginResetModel();
+	if (root) {
+		delete root;
+	}
+	root = new_doc;
+	// the history refers to the elements of the previous document
+	history->reset();
+	if (pendingCommand) {
+		delete pendingCommand;
+		pendingCommand = NULL;
+	}
+	rebuildIDIndex();
+	invalidateRows();
+	fetchedRows.clear();
+	displayCache.clear();
+	pendingChanges.clear();
+	pendingChangeKinds.clear();
+	endResetModel();
 }
 
 void CyberiadaSMModel::saveDocument(bool round)
 {
-	if (root && !root->get_file_path().empty()) {
-		root->save();
+	if (root && hasFilePath()) {
+		startSave(documentPath, documentFormat, round);
 	}
 }
 
 void CyberiadaSMModel::saveAsDocument(const QString& path, Cyberiada::DocumentFormat f, bool round)
 {
 	if (root) {
-		root->save_as(path.toStdString(), f, round);
+		startSave(path, f, round);
+	}
+}
+
+bool CyberiadaSMModel::hasFilePath() const
+{
+	return !documentPath.isEmpty();
+}
+
+const QString& CyberiadaSMModel::filePath() const
+{
+	return documentPath;
+}
+
+bool CyberiadaSMModel::isSaving() const
+{
+	return saver != NULL;
+}
+
+void CyberiadaSMModel::startSave(const QString& path, Cyberiada::DocumentFormat f, bool round)
+{
+	MY_ASSERT(root);
+	if (saver || compactor) {
+		// only the latest request matters: it will snapshot the document as it is then
+		saveQueued = true;
+		queuedPath = path;
+		queuedFormat = f;
+		queuedRound = round;
+		return;
+	}
+
+	// the worker copies the document, the edits wait for the copy only, see waitForSnapshot
+	if (journal && path == documentPath) {
+		// the edits made from now on are journaled against the new file
+		journal->beginCheckpoint(CyberiadaSMJournal::baseDocument);
+	}
+	saver = new CyberiadaSMDocumentSaver(root, path, f, round, this);
+	connect(saver, &QThread::finished, this, &CyberiadaSMModel::slotSaveFinished);
+	emit saveStarted(path);
+	saver->start();
+}
+
+void CyberiadaSMModel::slotSaveFinished()
+{
+	MY_ASSERT(saver);
+	CyberiadaSMDocumentSaver* finished_saver = saver;
+	saver = NULL;
+	if (journal && journal->isCheckpointing()) {
+		journal->endCheckpoint(!finished_saver->hasError());
+	}
+	if (finished_saver->hasError()) {
+		emit saveFailed(finished_saver->path(), finished_saver->error());
+	} else {
+		if (finished_saver->path() != documentPath) {
+			// saved as another file: the journal follows the document
+			if (journal) {
+				journal->discard();
+				delete journal;
+				journal = NULL;
+			}
+			documentPath = finished_saver->path();
+			startJournal();
+		}
+		documentFormat = finished_saver->format();
+		emit saveFinished(finished_saver->path(), finished_saver->saveTime());
+	}
+	finished_saver->deleteLater();
+	startQueuedSave();
+}
+
+void CyberiadaSMModel::waitForSnapshot()
+{
+	// the savers copy the document in their threads, it must not change until they are done
+	if (saver) {
+		saver->waitForSnapshot();
+	}
+	if (compactor) {
+		compactor->waitForSnapshot();
+	}
+}
+
+void CyberiadaSMModel::startQueuedSave()
+{
+	if (saveQueued && root) {
+		saveQueued = false;
+		startSave(queuedPath, queuedFormat, queuedRound);
+	}
+}
+
+bool CyberiadaSMModel::hasRecoveryJournal() const
+{
+	return journal && journal->hasRecovery();
+}
+
+int CyberiadaSMModel::recoverJournal()
+{
+	MY_ASSERT(journal);
+	QString base = journal->recoveryBase();
+	QList<QByteArray> records = journal->recoveryRecords();
+
+	if (base != documentPath) {
+		// the journal continues the compacted snapshot, not the document file
+		Cyberiada::LocalDocument* snapshot = new Cyberiada::LocalDocument();
+		try {
+			snapshot->open(base.toStdString(), Cyberiada::formatDetect, Cyberiada::geometryFormatQt);
+		} catch (const Cyberiada::Exception& e) {
+			qWarning() << "Cannot load the journal snapshot" << base << e.str().c_str();
+			delete snapshot;
+			return -1;
+		}
+		replaceDocument(snapshot);
+	}
+
+	int applied = 0;
+	replaying = true;
+	beginTransaction();
+	foreach (const QByteArray& record, records) {
+		if (applyJournalRecord(record)) {
+			applied++;
+		}
+	}
+	commitTransaction();
+	replaying = false;
+
+	journal->resume();
+	return applied;
+}
+
+void CyberiadaSMModel::discardRecoveryJournal()
+{
+	if (journal) {
+		journal->discard();
+	}
+}
+
+void CyberiadaSMModel::startJournal()
+{
+	if (!hasFilePath()) return;
+	journal = new CyberiadaSMJournal(documentPath, this);
+	connect(journal, &CyberiadaSMJournal::compactionNeeded, this, &CyberiadaSMModel::slotCompactJournal);
+}
+
+void CyberiadaSMModel::slotCompactJournal()
+{
+	if (!root || !journal || saver || compactor || journal->isCheckpointing()) {
+		return;
+	}
+	QString path = journal->beginCheckpoint(CyberiadaSMJournal::baseSnapshot);
+	compactor = new CyberiadaSMDocumentSaver(root, path, documentFormat, false, this);
+	connect(compactor, &QThread::finished, this, &CyberiadaSMModel::slotCompactionFinished);
+	compactor->start();
+}
+
+void CyberiadaSMModel::slotCompactionFinished()
+{
+	MY_ASSERT(compactor);
+	CyberiadaSMDocumentSaver* finished_compactor = compactor;
+	compactor = NULL;
+	if (journal) {
+		journal->endCheckpoint(!finished_compactor->hasError());
+	}
+	if (finished_compactor->hasError()) {
+		qWarning() << "Journal compaction failed:" << finished_compactor->error();
+	}
+	finished_compactor->deleteLater();
+	startQueuedSave();
+}
+
+void CyberiadaSMModel::recordEdit(const Cyberiada::Element* element, const QByteArray& redo,
+								  const QByteArray& undo_record, bool geometry)
+{
+	recordEdit(element, redo, QList<QByteArray>() << undo_record, geometry);
+}
+
+void CyberiadaSMModel::recordEdit(const Cyberiada::Element* element, const QByteArray& redo,
+								  const QList<QByteArray>& undo_records, bool geometry)
+{
+	if (replaying) return;
+	if (journal) {
+		journal->append(redo);
+	}
+	if (applyingDelta) return;
+	if (transactionLevel > 0) {
+		if (!pendingCommand) {
+			pendingCommand = new CyberiadaSMEditCommand(this);
+		}
+		pendingCommand->addDelta(element->get_id(), redo, undo_records, geometry);
+	} else {
+		CyberiadaSMEditCommand* command = new CyberiadaSMEditCommand(this);
+		command->addDelta(element->get_id(), redo, undo_records, geometry);
+		history->pushEdit(command);
+	}
+}
+
+void CyberiadaSMModel::applyDelta(const QList<QByteArray>& records)
+{
+	applyingDelta = true;
+	beginTransaction();
+	foreach (const QByteArray& record, records) {
+		if (!applyJournalRecord(record)) {
+			qWarning() << "Cannot apply the undo record";
+		}
+	}
+	commitTransaction();
+	applyingDelta = false;
+}
+
+void CyberiadaSMModel::encodeCreation(const Cyberiada::Element* element, QList<QByteArray>& records) const
+{
+	const Cyberiada::Element* parent_element = element->get_parent();
+	Cyberiada::ID parent_id = parent_element ? parent_element->get_id() : Cyberiada::ID();
+	Cyberiada::ID id = element->get_id();
+
+	switch (element->get_type()) {
+	case Cyberiada::elementSM: {
+		const Cyberiada::StateMachine* sm = static_cast<const Cyberiada::StateMachine*>(element);
+		records.append(CyberiadaSMJournal::encode(CyberiadaSMJournal::recordNewSM, id, sm->get_name(), sm->get_geometry_rect()));
+		break;
+	}
+	case Cyberiada::elementSimpleState:
+	case Cyberiada::elementCompositeState: {
+		const Cyberiada::State* state = static_cast<const Cyberiada::State*>(element);
+		records.append(CyberiadaSMJournal::encode(CyberiadaSMJournal::recordNewState, parent_id, id, state->get_name(),
+												  Cyberiada::Action(), state->get_geometry_rect(),
+												  state->get_region_geometry_rect(), state->get_color()));
+		const std::vector<Cyberiada::Action>& actions = state->get_actions();
+		for (size_t i = 0; i < actions.size(); i++) {
+			records.append(CyberiadaSMJournal::encode(CyberiadaSMJournal::recordInsertAction, id, qint32(i), actions[i]));
+		}
+		break;
+	}
+	case Cyberiada::elementInitial:
+	case Cyberiada::elementFinal:
+	case Cyberiada::elementTerminate: {
+		const Cyberiada::Vertex* v = static_cast<const Cyberiada::Vertex*>(element);
+		CyberiadaSMJournal::RecordType type = CyberiadaSMJournal::recordNewInitial;
+		if (element->get_type() == Cyberiada::elementFinal) {
+			type = CyberiadaSMJournal::recordNewFinal;
+		} else if (element->get_type() == Cyberiada::elementTerminate) {
+			type = CyberiadaSMJournal::recordNewTerminate;
+		}
+		records.append(CyberiadaSMJournal::encode(type, parent_id, id, v->get_geometry_point()));
+		break;
+	}
+	case Cyberiada::elementChoice: {
+		const Cyberiada::ChoicePseudostate* choice = static_cast<const Cyberiada::ChoicePseudostate*>(element);
+		records.append(CyberiadaSMJournal::encode(CyberiadaSMJournal::recordNewChoice, parent_id, id,
+												  choice->get_geometry_rect(), choice->get_color()));
+		break;
+	}
+	case Cyberiada::elementComment:
+	case Cyberiada::elementFormalComment: {
+		const Cyberiada::Comment* comment = static_cast<const Cyberiada::Comment*>(element);
+		records.append(CyberiadaSMJournal::encode(element->get_type() == Cyberiada::elementComment ?
+												  CyberiadaSMJournal::recordNewComment :
+												  CyberiadaSMJournal::recordNewFormalComment,
+												  parent_id, id, comment->get_body(), comment->get_geometry_rect(),
+												  comment->get_color(), comment->get_markup()));
+		break;
+	}
+	case Cyberiada::elementTransition: {
+		const Cyberiada::Transition* trans = static_cast<const Cyberiada::Transition*>(element);
+		records.append(CyberiadaSMJournal::encode(CyberiadaSMJournal::recordNewTransition, parent_id, id,
+												  quint8(trans->get_transition_type()),
+												  trans->source_element_id(), trans->target_element_id(),
+												  trans->get_action(), trans->get_geometry_polyline(),
+												  trans->get_source_point(), trans->get_target_point(),
+												  trans->get_label_point(), trans->get_label_rect(), trans->get_color()));
+		break;
+	}
+	default:
+		qWarning() << "Cannot restore the element" << id.c_str();
+		return;
+	}
+
+	if (element->has_children()) {
+		const Cyberiada::ElementCollection* collection = static_cast<const Cyberiada::ElementCollection*>(element);
+		const Cyberiada::ElementList& children = collection->get_children();
+		for (Cyberiada::ElementList::const_iterator i = children.begin(); i != children.end(); i++) {
+			encodeCreation(*i, records);
+		}
+	}
+}
+
+void CyberiadaSMModel::restoreID(Cyberiada::Element* element, const Cyberiada::ID& id)
+{
+	if (element && element->get_id() != id) {
+		updateID(elementToIndex(element), QString(id.c_str()));
+	}
+}
+
+bool CyberiadaSMModel::applyJournalRecord(const QByteArray& record)
+{
+	waitForSnapshot();
+	QDataStream stream(record);
+	stream.setVersion(QDataStream::Qt_5_0);
+	quint8 type = 0;
+	Cyberiada::ID id, parent_id;
+	stream >> type;
+
+	// creating an available element or editing a missing one is skipped
+	switch (type) {
+	case CyberiadaSMJournal::recordNewSM: {
+		Cyberiada::String name;
+		Cyberiada::Rect r;
+		stream >> id >> name >> r;
+		if (findElementByID(id)) return false;
+		restoreID(newStateMachine(name, r), id);
+		return true;
+	}
+	case CyberiadaSMJournal::recordNewState:
+	case CyberiadaSMJournal::recordNewInitial:
+	case CyberiadaSMJournal::recordNewFinal:
+	case CyberiadaSMJournal::recordNewTerminate:
+	case CyberiadaSMJournal::recordNewChoice:
+	case CyberiadaSMJournal::recordNewComment:
+	case CyberiadaSMJournal::recordNewFormalComment: {
+		stream >> parent_id >> id;
+		Cyberiada::ElementCollection* parent = dynamic_cast<Cyberiada::ElementCollection*>(findElementByID(parent_id));
+		if (!parent || findElementByID(id)) return false;
+		Cyberiada::Element* element = NULL;
+		if (type == CyberiadaSMJournal::recordNewState) {
+			Cyberiada::String name;
+			Cyberiada::Action a;
+			Cyberiada::Rect r, region;
+			Cyberiada::Color color;
+			stream >> name >> a >> r >> region >> color;
+			element = newState(parent, name, a, r, region, color);
+		} else if (type == CyberiadaSMJournal::recordNewChoice) {
+			Cyberiada::Rect r;
+			Cyberiada::Color color;
+			stream >> r >> color;
+			element = newChoice(parent, r, color);
+		} else if (type == CyberiadaSMJournal::recordNewComment || type == CyberiadaSMJournal::recordNewFormalComment) {
+			Cyberiada::String body, markup;
+			Cyberiada::Rect r;
+			Cyberiada::Color color;
+			stream >> body >> r >> color >> markup;
+			if (type == CyberiadaSMJournal::recordNewComment) {
+				element = newComment(parent, body, r, color, markup);
+			} else {
+				element = newFormalComment(parent, body, r, color, markup);
+			}
+		} else {
+			Cyberiada::Point p;
+			stream >> p;
+			if (type == CyberiadaSMJournal::recordNewInitial) {
+				element = newInitial(parent, p);
+			} else if (type == CyberiadaSMJournal::recordNewFinal) {
+				element = newFinal(parent, p);
+			} else {
+				element = newTerminate(parent, p);
+			}
+		}
+		restoreID(element, id);
+		return element != NULL;
+	}
+	case CyberiadaSMJournal::recordNewTransition: {
+		quint8 ttype = 0;
+		Cyberiada::ID source_id, target_id;
+		Cyberiada::Action a;
+		Cyberiada::Polyline pl;
+		Cyberiada::Point sp, tp, label_point;
+		Cyberiada::Rect label_rect;
+		Cyberiada::Color color;
+		stream >> parent_id >> id >> ttype >> source_id >> target_id >> a >> pl >> sp >> tp >> label_point >> label_rect >> color;
+		Cyberiada::StateMachine* sm = dynamic_cast<Cyberiada::StateMachine*>(findElementByID(parent_id));
+		Cyberiada::Element* source = findElementByID(source_id);
+		Cyberiada::Element* target = findElementByID(target_id);
+		if (!sm || !source || !target || findElementByID(id)) return false;
+		restoreID(newTransition(sm, static_cast<Cyberiada::TransitionType>(ttype), source, target,
+								a, pl, sp, tp, label_point, label_rect, color), id);
+		return true;
+	}
+	default:
+		break;
+	}
+
+	stream >> id;
+	Cyberiada::Element* element = findElementByID(id);
+	if (!element) return false;
+	QModelIndex index = elementToIndex(element);
+
+	switch (type) {
+	case CyberiadaSMJournal::recordID: {
+		Cyberiada::ID new_id;
+		stream >> new_id;
+		return updateID(index, QString(new_id.c_str()));
+	}
+	case CyberiadaSMJournal::recordTitle: {
+		Cyberiada::Name name;
+		stream >> name;
+		return updateTitle(index, QString(name.c_str()));
+	}
+	case CyberiadaSMJournal::recordUpdateAction:
+	case CyberiadaSMJournal::recordNewAction: {
+		qint32 n = 0;
+		quint8 action_type = 0;
+		QString trigger, guard, behaviour;
+		if (type == CyberiadaSMJournal::recordUpdateAction) {
+			stream >> n;
+		} else {
+			stream >> action_type;
+		}
+		stream >> trigger >> guard >> behaviour;
+		if (type == CyberiadaSMJournal::recordUpdateAction) {
+			return updateAction(index, n, trigger, guard, behaviour);
+		}
+		return newAction(index, static_cast<Cyberiada::ActionType>(action_type), trigger, guard, behaviour);
+	}
+	case CyberiadaSMJournal::recordDeleteAction: {
+		qint32 n = 0;
+		stream >> n;
+		return deleteAction(index, n);
+	}
+	case CyberiadaSMJournal::recordInsertAction: {
+		qint32 n = 0;
+		Cyberiada::Action a;
+		stream >> n >> a;
+		return insertAction(index, n, a);
+	}
+	case CyberiadaSMJournal::recordPoint: {
+		Cyberiada::Point p;
+		stream >> p;
+		return updateGeometry(index, p);
+	}
+	case CyberiadaSMJournal::recordRect: {
+		Cyberiada::Rect r;
+		stream >> r;
+		return updateGeometry(index, r);
+	}
+	case CyberiadaSMJournal::recordEnds: {
+		Cyberiada::Point source, target;
+		stream >> source >> target;
+		return updateGeometry(index, source, target);
+	}
+	case CyberiadaSMJournal::recordPolyline: {
+		Cyberiada::Polyline pl;
+		stream >> pl;
+		return updateGeometry(index, pl);
+	}
+	case CyberiadaSMJournal::recordEndpoints: {
+		Cyberiada::ID source, target;
+		stream >> source >> target;
+		return updateGeometry(index, source, target);
+	}
+	case CyberiadaSMJournal::recordMove: {
+		stream >> parent_id;
+		return updateParent(index, parent_id);
+	}
+	case CyberiadaSMJournal::recordDelete:
+		return deleteElement(index);
+	default:
+		qWarning() << "Unknown journal record" << type;
+		return false;
 	}
 }
 
@@ -137,36 +664,17 @@ QVariant CyberiadaSMModel::data(const QModelIndex &index, int role) const
 				const Cyberiada::Document* doc = static_cast<const Cyberiada::Document*>(element);
 				MY_ASSERT(doc);
 				return QString(doc->meta().get_string(CYBERIADA_META_NAME).c_str());
-			} else if (element->get_type() == Cyberiada::elementTransition) {
-				const Cyberiada::Transition* trans = static_cast<const Cyberiada::Transition*>(element);
-				QString id = trans->source_element_id().c_str();
-				const Cyberiada::Element* source = idToElement(id);
-				MY_ASSERT(source);
-				QString source_name = source->get_name().c_str();
-				if (source_name.isEmpty()) {
-					source_name = QString("[") + source->get_id().c_str() + "]";
-				}
-				id = trans->target_element_id().c_str();
-				const Cyberiada::Element* target = idToElement(id);
-				MY_ASSERT(target);
-				QString target_name = target->get_name().c_str();
-				if (target_name.isEmpty()) {
-					target_name = QString("[") + target->get_id().c_str() + "]";
-				}				
-				return QString(source_name + " -> " + target_name);
 			} else {
-				QString name = element->get_name().c_str();
-				if (name.isEmpty()) {
-					name = QString("[") + element->get_id().c_str() + "]";
-				}
-				return name;
+				return displayString(element);
 			}
 		} else {
 			return QVariant();
 		}
 	case Qt::DecorationRole:
 		if (column == 0) {
-			return QVariant(getIndexIcon(index));
+			element = static_cast<const Cyberiada::Element*>(index.internalPointer());
+			MY_ASSERT(element);
+			return iconVariants.value(element->get_type());
 		} else {
 			return QVariant();
 		}
@@ -175,16 +683,76 @@ QVariant CyberiadaSMModel::data(const QModelIndex &index, int role) const
 	}
 }
 
-QIcon CyberiadaSMModel::getElementIcon(Cyberiada::ElementType type) const
+QString CyberiadaSMModel::elementDisplayName(const Cyberiada::Element* element) const
+{
+	QString name = element->get_name().c_str();
+	if (name.isEmpty()) {
+		name = QString("[") + element->get_id().c_str() + "]";
+	}
+	return name;
+}
+
+const QString& CyberiadaSMModel::displayString(const Cyberiada::Element* element) const
 {
-	if (icons.find(type) != icons.end()) {
-		return icons[type];
+	QHash<const Cyberiada::Element*, DisplayCacheEntry>::const_iterator i = displayCache.constFind(element);
+	if (i != displayCache.constEnd()) {
+		return i.value().text;
+	}
+	DisplayCacheEntry entry;
+	entry.source = entry.target = NULL;
+	if (element->get_type() == Cyberiada::elementTransition) {
+		const Cyberiada::Transition* trans = static_cast<const Cyberiada::Transition*>(element);
+		entry.source = findElementByID(trans->source_element_id());
+		MY_ASSERT(entry.source);
+		entry.target = findElementByID(trans->target_element_id());
+		MY_ASSERT(entry.target);
+		entry.text = elementDisplayName(entry.source) + " -> " + elementDisplayName(entry.target);
+	} else {
+		entry.text = elementDisplayName(element);
+	}
+	return displayCache.insert(element, entry).value().text;
+}
+
+void CyberiadaSMModel::invalidateDisplay(const Cyberiada::Element* element, ChangeKinds kinds)
+{
+	if (!(kinds & (ChangeTitle | ChangeID | ChangeEndpoints)) || displayCache.isEmpty()) {
+		return;
+	}
+	displayCache.remove(element);
+	if (element->get_type() == Cyberiada::elementTransition) {
+		return;
+	}
+	// the transitions show the names of their ends; the adjacency lists only the transitions
+	// that can depend on the element
+	QHash<const Cyberiada::Element*, QList<Cyberiada::Element*> >::const_iterator a = adjacency.constFind(element);
+	if (a == adjacency.constEnd()) {
+		return;
+	}
+	const QList<Cyberiada::Element*>& transitions = a.value();
+	for (int i = 0; i < transitions.size(); i++) {
+		QHash<const Cyberiada::Element*, DisplayCacheEntry>::iterator c = displayCache.find(transitions[i]);
+		if (c == displayCache.end() || (c.value().source != element && c.value().target != element)) {
+			continue;
+		}
+		displayCache.erase(c);
+		QModelIndex index = elementToIndex(transitions[i]);
+		if (isFetchedIndex(index)) {
+			emit dataChanged(index, index);
+		}
+	}
+}
+
+const QIcon& CyberiadaSMModel::getElementIcon(Cyberiada::ElementType type) const
+{
+	QMap<Cyberiada::ElementType, QIcon>::const_iterator i = icons.constFind(type);
+	if (i != icons.constEnd()) {
+		return i.value();
 	} else {
 		return emptyIcon;
 	}	
 }
 
-QIcon CyberiadaSMModel::getIndexIcon(const QModelIndex& index) const
+const QIcon& CyberiadaSMModel::getIndexIcon(const QModelIndex& index) const
 {
 	if (!index.isValid() || index == rootIndex()) return emptyIcon;
 	const Cyberiada::Element *element = static_cast<const Cyberiada::Element*>(index.internalPointer());
@@ -202,6 +770,7 @@ bool CyberiadaSMModel::setData(const QModelIndex& index, const QVariant& value,
 
 bool CyberiadaSMModel::updateID(const QModelIndex& index, const QString& new_value)
 {
+	waitForSnapshot();
 	Cyberiada::Element* element = indexToElement(index);
 	if (!element) return false;
 	if (new_value.size() == 0) {
@@ -209,22 +778,32 @@ bool CyberiadaSMModel::updateID(const QModelIndex& index, const QString& new_val
 		return false;
 	}
 	Cyberiada::ID new_id(new_value.toStdString());
-	if (root->find_element_by_id(new_id) != NULL) {
+	if (findElementByID(new_id) != NULL) {
 		// the id is already available in the document
 		return false;
 	}
+	Cyberiada::ID old_id = element->get_id();
+	idIndex.erase(old_id);
 	element->set_id(new_id);
-	emit dataChanged(index, index);
+	idIndex[new_id] = element;
+	recordEdit(element, CyberiadaSMJournal::encode(CyberiadaSMJournal::recordID, old_id, new_id),
+			   CyberiadaSMJournal::encode(CyberiadaSMJournal::recordID, new_id, old_id));
+	emit elementIDChanged(index, QString(old_id.c_str()));
+	notifyElementChanged(index, ChangeID);
 	return true;
 }
 
 bool CyberiadaSMModel::updateTitle(const QModelIndex& index, const QString& new_value)
 {
+	waitForSnapshot();
 	Cyberiada::Element* element = indexToElement(index);
 	if (!element) return false;
 	Cyberiada::Name new_name(new_value.toStdString());
+	Cyberiada::Name old_name = element->get_name();
 	element->set_name(new_name);
-	emit dataChanged(index, index);
+	recordEdit(element, CyberiadaSMJournal::encode(CyberiadaSMJournal::recordTitle, element->get_id(), new_name),
+			   CyberiadaSMJournal::encode(CyberiadaSMJournal::recordTitle, element->get_id(), old_name));
+	notifyElementChanged(index, ChangeTitle);
 	return true;
 }
 
@@ -232,8 +811,11 @@ bool CyberiadaSMModel::updateAction(const QModelIndex& index,
 									int action_index, const QString& new_trigger, const QString& new_guard,
 									const QString& new_behaviour)
 {
+	waitForSnapshot();
 	Cyberiada::Element* element = indexToElement(index);
 	if (!element) return false;
+	Cyberiada::Action old_action;
+	bool had_action = true;
 	if (element->get_type() == Cyberiada::elementSimpleState || element->get_type() == Cyberiada::elementCompositeState) {
 		Cyberiada::State* state = static_cast<Cyberiada::State*>(element);
 		std::vector<Cyberiada::Action>& actions = state->get_actions();
@@ -241,6 +823,7 @@ bool CyberiadaSMModel::updateAction(const QModelIndex& index,
 			return false;
 		}
 		Cyberiada::Action& a = actions[action_index];
+		old_action = a;
         if (a.get_type() != Cyberiada::actionTransition) {
 			a.update(new_behaviour.toStdString());
         } else {
@@ -250,22 +833,38 @@ bool CyberiadaSMModel::updateAction(const QModelIndex& index,
     } else if (element->get_type() == Cyberiada::elementTransition) {
 		if (new_trigger.length() == 0) return false;
 		Cyberiada::Transition* trans = static_cast<Cyberiada::Transition*>(element);
+		old_action = trans->get_action();
+		had_action = trans->has_action();
 		trans->get_action().update(new_trigger.toStdString(), new_guard.toStdString(), new_behaviour.toStdString());
 	} else {
 		return false;
 	}
-	emit dataChanged(index, index);
+	QList<QByteArray> undo_records;
+	undo_records.append(CyberiadaSMJournal::encode(CyberiadaSMJournal::recordDeleteAction, element->get_id(), qint32(action_index)));
+	if (had_action) {
+		// the old action is stored as is: updateAction rejects the transition actions without triggers
+		undo_records.append(CyberiadaSMJournal::encode(CyberiadaSMJournal::recordInsertAction, element->get_id(), qint32(action_index),
+													   old_action));
+	}
+	recordEdit(element, CyberiadaSMJournal::encode(CyberiadaSMJournal::recordUpdateAction, element->get_id(), qint32(action_index),
+												   new_trigger, new_guard, new_behaviour),
+			   undo_records);
+	notifyElementChanged(index, ChangeActions);
 	return true;
 }
 
 bool CyberiadaSMModel::newAction(const QModelIndex& index, Cyberiada::ActionType type, const QString& trigger, const QString& guard,
 								 const QString& behaviour)
 {
+	waitForSnapshot();
 	Cyberiada::Element* element = indexToElement(index);
 	if (!element) return false;
+	// the position of the new action for the undo
+	int action_index = -1;
 	if (element->get_type() == Cyberiada::elementSimpleState || element->get_type() == Cyberiada::elementCompositeState) {
 		Cyberiada::State* state = static_cast<Cyberiada::State*>(element);
 		std::vector<Cyberiada::Action>& actions = state->get_actions();
+		action_index = int(actions.size());
 		if (type == Cyberiada::actionTransition) { 
 			if (trigger.length() == 0) return false;
 			actions.push_back(Cyberiada::Action(trigger.toStdString(), guard.toStdString(), behaviour.toStdString()));
@@ -283,103 +882,164 @@ bool CyberiadaSMModel::newAction(const QModelIndex& index, Cyberiada::ActionType
 	} else {
 		return false;
 	}
-	emit dataChanged(index, index);
+	recordEdit(element, CyberiadaSMJournal::encode(CyberiadaSMJournal::recordNewAction, element->get_id(), quint8(type),
+												   trigger, guard, behaviour),
+			   CyberiadaSMJournal::encode(CyberiadaSMJournal::recordDeleteAction, element->get_id(), qint32(action_index)));
+	notifyElementChanged(index, ChangeActions);
 	return true;
 }
 
 bool CyberiadaSMModel::deleteAction(const QModelIndex& index, int action_index)
 {
+	waitForSnapshot();
 	Cyberiada::Element* element = indexToElement(index);
 	if (!element) return false;
+	Cyberiada::Action old_action;
 	if (element->get_type() == Cyberiada::elementSimpleState || element->get_type() == Cyberiada::elementCompositeState) {
 		Cyberiada::State* state = static_cast<Cyberiada::State*>(element);
 		std::vector<Cyberiada::Action>& actions = state->get_actions();
 		if (action_index < 0 || action_index >= actions.size()) {
 			return false;
 		}
+		old_action = actions[action_index];
 		actions.erase(actions.begin() + static_cast<size_t>(action_index));
     } else if (element->get_type() == Cyberiada::elementTransition) {
 		Cyberiada::Transition* trans = static_cast<Cyberiada::Transition*>(element);
 		if (!trans->has_action()) {
 			return false;
 		}
+		old_action = trans->get_action();
 		trans->get_action().clear();
 	} else {
 		return false;
 	}
-	emit dataChanged(index, index);
+	recordEdit(element, CyberiadaSMJournal::encode(CyberiadaSMJournal::recordDeleteAction, element->get_id(), qint32(action_index)),
+			   CyberiadaSMJournal::encode(CyberiadaSMJournal::recordInsertAction, element->get_id(), qint32(action_index), old_action));
+	notifyElementChanged(index, ChangeActions);
+	return true;
+}
+
+bool CyberiadaSMModel::insertAction(const QModelIndex& index, int action_index, const Cyberiada::Action& action)
+{
+	waitForSnapshot();
+	Cyberiada::Element* element = indexToElement(index);
+	if (!element) return false;
+	if (element->get_type() == Cyberiada::elementSimpleState || element->get_type() == Cyberiada::elementCompositeState) {
+		Cyberiada::State* state = static_cast<Cyberiada::State*>(element);
+		std::vector<Cyberiada::Action>& actions = state->get_actions();
+		if (action_index < 0 || action_index > actions.size()) {
+			action_index = int(actions.size());
+		}
+		actions.insert(actions.begin() + static_cast<size_t>(action_index), action);
+	} else if (element->get_type() == Cyberiada::elementTransition) {
+		Cyberiada::Transition* trans = static_cast<Cyberiada::Transition*>(element);
+		if (trans->has_action()) {
+			return false;
+		}
+		trans->get_action().update(action.get_trigger(), action.get_guard(), action.get_behavior());
+	} else {
+		return false;
+	}
+	recordEdit(element, CyberiadaSMJournal::encode(CyberiadaSMJournal::recordInsertAction, element->get_id(), qint32(action_index), action),
+			   CyberiadaSMJournal::encode(CyberiadaSMJournal::recordDeleteAction, element->get_id(), qint32(action_index)));
+	notifyElementChanged(index, ChangeActions);
 	return true;
 }
 
 bool CyberiadaSMModel::updateGeometry(const QModelIndex& index, const Cyberiada::Point& point)
 {
+	waitForSnapshot();
 	Cyberiada::Element* element = indexToElement(index);
 	if (!element) return false;
 	if (!element->has_point_geometry()) return false;
 	Cyberiada::Vertex* v = static_cast<Cyberiada::Vertex*>(element);
+	Cyberiada::Point old_point = v->get_geometry_point();
 	v->update_geometry(point);
-	emit dataChanged(index, index);
+	recordEdit(element, CyberiadaSMJournal::encode(CyberiadaSMJournal::recordPoint, element->get_id(), point),
+			   CyberiadaSMJournal::encode(CyberiadaSMJournal::recordPoint, element->get_id(), old_point), true);
+	notifyElementChanged(index, ChangeGeometry);
 	return true;
 }
 
 bool CyberiadaSMModel::updateGeometry(const QModelIndex& index, const Cyberiada::Rect& rect)
 {
+	waitForSnapshot();
 	Cyberiada::Element* element = indexToElement(index);
     if (!element) return false;
     if (!element->has_rect_geometry()) return false;
+	Cyberiada::Rect old_rect;
     if (element->get_type() == Cyberiada::elementComment || element->get_type() == Cyberiada::elementFormalComment) {
 		Cyberiada::Comment* comment = static_cast<Cyberiada::Comment*>(element);
+		old_rect = comment->get_geometry_rect();
         comment->update_geometry(rect);
 	} else {
 		Cyberiada::ElementCollection* ec = static_cast<Cyberiada::ElementCollection*>(element);
+		old_rect = ec->get_geometry_rect();
         ec->update_geometry(rect);
 	}
-	emit dataChanged(index, index);
+	recordEdit(element, CyberiadaSMJournal::encode(CyberiadaSMJournal::recordRect, element->get_id(), rect),
+			   CyberiadaSMJournal::encode(CyberiadaSMJournal::recordRect, element->get_id(), old_rect), true);
+	notifyElementChanged(index, ChangeGeometry);
 	return true;
 }
 
 bool CyberiadaSMModel::updateGeometry(const QModelIndex& index, const Cyberiada::Point& source, const Cyberiada::Point& target)
 {
+	waitForSnapshot();
 	Cyberiada::Element* element = indexToElement(index);
 	if (!element) return false;
 	if (element->get_type() != Cyberiada::elementTransition) return false;
 	Cyberiada::Transition* trans = static_cast<Cyberiada::Transition*>(element);
+	Cyberiada::Point old_source = trans->get_source_point(), old_target = trans->get_target_point();
     // TODO
     trans->update(source, target);
-	emit dataChanged(index, index);
+	recordEdit(element, CyberiadaSMJournal::encode(CyberiadaSMJournal::recordEnds, element->get_id(), source, target),
+			   CyberiadaSMJournal::encode(CyberiadaSMJournal::recordEnds, element->get_id(), old_source, old_target), true);
+	notifyElementChanged(index, ChangeGeometry);
 	return true;
 }
 
 bool CyberiadaSMModel::updateGeometry(const QModelIndex& index, const Cyberiada::Polyline& pl)
 {
+	waitForSnapshot();
 	Cyberiada::Element* element = indexToElement(index);
 	if (!element) return false;
 	if (element->get_type() != Cyberiada::elementTransition) return false;
 	Cyberiada::Transition* trans = static_cast<Cyberiada::Transition*>(element);
+	Cyberiada::Polyline old_pl = trans->get_geometry_polyline();
 	// TODO
     trans->update(pl);
-	emit dataChanged(index, index);
+	recordEdit(element, CyberiadaSMJournal::encode(CyberiadaSMJournal::recordPolyline, element->get_id(), pl),
+			   CyberiadaSMJournal::encode(CyberiadaSMJournal::recordPolyline, element->get_id(), old_pl), true);
+	notifyElementChanged(index, ChangeGeometry);
 	return true;
 }
 
 bool CyberiadaSMModel::updateGeometry(const QModelIndex &index, const Cyberiada::ID &source, const Cyberiada::ID &target)
 {
+    waitForSnapshot();
     Cyberiada::Element* element = indexToElement(index);
     if (!element) return false;
     if (element->get_type() != Cyberiada::elementTransition) return false;
     Cyberiada::Transition* trans = static_cast<Cyberiada::Transition*>(element);
     // TODO
-    if (root->find_element_by_id(source) == NULL || root->find_element_by_id(target) == NULL) {
+    if (findElementByID(source) == NULL || findElementByID(target) == NULL) {
         // the id isn't available in the document
         return false;
     }
+    Cyberiada::ID old_source = trans->source_element_id(), old_target = trans->target_element_id();
+    unlinkTransitions(trans);
     trans->update(source, target);
-    emit dataChanged(index, index);
+    linkTransitions(trans);
+    recordEdit(element, CyberiadaSMJournal::encode(CyberiadaSMJournal::recordEndpoints, element->get_id(), source, target),
+               CyberiadaSMJournal::encode(CyberiadaSMJournal::recordEndpoints, element->get_id(), old_source, old_target));
+    notifyElementChanged(index, ChangeEndpoints);
     return true;
 }
 
 bool CyberiadaSMModel::updateParent(const QModelIndex &index, const Cyberiada::ID &new_parent_id)
 {
+    waitForSnapshot();
     Cyberiada::Element* element = indexToElement(index);
     if (!element) return false;
     Cyberiada::ElementCollection* new_parent = dynamic_cast<Cyberiada::ElementCollection*>(idToElement(new_parent_id.c_str()));
@@ -394,34 +1054,41 @@ bool CyberiadaSMModel::updateParent(const QModelIndex &index, const Cyberiada::I
 
 bool CyberiadaSMModel::updateCommentBody(const QModelIndex& index, const QString& body)
 {
+	waitForSnapshot();
 	Cyberiada::Element* element = indexToElement(index);
 	if (!element) return false;
     // TODO
-	emit dataChanged(index, index);
+	notifyElementChanged(index, ChangeTitle);
 	return true;
 }
 
 bool CyberiadaSMModel::updateMetainformation(const QModelIndex& index, const QString& parameter, const QString& new_value)
 {
+	waitForSnapshot();
 	if (index != documentIndex()) {
 		return false;
 	}
 	QModelIndex comment_index = elementToIndex(root->get_meta_element());
-	emit dataChanged(comment_index, comment_index);
-	emit dataChanged(index, index);
+	notifyElementChanged(comment_index, ChangeMetadata);
+	notifyElementChanged(index, ChangeMetadata);
 	return true;
 }
 
 Cyberiada::StateMachine *CyberiadaSMModel::newStateMachine(const Cyberiada::String &sm_name, const Cyberiada::Rect &r)
 {
+    waitForSnapshot();
     if (root == NULL) {
         root = new Cyberiada::LocalDocument();
     }
 
-    int row = rowCount(rootIndex());
-    beginInsertRows(rootIndex(), row + 1, row + 1);
+    QModelIndex parent_index = documentIndex();
+    bool exposed = beginAppendRow(parent_index);
     Cyberiada::StateMachine* element = root->new_state_machine(sm_name, r);
-    endInsertRows();
+    indexElement(element);
+    recordEdit(element, CyberiadaSMJournal::encode(CyberiadaSMJournal::recordNewSM, element->get_id(), sm_name, r),
+               CyberiadaSMJournal::encode(CyberiadaSMJournal::recordDelete, element->get_id()));
+    endAppendRow(parent_index, exposed);
+    emit elementInserted(elementToIndex(element));
 
     return element;
 }
@@ -430,42 +1097,57 @@ Cyberiada::State *CyberiadaSMModel::newState(Cyberiada::ElementCollection *paren
                                              const Cyberiada::Action &a, const Cyberiada::Rect &r, const Cyberiada::Rect &region,
                                              const Cyberiada::Color &color)
 {
+    waitForSnapshot();
     if (root == NULL) {
         return nullptr;
     }
 
-    int row = rowCount(elementToIndex(parent));
-    beginInsertRows(elementToIndex(parent), row + 1, row + 1);
+    QModelIndex parent_index = elementToIndex(parent);
+    bool exposed = beginAppendRow(parent_index);
     Cyberiada::State* element = root->new_state(parent, state_name, a, r, region, color);
-    endInsertRows();
+    indexElement(element);
+    recordEdit(element, CyberiadaSMJournal::encode(CyberiadaSMJournal::recordNewState, parent->get_id(), element->get_id(), state_name, a, r, region, color),
+               CyberiadaSMJournal::encode(CyberiadaSMJournal::recordDelete, element->get_id()));
+    endAppendRow(parent_index, exposed);
+    emit elementInserted(elementToIndex(element));
 
     return element;
 }
 
 Cyberiada::InitialPseudostate *CyberiadaSMModel::newInitial(Cyberiada::ElementCollection *parent, const Cyberiada::Point &p)
 {
+    waitForSnapshot();
     if (root == NULL) {
         return nullptr;
     }
 
-    int row = rowCount(elementToIndex(parent));
-    beginInsertRows(elementToIndex(parent), row + 1, row + 1);
+    QModelIndex parent_index = elementToIndex(parent);
+    bool exposed = beginAppendRow(parent_index);
     Cyberiada::InitialPseudostate* element = root->new_initial(parent, p);
-    endInsertRows();
+    indexElement(element);
+    recordEdit(element, CyberiadaSMJournal::encode(CyberiadaSMJournal::recordNewInitial, parent->get_id(), element->get_id(), p),
+               CyberiadaSMJournal::encode(CyberiadaSMJournal::recordDelete, element->get_id()));
+    endAppendRow(parent_index, exposed);
+    emit elementInserted(elementToIndex(element));
 
     return element;
 }
 
 Cyberiada::FinalState *CyberiadaSMModel::newFinal(Cyberiada::ElementCollection *parent, const Cyberiada::Point &p)
 {
+    waitForSnapshot();
     if (root == NULL) {
         return nullptr;
     }
 
-    int row = rowCount(elementToIndex(parent));
-    beginInsertRows(elementToIndex(parent), row + 1, row + 1);
+    QModelIndex parent_index = elementToIndex(parent);
+    bool exposed = beginAppendRow(parent_index);
     Cyberiada::FinalState* element = root->new_final(parent, p);
-    endInsertRows();
+    indexElement(element);
+    recordEdit(element, CyberiadaSMJournal::encode(CyberiadaSMJournal::recordNewFinal, parent->get_id(), element->get_id(), p),
+               CyberiadaSMJournal::encode(CyberiadaSMJournal::recordDelete, element->get_id()));
+    endAppendRow(parent_index, exposed);
+    emit elementInserted(elementToIndex(element));
 
     return element;
 }
@@ -473,28 +1155,38 @@ Cyberiada::FinalState *CyberiadaSMModel::newFinal(Cyberiada::ElementCollection *
 Cyberiada::ChoicePseudostate *CyberiadaSMModel::newChoice(Cyberiada::ElementCollection *parent, const Cyberiada::Rect &r,
                                                           const Cyberiada::Color &color)
 {
+    waitForSnapshot();
     if (root == NULL) {
         return nullptr;
     }
 
-    int row = rowCount(elementToIndex(parent));
-    beginInsertRows(elementToIndex(parent), row + 1, row + 1);
+    QModelIndex parent_index = elementToIndex(parent);
+    bool exposed = beginAppendRow(parent_index);
     Cyberiada::ChoicePseudostate* element = root->new_choice(parent, r, color);
-    endInsertRows();
+    indexElement(element);
+    recordEdit(element, CyberiadaSMJournal::encode(CyberiadaSMJournal::recordNewChoice, parent->get_id(), element->get_id(), r, color),
+               CyberiadaSMJournal::encode(CyberiadaSMJournal::recordDelete, element->get_id()));
+    endAppendRow(parent_index, exposed);
+    emit elementInserted(elementToIndex(element));
 
     return element;
 }
 
 Cyberiada::TerminatePseudostate *CyberiadaSMModel::newTerminate(Cyberiada::ElementCollection *parent, const Cyberiada::Point &p)
 {
+    waitForSnapshot();
     if (root == NULL) {
         return nullptr;
     }
 
-    int row = rowCount(elementToIndex(parent));
-    beginInsertRows(elementToIndex(parent), row + 1, row + 1);
+    QModelIndex parent_index = elementToIndex(parent);
+    bool exposed = beginAppendRow(parent_index);
     Cyberiada::TerminatePseudostate* element = root->new_terminate(parent, p);
-    endInsertRows();
+    indexElement(element);
+    recordEdit(element, CyberiadaSMJournal::encode(CyberiadaSMJournal::recordNewTerminate, parent->get_id(), element->get_id(), p),
+               CyberiadaSMJournal::encode(CyberiadaSMJournal::recordDelete, element->get_id()));
+    endAppendRow(parent_index, exposed);
+    emit elementInserted(elementToIndex(element));
 
     return element;
 }
@@ -506,14 +1198,21 @@ Cyberiada::Transition *CyberiadaSMModel::newTransition(Cyberiada::StateMachine *
                                                        const Cyberiada::Point &label_point, const Cyberiada::Rect &label_rect,
                                                        const Cyberiada::Color &color)
 {
+    waitForSnapshot();
     if (root == NULL) {
         return nullptr;
     }
 
-    int row = rowCount(elementToIndex(sm));
-    beginInsertRows(elementToIndex(sm), row + 1, row + 1);
+    QModelIndex parent_index = elementToIndex(sm);
+    bool exposed = beginAppendRow(parent_index);
     Cyberiada::Transition* element = root->new_transition(sm, ttype, source, target, action, pl, sp, tp, label_point, label_rect, color);
-    endInsertRows();
+    indexElement(element);
+    linkTransitions(element);
+    recordEdit(element, CyberiadaSMJournal::encode(CyberiadaSMJournal::recordNewTransition, sm->get_id(), element->get_id(), quint8(ttype), source->get_id(), target->get_id(),
+                  action, pl, sp, tp, label_point, label_rect, color),
+               CyberiadaSMJournal::encode(CyberiadaSMJournal::recordDelete, element->get_id()));
+    endAppendRow(parent_index, exposed);
+    emit elementInserted(elementToIndex(element));
 
     return element;
 }
@@ -521,14 +1220,19 @@ Cyberiada::Transition *CyberiadaSMModel::newTransition(Cyberiada::StateMachine *
 Cyberiada::Comment *CyberiadaSMModel::newComment(Cyberiada::ElementCollection *parent, const Cyberiada::String &body,
                                                  const Cyberiada::Rect &rect, const Cyberiada::Color &color, const Cyberiada::String &markup)
 {
+    waitForSnapshot();
     if (root == NULL) {
         return nullptr;
     }
 
-    int row = rowCount(elementToIndex(parent));
-    beginInsertRows(elementToIndex(parent), row + 1, row + 1);
+    QModelIndex parent_index = elementToIndex(parent);
+    bool exposed = beginAppendRow(parent_index);
     Cyberiada::Comment* element = root->new_comment(parent, body, rect, color, markup);
-    endInsertRows();
+    indexElement(element);
+    recordEdit(element, CyberiadaSMJournal::encode(CyberiadaSMJournal::recordNewComment, parent->get_id(), element->get_id(), body, rect, color, markup),
+               CyberiadaSMJournal::encode(CyberiadaSMJournal::recordDelete, element->get_id()));
+    endAppendRow(parent_index, exposed);
+    emit elementInserted(elementToIndex(element));
 
     return element;
 }
@@ -537,32 +1241,175 @@ Cyberiada::Comment *CyberiadaSMModel::newFormalComment(Cyberiada::ElementCollect
                                                        const Cyberiada::Rect &rect, const Cyberiada::Color &color,
                                                        const Cyberiada::String &markup)
 {
+    waitForSnapshot();
     if (root == NULL) {
         return nullptr;
     }
 
-    int row = rowCount(elementToIndex(parent));
-    beginInsertRows(elementToIndex(parent), row + 1, row + 1);
+    QModelIndex parent_index = elementToIndex(parent);
+    bool exposed = beginAppendRow(parent_index);
     Cyberiada::Comment* element = root->new_formal_comment(parent, body, rect, color, markup);
-    endInsertRows();
+    indexElement(element);
+    recordEdit(element, CyberiadaSMJournal::encode(CyberiadaSMJournal::recordNewFormalComment, parent->get_id(), element->get_id(), body, rect, color, markup),
+               CyberiadaSMJournal::encode(CyberiadaSMJournal::recordDelete, element->get_id()));
+    endAppendRow(parent_index, exposed);
+    emit elementInserted(elementToIndex(element));
 
     return element;
 }
 
 bool CyberiadaSMModel::deleteElement(const QModelIndex &index)
 {
+    waitForSnapshot();
     Cyberiada::Element* child_element = indexToElement(index);
     if (!child_element) return false;
     Cyberiada::ElementCollection* parent_element = dynamic_cast<Cyberiada::ElementCollection*>(child_element->get_parent());
     MY_ASSERT(parent_element);
     int row = child_element->index();
-    beginRemoveRows(elementToIndex(parent_element), row, row);
+    QList<QByteArray> undo_records;
+    encodeCreation(child_element, undo_records);
+    recordEdit(child_element, CyberiadaSMJournal::encode(CyberiadaSMJournal::recordDelete, child_element->get_id()), undo_records);
+    QModelIndex parent_index = elementToIndex(parent_element);
+    emit elementAboutToBeRemoved(index);
+    bool exposed = beginRemoveRow(parent_index, row);
+    unindexElement(child_element);
+    dropPendingChanges(child_element);
+    forgetElementCaches(child_element);
     parent_element->remove_element(child_element->get_id());
-    endRemoveRows();
-    emit dataChanged(index, index);
+    invalidateRows();
+    endRemoveRow(parent_index, exposed);
+    // the removed element has no valid index anymore, the parent collection is reported instead
+    notifyElementChanged(elementToIndex(parent_element), ChangeParent);
     return true;
 }
 
+bool CyberiadaSMModel::deleteElements(const QList<Cyberiada::Element*>& elements)
+{
+    waitForSnapshot();
+    // the transitions go first, so undo creates them after their ends
+    QList<Cyberiada::Element*> transitions, others;
+    QSet<const Cyberiada::Element*> queued;
+    for (int i = 0; i < elements.size(); i++) {
+        Cyberiada::Element* element = elements[i];
+        if (element->get_type() == Cyberiada::elementTransition) {
+            if (!queued.contains(element)) {
+                queued.insert(element);
+                transitions.append(element);
+            }
+            continue;
+        }
+        others.append(element);
+        QList<Cyberiada::Element*> incident = incidentTransitions(element);
+        for (int j = 0; j < incident.size(); j++) {
+            if (!queued.contains(incident[j])) {
+                queued.insert(incident[j]);
+                transitions.append(incident[j]);
+            }
+        }
+    }
+    // the elements inside the deleted subtrees go away with them
+    QSet<const Cyberiada::Element*> tops;
+    for (int i = 0; i < others.size(); i++) {
+        tops.insert(others[i]);
+    }
+    QList<Cyberiada::Element*> batch;
+    QList<Cyberiada::Element*> candidates = transitions + others;
+    for (int i = 0; i < candidates.size(); i++) {
+        const Cyberiada::Element* p = candidates[i]->get_parent();
+        while (p && !tops.contains(p)) {
+            p = p->get_parent();
+        }
+        if (p == NULL) {
+            batch.append(candidates[i]);
+        }
+    }
+
+    bool result = true;
+    beginTransaction();
+    for (int i = 0; i < batch.size(); i++) {
+        result = deleteElement(elementToIndex(batch[i])) && result;
+    }
+    commitTransaction();
+    return result;
+}
+
+void CyberiadaSMModel::beginTransaction()
+{
+	transactionLevel++;
+}
+
+void CyberiadaSMModel::commitTransaction()
+{
+	MY_ASSERT(transactionLevel > 0);
+	if (transactionLevel <= 0 || --transactionLevel > 0) {
+		return;
+	}
+	if (pendingCommand) {
+		CyberiadaSMEditCommand* command = pendingCommand;
+		pendingCommand = NULL;
+		history->pushEdit(command);
+	}
+	// the listeners may edit the model again, so the pending list is detached first
+	QList<const Cyberiada::Element*> changed = pendingChanges;
+	QHash<const Cyberiada::Element*, ChangeKinds> kinds = pendingChangeKinds;
+	pendingChanges.clear();
+	pendingChangeKinds.clear();
+	foreach(const Cyberiada::Element* element, changed) {
+		emitElementChanged(elementToIndex(element), kinds.value(element));
+	}
+}
+
+bool CyberiadaSMModel::isInTransaction() const
+{
+	return transactionLevel > 0;
+}
+
+void CyberiadaSMModel::notifyElementChanged(const QModelIndex& index, ChangeKinds kinds)
+{
+	if (!index.isValid()) return;
+	if (index != rootIndex()) {
+		// the cached strings are dropped at once, only the notifications wait for the transaction end
+		invalidateDisplay(indexToElement(index), kinds);
+	}
+	if (transactionLevel == 0 || index == rootIndex()) {
+		emitElementChanged(index, kinds);
+		return;
+	}
+	const Cyberiada::Element* element = indexToElement(index);
+	MY_ASSERT(element);
+	QHash<const Cyberiada::Element*, ChangeKinds>::iterator i = pendingChangeKinds.find(element);
+	if (i == pendingChangeKinds.end()) {
+		pendingChangeKinds.insert(element, kinds);
+		pendingChanges.append(element);
+	} else {
+		i.value() |= kinds;
+	}
+}
+
+void CyberiadaSMModel::emitElementChanged(const QModelIndex& index, ChangeKinds kinds)
+{
+	emit elementChanged(index, kinds);
+	// only the names, ids and transition ends are shown in the tree
+	if ((kinds & (ChangeTitle | ChangeID | ChangeEndpoints | ChangeMetadata)) && isFetchedIndex(index)) {
+		emit dataChanged(index, index);
+	}
+}
+
+void CyberiadaSMModel::dropPendingChanges(const Cyberiada::Element* element)
+{
+	if (pendingChangeKinds.isEmpty()) return;
+	if (element->has_children()) {
+		const Cyberiada::ElementCollection* collection = static_cast<const Cyberiada::ElementCollection*>(element);
+		const Cyberiada::ElementList& children = collection->get_children();
+		for (Cyberiada::ElementList::const_iterator i = children.begin(); i != children.end(); i++) {
+			dropPendingChanges(*i);
+		}
+	}
+	if (pendingChangeKinds.remove(element)) {
+		pendingChanges.removeOne(element);
+	}
+}
+
 Qt::ItemFlags CyberiadaSMModel::flags(const QModelIndex &index) const
 {
 	Qt::ItemFlags default_flags = Qt::ItemIsEnabled | Qt::ItemIsSelectable;
@@ -592,7 +1439,7 @@ bool CyberiadaSMModel::hasIndex(int row, int column, const QModelIndex & parent)
 	const Cyberiada::Element *parent_element = static_cast<const Cyberiada::Element*>(parent.internalPointer());
 	MY_ASSERT(parent_element);
 	if(parent_element->has_children()) {
-		return row >= 0 && row < int(parent_element->children_count());
+		return row >= 0 && row < fetchedRowCount(parent_element);
 	} else {
 		return false;
 	}
@@ -639,7 +1486,7 @@ QModelIndex CyberiadaSMModel::parent(const QModelIndex &index) const
 		return documentIndex();
 	}
 	//qDebug() << "parent result" << parent_element->index() << 0 << (void*)parent_element;
-	return createIndex(parent_element->index(), 0, (void*)parent_element);
+	return createIndex(elementRow(parent_element), 0, (void*)parent_element);
 }
 
 int CyberiadaSMModel::rowCount(const QModelIndex &parent) const
@@ -658,7 +1505,7 @@ int CyberiadaSMModel::rowCount(const QModelIndex &parent) const
 		element = static_cast<const Cyberiada::Element*>(parent.internalPointer());
 	}
 	MY_ASSERT(element);
-	return element->children_count();
+	return fetchedRowCount(element);
 }
 
 int CyberiadaSMModel::columnCount(const QModelIndex &) const
@@ -668,7 +1515,144 @@ int CyberiadaSMModel::columnCount(const QModelIndex &) const
 
 bool CyberiadaSMModel::hasChildren(const QModelIndex & parent) const
 {
-	return rowCount(parent) > 0;
+	if (!parent.isValid() || parent == rootIndex()) {
+		return rowCount(parent) > 0;
+	}
+	// the expand sign is shown before the children are fetched
+	const Cyberiada::Element* element = static_cast<const Cyberiada::Element*>(parent.internalPointer());
+	MY_ASSERT(element);
+	return element->children_count() > 0;
+}
+
+bool CyberiadaSMModel::canFetchMore(const QModelIndex& parent) const
+{
+	if (!parent.isValid() || parent == rootIndex()) {
+		return false;
+	}
+	const Cyberiada::Element* element = static_cast<const Cyberiada::Element*>(parent.internalPointer());
+	MY_ASSERT(element);
+	return fetchedRowCount(element) < int(element->children_count());
+}
+
+void CyberiadaSMModel::fetchMore(const QModelIndex& parent)
+{
+	if (!canFetchMore(parent)) {
+		return;
+	}
+	const Cyberiada::Element* element = static_cast<const Cyberiada::Element*>(parent.internalPointer());
+	int fetched = fetchedRowCount(element);
+	int count = qMin(int(element->children_count()) - fetched, fetchChunk);
+	beginInsertRows(parent, fetched, fetched + count - 1);
+	fetchedRows.insert(element, fetched + count);
+	endInsertRows();
+}
+
+void CyberiadaSMModel::fetchUpTo(const QModelIndex& index)
+{
+	if (!index.isValid() || index == rootIndex() || index == documentIndex()) {
+		return;
+	}
+	QModelIndex parent_index = parent(index);
+	fetchUpTo(parent_index);
+	const Cyberiada::Element* parent_element = indexToElement(parent_index);
+	MY_ASSERT(parent_element);
+	int fetched = fetchedRowCount(parent_element);
+	if (index.row() < fetched) {
+		return;
+	}
+	// the selected element is exposed at once together with the rows before it
+	beginInsertRows(parent_index, fetched, index.row());
+	fetchedRows.insert(parent_element, index.row() + 1);
+	endInsertRows();
+}
+
+int CyberiadaSMModel::fetchChunkSize() const
+{
+	return fetchChunk;
+}
+
+void CyberiadaSMModel::setFetchChunkSize(int size)
+{
+	fetchChunk = qMax(1, size);
+}
+
+void CyberiadaSMModel::slotTreeSettingsChanged()
+{
+	setFetchChunkSize(SettingsManager::instance().getTreeFetchChunk());
+}
+
+int CyberiadaSMModel::fetchedRowCount(const Cyberiada::Element* element) const
+{
+	return fetchedRows.value(element, 0);
+}
+
+bool CyberiadaSMModel::isFetchedIndex(const QModelIndex& index) const
+{
+	if (!index.isValid() || index == rootIndex() || index == documentIndex()) {
+		return index.isValid();
+	}
+	const Cyberiada::Element* element = indexToElement(index);
+	MY_ASSERT(element);
+	return index.row() < fetchedRowCount(element->get_parent());
+}
+
+bool CyberiadaSMModel::beginAppendRow(const QModelIndex& parent)
+{
+	if (!parent.isValid() || parent == rootIndex()) {
+		return false;
+	}
+	const Cyberiada::Element* element = indexToElement(parent);
+	MY_ASSERT(element);
+	int fetched = fetchedRowCount(element);
+	// the new row goes after the rows that are not fetched yet: fetchMore exposes it later
+	if (fetched < int(element->children_count())) {
+		return false;
+	}
+	beginInsertRows(parent, fetched, fetched);
+	return true;
+}
+
+void CyberiadaSMModel::endAppendRow(const QModelIndex& parent, bool exposed)
+{
+	if (!exposed) {
+		return;
+	}
+	fetchedRows[indexToElement(parent)]++;
+	endInsertRows();
+}
+
+bool CyberiadaSMModel::beginRemoveRow(const QModelIndex& parent, int row)
+{
+	if (!parent.isValid() || parent == rootIndex()) {
+		return false;
+	}
+	if (row >= fetchedRowCount(indexToElement(parent))) {
+		return false;
+	}
+	beginRemoveRows(parent, row, row);
+	return true;
+}
+
+void CyberiadaSMModel::endRemoveRow(const QModelIndex& parent, bool exposed)
+{
+	if (!exposed) {
+		return;
+	}
+	fetchedRows[indexToElement(parent)]--;
+	endRemoveRows();
+}
+
+void CyberiadaSMModel::forgetElementCaches(const Cyberiada::Element* element)
+{
+	// the addresses of the deleted elements can be reused by the new ones
+	fetchedRows.remove(element);
+	displayCache.remove(element);
+	if (element->has_children()) {
+		const Cyberiada::ElementList& children = static_cast<const Cyberiada::ElementCollection*>(element)->get_children();
+		for (Cyberiada::ElementList::const_iterator i = children.begin(); i != children.end(); i++) {
+			forgetElementCaches(*i);
+		}
+	}
 }
 
 QModelIndex CyberiadaSMModel::rootIndex() const
@@ -705,10 +1689,41 @@ QModelIndex CyberiadaSMModel::elementToIndex(const Cyberiada::Element* element)
 	if (element->is_root()) {
 		return documentIndex();
 	} else {
-		const Cyberiada::Element* parent = element->get_parent();
-        MY_ASSERT(parent);
-		return index(element->index(), 0, elementToIndex(parent));
+		// the index only needs the row of the element: the model keeps the element pointer
+		// inside the index, so there is no need to walk up to the root
+		return createIndex(elementRow(element), 0, (void*)element);
+	}
+}
+
+int CyberiadaSMModel::elementRow(const Cyberiada::Element* element) const
+{
+	QHash<const Cyberiada::Element*, int>::const_iterator i = rowCache.constFind(element);
+	if (i != rowCache.constEnd()) {
+		return i.value();
+	}
+	const Cyberiada::Element* parent_element = element->get_parent();
+	MY_ASSERT(parent_element);
+	// cache the rows of all siblings at once to make the next lookups in the same collection free
+	const Cyberiada::ElementCollection* collection = static_cast<const Cyberiada::ElementCollection*>(parent_element);
+	const Cyberiada::ElementList& children = collection->get_children();
+	int row = 0, result = -1;
+	for (Cyberiada::ElementList::const_iterator c = children.begin(); c != children.end(); c++, row++) {
+		rowCache.insert(*c, row);
+		if (*c == element) {
+			result = row;
+		}
 	}
+	if (result < 0) {
+		result = int(element->index());
+	}
+	return result;
+}
+
+void CyberiadaSMModel::invalidateRows()
+{
+	// appending a new element never shifts the rows of its siblings, so the cache
+	// is dropped only on removals and moves
+	rowCache.clear();
 }
 
 const Cyberiada::Element* CyberiadaSMModel::indexToElement(const QModelIndex& index) const
@@ -728,13 +1743,153 @@ Cyberiada::Element* CyberiadaSMModel::indexToElement(const QModelIndex& index)
 const Cyberiada::Element* CyberiadaSMModel::idToElement(const QString& id) const
 {
 	MY_ASSERT(root);
-	return root->find_element_by_id(id.toStdString());
+	return findElementByID(id.toStdString());
 }
 
 Cyberiada::Element* CyberiadaSMModel::idToElement(const QString& id)
 {
 	MY_ASSERT(root);
-	return root->find_element_by_id(id.toStdString());
+	return findElementByID(id.toStdString());
+}
+
+Cyberiada::Element* CyberiadaSMModel::findElementByID(const Cyberiada::ID& id) const
+{
+	std::unordered_map<Cyberiada::ID, Cyberiada::Element*>::const_iterator i = idIndex.find(id);
+	if (i == idIndex.end()) {
+		return NULL;
+	}
+	return i->second;
+}
+
+void CyberiadaSMModel::rebuildIDIndex()
+{
+	idIndex.clear();
+	adjacency.clear();
+	transitionEnds.clear();
+	if (!root) return;
+	const Cyberiada::ElementList& children = root->get_children();
+	for (Cyberiada::ElementList::const_iterator i = children.begin(); i != children.end(); i++) {
+		indexElement(*i);
+	}
+	// the ends of the transitions are found after all the vertices are indexed
+	for (Cyberiada::ElementList::const_iterator i = children.begin(); i != children.end(); i++) {
+		linkTransitions(*i);
+	}
+}
+
+void CyberiadaSMModel::indexElement(Cyberiada::Element* element)
+{
+	if (!element) return;
+	idIndex[element->get_id()] = element;
+	if (element->has_children()) {
+		const Cyberiada::ElementCollection* collection = static_cast<const Cyberiada::ElementCollection*>(element);
+		const Cyberiada::ElementList& children = collection->get_children();
+		for (Cyberiada::ElementList::const_iterator i = children.begin(); i != children.end(); i++) {
+			indexElement(*i);
+		}
+	}
+}
+
+void CyberiadaSMModel::unindexElement(const Cyberiada::Element* element)
+{
+	if (!element) return;
+	if (element->has_children()) {
+		const Cyberiada::ElementCollection* collection = static_cast<const Cyberiada::ElementCollection*>(element);
+		const Cyberiada::ElementList& children = collection->get_children();
+		for (Cyberiada::ElementList::const_iterator i = children.begin(); i != children.end(); i++) {
+			unindexElement(*i);
+		}
+	}
+	unlinkTransitions(element);
+	idIndex.erase(element->get_id());
+}
+
+void CyberiadaSMModel::linkTransitions(Cyberiada::Element* element)
+{
+	if (!element) return;
+	if (element->get_type() == Cyberiada::elementTransition) {
+		const Cyberiada::Transition* trans = static_cast<const Cyberiada::Transition*>(element);
+		const Cyberiada::Element* source = findElementByID(trans->source_element_id());
+		const Cyberiada::Element* target = findElementByID(trans->target_element_id());
+		transitionEnds.insert(element, qMakePair(source, target));
+		if (source) {
+			adjacency[source].append(element);
+		}
+		if (target && target != source) {
+			adjacency[target].append(element);
+		}
+	} else if (element->has_children()) {
+		const Cyberiada::ElementCollection* collection = static_cast<const Cyberiada::ElementCollection*>(element);
+		const Cyberiada::ElementList& children = collection->get_children();
+		for (Cyberiada::ElementList::const_iterator i = children.begin(); i != children.end(); i++) {
+			linkTransitions(*i);
+		}
+	}
+}
+
+void CyberiadaSMModel::unlinkTransitions(const Cyberiada::Element* element)
+{
+	// not recursive: unindexElement visits the whole subtree
+	if (element->get_type() == Cyberiada::elementTransition) {
+		QHash<const Cyberiada::Element*, QPair<const Cyberiada::Element*, const Cyberiada::Element*> >::iterator i =
+			transitionEnds.find(element);
+		if (i == transitionEnds.end()) return;
+		Cyberiada::Element* trans = const_cast<Cyberiada::Element*>(element);
+		if (i.value().first) {
+			adjacency[i.value().first].removeOne(trans);
+		}
+		if (i.value().second && i.value().second != i.value().first) {
+			adjacency[i.value().second].removeOne(trans);
+		}
+		transitionEnds.erase(i);
+	} else {
+		// the transitions left without the vertex are deleted by the caller
+		adjacency.remove(element);
+	}
+}
+
+QList<Cyberiada::Element*> CyberiadaSMModel::vertexTransitions(const Cyberiada::Element* vertex) const
+{
+	return adjacency.value(vertex);
+}
+
+QList<Cyberiada::Element*> CyberiadaSMModel::incidentTransitions(const Cyberiada::Element* element) const
+{
+	QList<Cyberiada::Element*> result;
+	QSet<const Cyberiada::Element*> found;
+	if (element) {
+		collectIncidentTransitions(element, element, result, found);
+	}
+	return result;
+}
+
+void CyberiadaSMModel::collectIncidentTransitions(const Cyberiada::Element* top, const Cyberiada::Element* element,
+												  QList<Cyberiada::Element*>& result, QSet<const Cyberiada::Element*>& found) const
+{
+	QHash<const Cyberiada::Element*, QList<Cyberiada::Element*> >::const_iterator a = adjacency.constFind(element);
+	if (a != adjacency.constEnd()) {
+		const QList<Cyberiada::Element*>& transitions = a.value();
+		for (int i = 0; i < transitions.size(); i++) {
+			Cyberiada::Element* trans = transitions[i];
+			if (found.contains(trans)) continue;
+			// the transitions inside the subtree are deleted together with it
+			const Cyberiada::Element* p = trans->get_parent();
+			while (p && p != top) {
+				p = p->get_parent();
+			}
+			found.insert(trans);
+			if (p == NULL) {
+				result.append(trans);
+			}
+		}
+	}
+	if (element->has_children()) {
+		const Cyberiada::ElementCollection* collection = static_cast<const Cyberiada::ElementCollection*>(element);
+		const Cyberiada::ElementList& children = collection->get_children();
+		for (Cyberiada::ElementList::const_iterator i = children.begin(); i != children.end(); i++) {
+			collectIncidentTransitions(top, *i, result, found);
+		}
+	}
 }
 
 const Cyberiada::LocalDocument* CyberiadaSMModel::rootDocument() const
@@ -807,6 +1962,7 @@ Qt::DropActions CyberiadaSMModel::supportedDropActions() const
 
 void CyberiadaSMModel::move(Cyberiada::Element* element, Cyberiada::ElementCollection* target_parent)
 {
+    waitForSnapshot();
     QModelIndex srcindex = elementToIndex(element);
 	QModelIndex parentindex = parent(srcindex);	
 	QModelIndex dstindex;
@@ -822,38 +1978,43 @@ void CyberiadaSMModel::move(Cyberiada::Element* element, Cyberiada::ElementColle
 	MY_ASSERT(srcindex.isValid());
 
 	int remove_index = srcindex.row();
-	int add_index = rowCount(dstindex);
 
     Cyberiada::ElementCollection* source_parent = dynamic_cast<Cyberiada::ElementCollection*>(element->get_parent());
 
     // TODO remove model data
-	beginRemoveRows(parentindex, remove_index, remove_index);
+	bool removed = beginRemoveRow(parentindex, remove_index);
 	if (source_parent == NULL) {
         // states.removeAll(static_cast<CyberiadaStateItem*>(item));
 	} else {
         source_parent->remove_element(element->get_id());
 	}
-	endRemoveRows();
+	invalidateRows();
+	endRemoveRow(parentindex, removed);
 
     // TODO insert model data
-	beginInsertRows(dstindex, add_index, add_index);
+	bool added = beginAppendRow(dstindex);
     if (target_parent == NULL) {
         // MY_ASSERT(element->isState());
         // states.append(static_cast<CyberiadaStateItem*>(item));
         // item->removeParent();
 	} else {
+        // the element keeps its id and address, so the id index stays valid
         element->update_parent(target_parent);
         target_parent->add_element(element);
+        if (source_parent) {
+            recordEdit(element, CyberiadaSMJournal::encode(CyberiadaSMJournal::recordMove, element->get_id(), target_parent->get_id()),
+                       CyberiadaSMJournal::encode(CyberiadaSMJournal::recordMove, element->get_id(), source_parent->get_id()));
+        }
 	}
-    endInsertRows();
+    endAppendRow(dstindex, added);
 
     QModelIndex newIndex = elementToIndex(element);
-    emit dataChanged(newIndex, newIndex);
+    notifyElementChanged(newIndex, ChangeParent);
     // use in case scene::updateItemsRecursively is not used in scene::slotModelDataChanged
     QModelIndex newTargetIndex = elementToIndex(target_parent);
     QModelIndex newSourceIndex = elementToIndex(source_parent);
-    emit dataChanged(newTargetIndex, newTargetIndex);
-    emit dataChanged(newSourceIndex, newSourceIndex);
+    notifyElementChanged(newTargetIndex, ChangeParent);
+    notifyElementChanged(newSourceIndex, ChangeParent);
 }
 
 bool CyberiadaSMModel::dropMimeData(const QMimeData *data,
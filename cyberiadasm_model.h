@@ -26,13 +26,35 @@
 
 #include <QAbstractItemModel>
 #include <QIcon>
+#include <QHash>
+#include <QList>
+#include <QSet>
+#include <QPair>
 #include <QDateTime>
+#include <unordered_map>
 #include <cyberiada/cyberiadamlpp.h>
+#include "cyberiadasm_journal.h"
+#include "cyberiadasm_undo.h"
+
+class CyberiadaSMDocumentSaver;
 
 class CyberiadaSMModel: public QAbstractItemModel {
 Q_OBJECT
 
 public:
+	// the kinds of element changes reported by the elementChanged() signal
+	enum ChangeKind {
+		ChangeGeometry  = 0x01,   // position, size, points or polyline
+		ChangeTitle     = 0x02,   // name of the element or body of the comment
+		ChangeActions   = 0x04,   // state or transition actions
+		ChangeParent    = 0x08,   // the element was moved or its children were added / removed
+		ChangeID        = 0x10,
+		ChangeMetadata  = 0x20,   // document metainformation
+		ChangeEndpoints = 0x40,   // source or target of the transition
+		ChangeAll       = 0x7f
+	};
+	Q_DECLARE_FLAGS(ChangeKinds, ChangeKind)
+
 	CyberiadaSMModel(QObject *parent);
 	~CyberiadaSMModel();
 
@@ -40,8 +62,21 @@ public:
 	void                                reset();
     // void                                createDocument();
 	void                                loadDocument(const QString& path, bool reconstruct = false, bool reconsruct_sm = false);
+	// takes the ownership of the document that was loaded elsewhere (e.g. in a worker thread)
+	void                                setDocument(Cyberiada::LocalDocument* new_doc);
 	void                                saveDocument(bool round = false);
 	void                                saveAsDocument(const QString& path, Cyberiada::DocumentFormat f, bool round = false);
+	// the documents are saved asynchronously, see the save* signals
+	bool                                hasFilePath() const;
+	const QString&                      filePath() const;
+	bool                                isSaving() const;
+
+	// CRASH RECOVERY
+	// the journal of the edits left by the previous session that was not closed properly
+	bool                                hasRecoveryJournal() const;
+	// returns the number of the replayed edits or -1 on error
+	int                                 recoverJournal();
+	void                                discardRecoveryJournal();
 
 	// DATA REPRESENTATION
 	QVariant                            data(const QModelIndex& index, int role) const;	
@@ -52,8 +87,15 @@ public:
 	int                                 rowCount(const QModelIndex& parent = QModelIndex()) const;
 	int                                 columnCount(const QModelIndex& parent = QModelIndex()) const;
 	bool                                hasChildren(const QModelIndex& parent = QModelIndex()) const;
-	QIcon                               getIndexIcon(const QModelIndex& index) const;
-	QIcon                               getElementIcon(Cyberiada::ElementType type) const;
+	// the children are exposed to the views incrementally, fetchChunkSize() rows at once
+	bool                                canFetchMore(const QModelIndex& parent) const;
+	void                                fetchMore(const QModelIndex& parent);
+	// populates the rows of the element and its ancestors so that the views can show it
+	void                                fetchUpTo(const QModelIndex& index);
+	int                                 fetchChunkSize() const;
+	void                                setFetchChunkSize(int size);
+	const QIcon&                        getIndexIcon(const QModelIndex& index) const;
+	const QIcon&                        getElementIcon(Cyberiada::ElementType type) const;
 	
 	// EDITING
 	bool                                setData(const QModelIndex& index, const QVariant& value, int role = Qt::EditRole);
@@ -70,6 +112,7 @@ public:
 												  const QString& guard = QString(),
 												  const QString& behaviour = QString());
 	bool                                deleteAction(const QModelIndex& index, int action_index = -1);
+	bool                                insertAction(const QModelIndex& index, int action_index, const Cyberiada::Action& action);
 	bool                                updateGeometry(const QModelIndex& index, const Cyberiada::Point& point);
 	bool                                updateGeometry(const QModelIndex& index, const Cyberiada::Rect& rect);
 	bool                                updateGeometry(const QModelIndex& index, const Cyberiada::Point& source, const Cyberiada::Point& target);
@@ -107,6 +150,23 @@ public:
                                                    const Cyberiada::String& markup = Cyberiada::String());
 
     bool                                deleteElement(const QModelIndex& index);
+    // deletes the elements with their subtrees and the transitions connected to them in one transaction
+    bool                                deleteElements(const QList<Cyberiada::Element*>& elements);
+
+	// TRANSACTIONS
+	// edits made between beginTransaction() and commitTransaction() are applied immediately,
+	// but the notifications are emitted once per changed element when the outermost transaction
+	// is committed; the change kinds of the element are merged
+	void                                beginTransaction();
+	void                                commitTransaction();
+	bool                                isInTransaction() const;
+
+	// UNDO
+	// every edit (or transaction) is pushed to the undo stack as a command with the redo / undo deltas
+	CyberiadaSMUndoStack*               undoStack() const { return history; }
+	void                                applyDelta(const QList<QByteArray>& records);
+	// the edits are made by the undo / redo rather than by the user
+	bool                                isApplyingDelta() const { return applyingDelta; }
 
 	// DRAG & DROP
 	Qt::DropActions                     supportedDropActions() const;
@@ -133,18 +193,131 @@ public:
 	Cyberiada::Element*                 indexToElement(const QModelIndex& index);
 	const Cyberiada::Element*           idToElement(const QString& id) const;
 	Cyberiada::Element*                 idToElement(const QString& id);
+	// the transitions that start or end at the vertex
+	QList<Cyberiada::Element*>          vertexTransitions(const Cyberiada::Element* vertex) const;
+	// the transitions connected to the vertices of the subtree from the outside of it
+	QList<Cyberiada::Element*>          incidentTransitions(const Cyberiada::Element* element) const;
 	
 signals:
     void                                modelAboutToBeReset();
 	void                                modelReset();
+	// emitted for every edit; dataChanged is emitted only for the changes visible in the tree
+	void                                elementChanged(const QModelIndex& index, CyberiadaSMModel::ChangeKinds kinds);
+	// emitted at once, before the coalesced elementChanged, to let the views rekey their items
+	void                                elementIDChanged(const QModelIndex& index, const QString& old_id);
+	// emitted for the created / deleted elements even if their rows are not populated yet
+	void                                elementInserted(const QModelIndex& index);
+	void                                elementAboutToBeRemoved(const QModelIndex& index);
+	void                                saveStarted(const QString& path);
+	void                                saveFinished(const QString& path, qint64 msec);
+	void                                saveFailed(const QString& path, const QString& error);
+
+private slots:
+	void                                slotSaveFinished();
+	void                                slotCompactJournal();
+	void                                slotCompactionFinished();
+	void                                slotTreeSettingsChanged();
 
 private:
 	void                                move(Cyberiada::Element* element, Cyberiada::ElementCollection* target_parent);
+	void                                replaceDocument(Cyberiada::LocalDocument* new_doc);
+	void                                startSave(const QString& path, Cyberiada::DocumentFormat f, bool round);
+	void                                startQueuedSave();
+	// the edits wait until the running savers have copied the document
+	void                                waitForSnapshot();
+
+	// JOURNAL
+	void                                startJournal();
+	bool                                applyJournalRecord(const QByteArray& record);
+	void                                restoreID(Cyberiada::Element* element, const Cyberiada::ID& id);
+	// the edit goes to the journal and to the undo stack
+	void                                recordEdit(const Cyberiada::Element* element, const QByteArray& redo,
+												   const QByteArray& undo_record, bool geometry = false);
+	void                                recordEdit(const Cyberiada::Element* element, const QByteArray& redo,
+												   const QList<QByteArray>& undo_records, bool geometry = false);
+	// the records that create the element with its subtree again
+	void                                encodeCreation(const Cyberiada::Element* element, QList<QByteArray>& records) const;
+
+	// ID INDEX
+	void                                rebuildIDIndex();
+	void                                indexElement(Cyberiada::Element* element);
+	void                                unindexElement(const Cyberiada::Element* element);
+	Cyberiada::Element*                 findElementByID(const Cyberiada::ID& id) const;
+
+	// ADJACENCY INDEX
+	void                                linkTransitions(Cyberiada::Element* element);
+	void                                unlinkTransitions(const Cyberiada::Element* element);
+	void                                collectIncidentTransitions(const Cyberiada::Element* top, const Cyberiada::Element* element,
+																   QList<Cyberiada::Element*>& result, QSet<const Cyberiada::Element*>& found) const;
+
+	// ROW CACHE
+	int                                 elementRow(const Cyberiada::Element* element) const;
+	void                                invalidateRows();
+
+	// LAZY POPULATION
+	int                                 fetchedRowCount(const Cyberiada::Element* element) const;
+	// the views know only the rows announced by beginInsertRows
+	bool                                isFetchedIndex(const QModelIndex& index) const;
+	// the new row is announced only when the parent is fully populated
+	bool                                beginAppendRow(const QModelIndex& parent);
+	void                                endAppendRow(const QModelIndex& parent, bool exposed);
+	bool                                beginRemoveRow(const QModelIndex& parent, int row);
+	void                                endRemoveRow(const QModelIndex& parent, bool exposed);
+	void                                forgetElementCaches(const Cyberiada::Element* element);
+
+	// DISPLAY CACHE
+	QString                             elementDisplayName(const Cyberiada::Element* element) const;
+	const QString&                      displayString(const Cyberiada::Element* element) const;
+	void                                invalidateDisplay(const Cyberiada::Element* element, ChangeKinds kinds);
+
+	// NOTIFICATIONS
+	void                                notifyElementChanged(const QModelIndex& index, ChangeKinds kinds);
+	void                                emitElementChanged(const QModelIndex& index, ChangeKinds kinds);
+	void                                dropPendingChanges(const Cyberiada::Element* element);
 	
 	Cyberiada::LocalDocument*           root;
+	// the id -> element hash mirrors the document tree and replaces the linear find_element_by_id search
+	std::unordered_map<Cyberiada::ID, Cyberiada::Element*> idIndex;
+	// vertex -> incoming and outgoing transitions; the transitions keep their ends to be unlinked
+	// after the ends are renamed or deleted
+	QHash<const Cyberiada::Element*, QList<Cyberiada::Element*> > adjacency;
+	QHash<const Cyberiada::Element*, QPair<const Cyberiada::Element*, const Cyberiada::Element*> > transitionEnds;
+	// element -> row inside its parent; filled lazily, dropped on any removal or move
+	mutable QHash<const Cyberiada::Element*, int> rowCache;
+	// collection -> number of its children visible to the views; the rest is populated by fetchMore
+	QHash<const Cyberiada::Element*, int> fetchedRows;
+	int                                 fetchChunk;
+	// the tree text of the elements; the transitions keep their ends to be dropped when the ends are renamed,
+	// the adjacency of the renamed vertex gives the transitions to check
+	struct DisplayCacheEntry {
+		QString                         text;
+		const Cyberiada::Element*       source;
+		const Cyberiada::Element*       target;
+	};
+	mutable QHash<const Cyberiada::Element*, DisplayCacheEntry> displayCache;
+	int                                 transactionLevel;
+	QList<const Cyberiada::Element*>    pendingChanges;
+	QHash<const Cyberiada::Element*, ChangeKinds> pendingChangeKinds;
+	QString                             documentPath;
+	Cyberiada::DocumentFormat           documentFormat;
+	CyberiadaSMDocumentSaver*           saver;
+	bool                                saveQueued;
+	QString                             queuedPath;
+	Cyberiada::DocumentFormat           queuedFormat;
+	bool                                queuedRound;
+	CyberiadaSMJournal*                 journal;
+	CyberiadaSMDocumentSaver*           compactor;
+	bool                                replaying;
+	CyberiadaSMUndoStack*               history;
+	CyberiadaSMEditCommand*             pendingCommand;
+	bool                                applyingDelta;
 	QString							   	cyberiadaStateMimeType;
 	QIcon                              	emptyIcon;
 	QMap<Cyberiada::ElementType, QIcon> icons;
+	// DecorationRole values built once
+	QHash<int, QVariant>                iconVariants;
 };
 
+Q_DECLARE_OPERATORS_FOR_FLAGS(CyberiadaSMModel::ChangeKinds)
+
 #endif
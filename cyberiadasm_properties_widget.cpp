@@ -163,7 +163,7 @@ void CyberiadaSMPropertiesWidget::setModel(CyberiadaSMModel* model)
 		elementTypesEnumIcons[t] = model->getElementIcon(t);
     }
 
-    connect(model, &CyberiadaSMModel::dataChanged, this, &CyberiadaSMPropertiesWidget::slotModelDataChanged);
+    connect(model, &CyberiadaSMModel::elementChanged, this, &CyberiadaSMPropertiesWidget::slotModelElementChanged);
 }
 
 void CyberiadaSMPropertiesWidget::clearProperties()
@@ -189,13 +189,13 @@ void CyberiadaSMPropertiesWidget::slotElementSelected(const QModelIndex& index)
 	}
 }
 
-void CyberiadaSMPropertiesWidget::slotModelDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight)
+void CyberiadaSMPropertiesWidget::slotModelElementChanged(const QModelIndex& index, CyberiadaSMModel::ChangeKinds kinds)
 {
-    if (model && topLeft.isValid() && topLeft != model->rootIndex()) {
-        Cyberiada::Element* changed_element = model->indexToElement(topLeft);
+    if (model && index.isValid() && index != model->rootIndex()) {
+        Cyberiada::Element* changed_element = model->indexToElement(index);
         MY_ASSERT(changed_element);
         if (element == changed_element) {
-            updateElement();
+            updateElement(kinds);
         }
     }
 }
@@ -756,7 +756,7 @@ void CyberiadaSMPropertiesWidget::newElement(Cyberiada::Element* new_element)
     updating = false;
 }
 
-void CyberiadaSMPropertiesWidget::updateElement()
+void CyberiadaSMPropertiesWidget::updateElement(CyberiadaSMModel::ChangeKinds kinds)
 {
     updating = true;
 
@@ -767,63 +767,71 @@ void CyberiadaSMPropertiesWidget::updateElement()
     enumManager->setValue(element_type_prop, type);
 
     if (type == Cyberiada::elementRoot) {
-        const Cyberiada::LocalDocument* doc = model->rootDocument();
-        MY_ASSERT(doc);
+        if (kinds & CyberiadaSMModel::ChangeMetadata) {
+            const Cyberiada::LocalDocument* doc = model->rootDocument();
+            MY_ASSERT(doc);
 
-        QtProperty* doc_group_prop = findQtProperty(nullptr, findPropertyStruct(propGroupDocument).propName);
+            QtProperty* doc_group_prop = findQtProperty(nullptr, findPropertyStruct(propGroupDocument).propName);
 
-        QtProperty* format_type_prop = findQtProperty(doc_group_prop, findPropertyStruct(propFormat).propName);
-        enumManager->setValue(format_type_prop, doc->get_file_format());
+            QtProperty* format_type_prop = findQtProperty(doc_group_prop, findPropertyStruct(propFormat).propName);
+            enumManager->setValue(format_type_prop, doc->get_file_format());
 
-        QtProperty* meta_group_prop = findQtProperty(doc_group_prop, findPropertyStruct(propGroupMeta).propName);
-        QtProperty* standard_version_prop = findQtProperty(meta_group_prop, findPropertyStruct(propMetaStandardVersion).propName);
-        stringManager->setValue(standard_version_prop, QString(doc->meta().standard_version.c_str()));
+            QtProperty* meta_group_prop = findQtProperty(doc_group_prop, findPropertyStruct(propGroupMeta).propName);
+            QtProperty* standard_version_prop = findQtProperty(meta_group_prop, findPropertyStruct(propMetaStandardVersion).propName);
+            stringManager->setValue(standard_version_prop, QString(doc->meta().standard_version.c_str()));
 
-        // QtProperty* bounding_group_prop = constructProperty(propGroupBoundingRect);
-        // Cyberiada::Rect r = doc->get_bound_rect();
-        // rectManager->setValue(bounding_group_prop, QRectF(r.x, r.y, r.width, r.height));
+            // QtProperty* bounding_group_prop = constructProperty(propGroupBoundingRect);
+            // Cyberiada::Rect r = doc->get_bound_rect();
+            // rectManager->setValue(bounding_group_prop, QRectF(r.x, r.y, r.width, r.height));
 
-        for (std::vector<std::pair<Cyberiada::String, Cyberiada::String>>::const_iterator i = doc->meta().strings.begin();
-             i != doc->meta().strings.end();
-             i++) {
-            QtProperty* platform_string_prop = findQtProperty(meta_group_prop, i->first.c_str());
-            stringManager->setValue(platform_string_prop, i->second.c_str());
-        }
+            for (std::vector<std::pair<Cyberiada::String, Cyberiada::String>>::const_iterator i = doc->meta().strings.begin();
+                 i != doc->meta().strings.end();
+                 i++) {
+                QtProperty* platform_string_prop = findQtProperty(meta_group_prop, i->first.c_str());
+                stringManager->setValue(platform_string_prop, i->second.c_str());
+            }
 
-        QtProperty* transition_order_prop = findQtProperty(meta_group_prop, findPropertyStruct(propMetaTransitionOrder).propName);
-        boolManager->setValue(transition_order_prop, doc->meta().transition_order_flag);
-        QtProperty* event_propagation_prop = findQtProperty(meta_group_prop, findPropertyStruct(propMetaEventPropagation).propName);
-        boolManager->setValue(event_propagation_prop, doc->meta().event_propagation_flag);
+            QtProperty* transition_order_prop = findQtProperty(meta_group_prop, findPropertyStruct(propMetaTransitionOrder).propName);
+            boolManager->setValue(transition_order_prop, doc->meta().transition_order_flag);
+            QtProperty* event_propagation_prop = findQtProperty(meta_group_prop, findPropertyStruct(propMetaEventPropagation).propName);
+            boolManager->setValue(event_propagation_prop, doc->meta().event_propagation_flag);
+        }
 
     } else {
-        QtProperty* element_id_prop = findQtProperty(element_group_prop, findPropertyStruct(propID).propName);
-        stringManager->setValue(element_id_prop, QString(element->get_id().c_str()));
+        if (kinds & CyberiadaSMModel::ChangeID) {
+            QtProperty* element_id_prop = findQtProperty(element_group_prop, findPropertyStruct(propID).propName);
+            stringManager->setValue(element_id_prop, QString(element->get_id().c_str()));
+        }
 
         if (type == Cyberiada::elementTransition) {
             const Cyberiada::Transition* trans = static_cast<const Cyberiada::Transition*>(element);
             MY_ASSERT(trans);
             QtProperty* trans_group_prop = findQtProperty(nullptr, findPropertyStruct(propGroupTransition).propName);
 
-            QtProperty* element_source_prop = findQtProperty(trans_group_prop, findPropertyStruct(propSource).propName);
-            enumManager->setValue(element_source_prop, getElementNumber(true,
-                                                                        model->idToElement(trans->source_element_id().c_str())));
+            if (kinds & CyberiadaSMModel::ChangeEndpoints) {
+                QtProperty* element_source_prop = findQtProperty(trans_group_prop, findPropertyStruct(propSource).propName);
+                enumManager->setValue(element_source_prop, getElementNumber(true,
+                                                                            model->idToElement(trans->source_element_id().c_str())));
 
-            QtProperty* element_target_prop = findQtProperty(trans_group_prop, findPropertyStruct(propTarget).propName);
-            enumManager->setValue(element_target_prop, getElementNumber(false,
-                                                                        model->idToElement(trans->target_element_id().c_str())));
+                QtProperty* element_target_prop = findQtProperty(trans_group_prop, findPropertyStruct(propTarget).propName);
+                enumManager->setValue(element_target_prop, getElementNumber(false,
+                                                                            model->idToElement(trans->target_element_id().c_str())));
+            }
 
-            QtProperty* action_group_prop = findQtProperty(trans_group_prop, findPropertyStruct(propGroupAction).propName);
+            if (kinds & CyberiadaSMModel::ChangeActions) {
+                QtProperty* action_group_prop = findQtProperty(trans_group_prop, findPropertyStruct(propGroupAction).propName);
 
-            QtProperty* trigger_prop = findQtProperty(action_group_prop, findPropertyStruct(propTrigger).propName);
-            stringManager->setValue(trigger_prop, QString(trans->get_action().get_trigger().c_str()));
+                QtProperty* trigger_prop = findQtProperty(action_group_prop, findPropertyStruct(propTrigger).propName);
+                stringManager->setValue(trigger_prop, QString(trans->get_action().get_trigger().c_str()));
 
-            QtProperty* guard_prop = findQtProperty(action_group_prop, findPropertyStruct(propGuard).propName);
-            stringManager->setValue(guard_prop, QString(trans->get_action().get_guard().c_str()));
+                QtProperty* guard_prop = findQtProperty(action_group_prop, findPropertyStruct(propGuard).propName);
+                stringManager->setValue(guard_prop, QString(trans->get_action().get_guard().c_str()));
 
-            QtProperty* behavior_prop = findQtProperty(action_group_prop, findPropertyStruct(propBehavior).propName);
-            stringManager->setValue(behavior_prop, QString(trans->get_action().get_behavior().c_str()));
+                QtProperty* behavior_prop = findQtProperty(action_group_prop, findPropertyStruct(propBehavior).propName);
+                stringManager->setValue(behavior_prop, QString(trans->get_action().get_behavior().c_str()));
+            }
 
-            if (trans->has_geometry()) {
+            if ((kinds & CyberiadaSMModel::ChangeGeometry) && trans->has_geometry()) {
                 QtProperty* geom_group_prop = findQtProperty(nullptr, findPropertyStruct(propGroupGeometry).propName);
                 if (geom_group_prop == nullptr) {
                     geom_group_prop = constructProperty(propGroupGeometry);
@@ -888,12 +896,14 @@ void CyberiadaSMPropertiesWidget::updateElement()
             }
 
         } else {
-            QtProperty* element_name_prop = findQtProperty(element_group_prop, findPropertyStruct(propName).propName);
-            stringManager->setValue(element_name_prop, QString(element->get_name().c_str()));
+            if (kinds & CyberiadaSMModel::ChangeTitle) {
+                QtProperty* element_name_prop = findQtProperty(element_group_prop, findPropertyStruct(propName).propName);
+                stringManager->setValue(element_name_prop, QString(element->get_name().c_str()));
+            }
 
             if (type == Cyberiada::elementSimpleState || type == Cyberiada::elementCompositeState) {
                 const Cyberiada::State* state = static_cast<const Cyberiada::State*>(element);
-                if (state->has_actions()) {
+                if ((kinds & CyberiadaSMModel::ChangeActions) && state->has_actions()) {
                     QtProperty* actions_group_prop = findQtProperty(nullptr, findPropertyStruct(propGroupActions).propName);
                     if (actions_group_prop == nullptr) {
                         actions_group_prop = constructProperty(propGroupActions);
@@ -943,7 +953,8 @@ void CyberiadaSMPropertiesWidget::updateElement()
                         index ++;
                     }
                 }
-            } else if (type == Cyberiada::elementComment || type == Cyberiada::elementFormalComment) {
+            } else if ((type == Cyberiada::elementComment || type == Cyberiada::elementFormalComment) &&
+                       (kinds & (CyberiadaSMModel::ChangeTitle | CyberiadaSMModel::ChangeMetadata))) {
                 const Cyberiada::Comment* comment = static_cast<const Cyberiada::Comment*>(element);
 
                 QtProperty* comment_group_prop = findQtProperty(nullptr, findPropertyStruct(propGroupComment).propName);
@@ -1041,7 +1052,7 @@ void CyberiadaSMPropertiesWidget::updateElement()
                 }
             }
 
-            if (element->has_geometry()) {
+            if ((kinds & CyberiadaSMModel::ChangeGeometry) && element->has_geometry()) {
                 QtProperty* geom_group_prop = findQtProperty(nullptr, findPropertyStruct(propGroupGeometry).propName);
                 if (geom_group_prop == nullptr) {
                     geom_group_prop = constructProperty(propGroupGeometry);
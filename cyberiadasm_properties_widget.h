@@ -42,7 +42,7 @@ public:
 
 public slots:
 	void                     slotElementSelected(const QModelIndex& index);
-    void                     slotModelDataChanged(const QModelIndex & topLeft, const QModelIndex & bottomRight);
+    void                     slotModelElementChanged(const QModelIndex& index, CyberiadaSMModel::ChangeKinds kinds);
 	void                     slotPropertyChanged(QtProperty* property);
 	
 private:
@@ -142,7 +142,7 @@ private:
 
 	void                        clearProperties();
 	void                        newElement(Cyberiada::Element* new_element);
-    void                        updateElement();
+    void                        updateElement(CyberiadaSMModel::ChangeKinds kinds = CyberiadaSMModel::ChangeAll);
 	QtProperty*                 constructProperty(CyberiadaPropertyName prop, const QString& alt_name = "");
 	CyberiadaProperty&          findPropertyStruct(CyberiadaPropertyName prop);
 	CyberiadaProperty&          findPropertyStruct(const QString& propName, const QString& alt_name = "");
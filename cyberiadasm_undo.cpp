@@ -0,0 +1,234 @@
+/* -----------------------------------------------------------------------------
+ * The Cyberiada State Machine Editor
+ * -----------------------------------------------------------------------------
+ * 
+ * The Undo Commands
+ *
+ * Copyright (C) 2024 Alexey Fedoseev <aleksey@fedoseev.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see https://www.gnu.org/licenses/
+ *
+ * ----------------------------------------------------------------------------- */
+
+#include "cyberiadasm_undo.h"
+#include "cyberiadasm_model.h"
+#include "settings_manager.h"
+#include "myassert.h"
+
+#define UNDO_COMMAND_ID_GEOMETRY   1
+#define UNDO_COMMAND_OVERHEAD      (int(sizeof(CyberiadaSMEditCommand)) + 64)
+#define UNDO_RECORD_OVERHEAD       (int(sizeof(QByteArray)) + 24)
+// the trimmed stack takes this part of the limit, so it is not rebuilt on every edit
+#define UNDO_TRIM_RATIO            0.75
+
+CyberiadaSMEditCommand::CyberiadaSMEditCommand(CyberiadaSMModel* _model):
+    QUndoCommand(), model(_model), stack(NULL), geometryOnly(true), sealed(false),
+    applied(true), bytes(UNDO_COMMAND_OVERHEAD)
+{
+}
+
+void CyberiadaSMEditCommand::addDelta(const Cyberiada::ID& element_id, const QByteArray& redo,
+                                      const QList<QByteArray>& undo, bool geometry)
+{
+    redoRecords.append(redo);
+    bytes += redo.size() + UNDO_RECORD_OVERHEAD;
+    // the records restoring one edit are applied in their order
+    for (int i = undo.size() - 1; i >= 0; i--) {
+        undoRecords.append(undo[i]);
+        bytes += undo[i].size() + UNDO_RECORD_OVERHEAD;
+    }
+    if (!elementIDs.contains(element_id)) {
+        elementIDs.append(element_id);
+        bytes += int(element_id.size()) + UNDO_RECORD_OVERHEAD;
+    }
+    geometryOnly = geometryOnly && geometry;
+}
+
+int CyberiadaSMEditCommand::id() const
+{
+    return geometryOnly && !sealed ? UNDO_COMMAND_ID_GEOMETRY : -1;
+}
+
+bool CyberiadaSMEditCommand::mergeWith(const QUndoCommand* other)
+{
+    const CyberiadaSMEditCommand* command = static_cast<const CyberiadaSMEditCommand*>(other);
+    if (sealed || (stack && stack->rebuilding) ||
+        !command->geometryOnly || command->elementIDs.size() != elementIDs.size()) {
+        return false;
+    }
+    foreach (const Cyberiada::ID& element_id, command->elementIDs) {
+        if (!elementIDs.contains(element_id)) return false;
+    }
+    // the geometry records are absolute: the latest ones replace the previous redo,
+    // and the first undo records keep the geometry before the drag
+    foreach (const QByteArray& record, redoRecords) {
+        bytes -= record.size() + UNDO_RECORD_OVERHEAD;
+    }
+    redoRecords = command->redoRecords;
+    foreach (const QByteArray& record, redoRecords) {
+        bytes += record.size() + UNDO_RECORD_OVERHEAD;
+    }
+    return true;
+}
+
+void CyberiadaSMEditCommand::undo()
+{
+    if (stack && stack->rebuilding) {
+        // the model is already in the state before the command
+        applied = false;
+        return;
+    }
+    QList<QByteArray> records;
+    records.reserve(undoRecords.size());
+    for (int i = undoRecords.size() - 1; i >= 0; i--) {
+        records.append(undoRecords[i]);
+    }
+    model->applyDelta(records);
+    applied = false;
+}
+
+void CyberiadaSMEditCommand::redo()
+{
+    // the edit is already applied to the model when the command is pushed
+    if (applied) return;
+    model->applyDelta(redoRecords);
+    applied = true;
+}
+
+int CyberiadaSMEditCommand::byteSize() const
+{
+    return bytes;
+}
+
+CyberiadaSMEditCommand* CyberiadaSMEditCommand::clone() const
+{
+    CyberiadaSMEditCommand* command = new CyberiadaSMEditCommand(model);
+    command->setText(text());
+    command->redoRecords = redoRecords;
+    command->undoRecords = undoRecords;
+    command->elementIDs = elementIDs;
+    command->geometryOnly = geometryOnly;
+    command->sealed = sealed;
+    command->bytes = bytes;
+    // the copy is pushed as applied, the undone ones are undone after the push
+    return command;
+}
+
+CyberiadaSMUndoStack::CyberiadaSMUndoStack(QObject* parent):
+    QUndoStack(parent), usedBytes(0), rebuilding(false)
+{
+    limitBytes = qint64(SettingsManager::instance().getUndoMemoryLimit()) * 1024 * 1024;
+    connect(&SettingsManager::instance(), &SettingsManager::undoSettingsChanged,
+            this, &CyberiadaSMUndoStack::slotSettingsChanged);
+}
+
+void CyberiadaSMUndoStack::pushEdit(CyberiadaSMEditCommand* command)
+{
+    MY_ASSERT(command);
+    if (command->isEmpty()) {
+        delete command;
+        return;
+    }
+    // push() deletes the undone commands above the current one
+    for (int i = index(); i < count(); i++) {
+        usedBytes -= static_cast<const CyberiadaSMEditCommand*>(QUndoStack::command(i))->byteSize();
+    }
+    const CyberiadaSMEditCommand* top = NULL;
+    if (index() > 0) {
+        top = static_cast<const CyberiadaSMEditCommand*>(QUndoStack::command(index() - 1));
+        usedBytes -= top->byteSize();
+    }
+    int command_bytes = command->byteSize();
+    int before = index();
+    command->stack = this;
+    push(command);
+    if (index() > before) {
+        // not merged
+        if (top) usedBytes += top->byteSize();
+        usedBytes += command_bytes;
+    } else {
+        usedBytes += top->byteSize();
+    }
+    trim();
+}
+
+void CyberiadaSMUndoStack::seal()
+{
+    if (index() > 0) {
+        const CyberiadaSMEditCommand* top = static_cast<const CyberiadaSMEditCommand*>(command(index() - 1));
+        const_cast<CyberiadaSMEditCommand*>(top)->seal();
+    }
+}
+
+void CyberiadaSMUndoStack::reset()
+{
+    clear();
+    usedBytes = 0;
+}
+
+void CyberiadaSMUndoStack::setMemoryLimit(qint64 bytes)
+{
+    limitBytes = bytes;
+    trim();
+}
+
+void CyberiadaSMUndoStack::slotSettingsChanged()
+{
+    setMemoryLimit(qint64(SettingsManager::instance().getUndoMemoryLimit()) * 1024 * 1024);
+}
+
+const CyberiadaSMEditCommand* CyberiadaSMUndoStack::editCommand(int i) const
+{
+    return static_cast<const CyberiadaSMEditCommand*>(command(i));
+}
+
+void CyberiadaSMUndoStack::trim()
+{
+    if (limitBytes <= 0 || usedBytes <= limitBytes) return;
+    // the command on the top is kept even if it alone exceeds the limit,
+    // the undone commands depend on the applied ones below them
+    qint64 target = qint64(limitBytes * UNDO_TRIM_RATIO);
+    int first = 0;
+    qint64 bytes = usedBytes;
+    while (bytes > target && first < index() && first < count() - 1) {
+        bytes -= editCommand(first)->byteSize();
+        first++;
+    }
+    if (first == 0) return;
+
+    // QUndoStack cannot remove the commands at the bottom, so it is filled again
+    // with the copies of the commands that are kept
+    QList<CyberiadaSMEditCommand*> kept;
+    for (int i = first; i < count(); i++) {
+        kept.append(editCommand(i)->clone());
+    }
+    int current = index() - first;
+    int clean = cleanIndex() >= first ? cleanIndex() - first : -1;
+
+    rebuilding = true;
+    clear();
+    for (int i = 0; i < kept.size(); i++) {
+        kept[i]->stack = this;
+        push(kept[i]);
+        if (clean == i + 1) {
+            setClean();
+        }
+    }
+    if (clean < 0) {
+        resetClean();
+    }
+    setIndex(current);
+    rebuilding = false;
+    usedBytes = bytes;
+}
@@ -0,0 +1,104 @@
+/* -----------------------------------------------------------------------------
+ * The Cyberiada State Machine Editor
+ * -----------------------------------------------------------------------------
+ * 
+ * The Undo Commands
+ *
+ * Copyright (C) 2024 Alexey Fedoseev <aleksey@fedoseev.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see https://www.gnu.org/licenses/
+ *
+ * ----------------------------------------------------------------------------- */
+
+#ifndef CYBERIADA_SM_UNDO_HEADER
+#define CYBERIADA_SM_UNDO_HEADER
+
+#include <QUndoCommand>
+#include <QUndoStack>
+#include <QByteArray>
+#include <QList>
+#include <cyberiada/cyberiadamlpp.h>
+
+class CyberiadaSMModel;
+class CyberiadaSMUndoStack;
+
+// An edit of the model (or a transaction of edits) stored as deltas: the records of the
+// journal format that redo and undo it. The records name the elements by IDs, so a command
+// stays valid when the elements are deleted and created again by the other commands.
+class CyberiadaSMEditCommand: public QUndoCommand {
+public:
+    CyberiadaSMEditCommand(CyberiadaSMModel* model);
+
+    void                    addDelta(const Cyberiada::ID& element_id, const QByteArray& redo,
+                                     const QList<QByteArray>& undo, bool geometry);
+    bool                    isEmpty() const { return redoRecords.isEmpty(); }
+
+    int                     id() const;
+    bool                    mergeWith(const QUndoCommand* other);
+    void                    undo();
+    void                    redo();
+
+    // the approximate memory used by the command
+    int                     byteSize() const;
+    // the drags of the same elements are merged until the gesture is sealed
+    void                    seal() { sealed = true; }
+    // the copy with the same deltas and state, used to rebuild the stack
+    CyberiadaSMEditCommand* clone() const;
+
+private:
+    friend class CyberiadaSMUndoStack;
+
+    CyberiadaSMModel*       model;
+    CyberiadaSMUndoStack*   stack;
+    QList<QByteArray>       redoRecords;
+    // applied from the last to the first one
+    QList<QByteArray>       undoRecords;
+    QList<Cyberiada::ID>    elementIDs;
+    bool                    geometryOnly;
+    bool                    sealed;
+    bool                    applied;
+    int                     bytes;
+};
+
+// QUndoStack with the memory cap: when the commands take more than the limit,
+// the oldest ones are removed from the stack.
+class CyberiadaSMUndoStack: public QUndoStack {
+Q_OBJECT
+
+public:
+    CyberiadaSMUndoStack(QObject* parent = NULL);
+
+    void                    pushEdit(CyberiadaSMEditCommand* command);
+    void                    seal();
+    void                    reset();
+
+    qint64                  memoryUsage() const { return usedBytes; }
+    qint64                  memoryLimit() const { return limitBytes; }
+    void                    setMemoryLimit(qint64 bytes);
+
+private slots:
+    void                    slotSettingsChanged();
+
+private:
+    friend class CyberiadaSMEditCommand;
+    const CyberiadaSMEditCommand* editCommand(int i) const;
+    void                    trim();
+
+    qint64                  usedBytes;
+    qint64                  limitBytes;
+    // the copies of the commands are pushed back without touching the model
+    bool                    rebuilding;
+};
+
+#endif
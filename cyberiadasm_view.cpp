@@ -44,6 +44,9 @@ CyberiadaSMView::CyberiadaSMView(QWidget* parent):
 
 void CyberiadaSMView::select(const QModelIndex& index)
 {
+    // the element selected on the scene can be inside the rows that are not fetched yet
+    CyberiadaSMModel* m = static_cast<CyberiadaSMModel*>(model());
+    m->fetchUpTo(index);
     // selectionModel()->select(index, QItemSelectionModel::SelectCurrent | QItemSelectionModel::Rows);
     selectionModel()->select(index, QItemSelectionModel::ClearAndSelect | QItemSelectionModel::Rows);
     emit currentIndexActivated(index);
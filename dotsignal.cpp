@@ -27,6 +27,7 @@
 #include <QGraphicsSceneMouseEvent>
 #include <QKeyEvent>
 #include "dotsignal.h"
+#include "cyberiadasm_editor_items.h"
 
 #include <QDebug>
 
@@ -59,6 +60,13 @@ DotSignal::~DotSignal()
 
 }
 
+void DotSignal::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget)
+{
+    // the grabbers cover the small items entirely
+    if (paintDetailLevel(painter) == DetailLevel::Outline) return;
+    QGraphicsRectItem::paint(painter, option, widget);
+}
+
 QPointF DotSignal::getPreviousPosition() const
 {
     return previousPosition;
@@ -90,6 +98,15 @@ void DotSignal::deleteDot()
     emit signalDelete(this);
 }
 
+void DotSignal::reset()
+{
+    disconnect(this, nullptr, nullptr, nullptr);
+    setDotFlags(0);
+    setDeleteable(false);
+    setBrush(QBrush(Qt::green));
+    previousPosition = QPointF();
+}
+
 void DotSignal::mouseMoveEvent(QGraphicsSceneMouseEvent *event)
 {
     if(flags & Movable){
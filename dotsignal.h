@@ -51,6 +51,8 @@ public:
     bool isDeleteable() { return deleteable; }
     void setDeleteable(bool on);
     void deleteDot();
+    // the dot is detached from its owner to be reused by another one
+    void reset();
 
 signals:
     void previousPositionChanged();
@@ -60,6 +62,7 @@ signals:
     void signalDelete(QGraphicsItem *signalOwner);
 
 protected:
+    void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget) override;
     void mouseMoveEvent(QGraphicsSceneMouseEvent *event) override;
     void mousePressEvent(QGraphicsSceneMouseEvent *event) override;
     void mouseReleaseEvent(QGraphicsSceneMouseEvent *event) override;
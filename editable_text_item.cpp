@@ -29,6 +29,8 @@
 #include <QPainter>
 #include <QTextDocument>
 #include <QTextBlockFormat>
+#include <QFontMetricsF>
+#include <QPalette>
 #include <QDebug>
 
 #include "editable_text_item.h"
@@ -37,25 +39,207 @@
 #include "cyberiada_constants.h"
 #include "settings_manager.h"
 
+// the default margin of QTextDocument: the label has the geometry of the editor
+static qreal LABEL_DOCUMENT_MARGIN = 4;
 
 EditableTextItem::EditableTextItem(QGraphicsItem *parent):
     QGraphicsTextItem(parent)
 {
+    labelColor = QPalette().color(QPalette::Text);
+    labelOption.setWrapMode(QTextOption::WrapAtWordBoundaryOrAnywhere);
+    staticText.setTextFormat(Qt::PlainText);
     setFlags(QGraphicsItem::ItemIsSelectable);
     setTextInteractionFlags(Qt::NoTextInteraction);
-    setFont(FontManager::instance().getFont());
+    setFont(FontManager::instance().getFont(fontRole));
     connect(&FontManager::instance(), &FontManager::fontChanged, this, &EditableTextItem::onFontChanged);
 }
 
 EditableTextItem::EditableTextItem(const QString &text, QGraphicsItem *parent):
-    QGraphicsTextItem(text, parent)
+    QGraphicsTextItem(parent),
+    labelText(text)
 {
+    labelColor = QPalette().color(QPalette::Text);
+    labelOption.setWrapMode(QTextOption::WrapAtWordBoundaryOrAnywhere);
+    staticText.setTextFormat(Qt::PlainText);
     setFlags(QGraphicsItem::ItemIsSelectable);
     setTextInteractionFlags(Qt::NoTextInteraction);
-    setFont(FontManager::instance().getFont());
+    setFont(FontManager::instance().getFont(fontRole));
     connect(&FontManager::instance(), &FontManager::fontChanged, this, &EditableTextItem::onFontChanged);
 }
 
+QRectF EditableTextItem::boundingRect() const
+{
+    if (hasDocument) {
+        return QGraphicsTextItem::boundingRect();
+    }
+    layoutLabel();
+    return labelRect;
+}
+
+QPainterPath EditableTextItem::shape() const
+{
+    if (hasDocument) {
+        return QGraphicsTextItem::shape();
+    }
+    layoutLabel();
+    QPainterPath path;
+    path.addRect(labelRect);
+    return path;
+}
+
+bool EditableTextItem::contains(const QPointF &point) const
+{
+    if (hasDocument) {
+        return QGraphicsTextItem::contains(point);
+    }
+    layoutLabel();
+    return labelRect.contains(point);
+}
+
+QString EditableTextItem::toPlainText() const
+{
+    if (hasDocument) {
+        return QGraphicsTextItem::toPlainText();
+    }
+    return labelText;
+}
+
+void EditableTextItem::setPlainText(const QString &text)
+{
+    if (hasDocument) {
+        QGraphicsTextItem::setPlainText(text);
+        return;
+    }
+    labelText = text;
+    updateLabel();
+}
+
+QFont EditableTextItem::font() const
+{
+    if (hasDocument) {
+        return QGraphicsTextItem::font();
+    }
+    return labelFont;
+}
+
+void EditableTextItem::setFont(const QFont &font)
+{
+    if (hasDocument) {
+        QGraphicsTextItem::setFont(font);
+        return;
+    }
+    labelFont = font;
+    updateLabel();
+}
+
+qreal EditableTextItem::textWidth() const
+{
+    if (hasDocument) {
+        return QGraphicsTextItem::textWidth();
+    }
+    return labelWidth;
+}
+
+void EditableTextItem::setTextWidth(qreal width)
+{
+    if (hasDocument) {
+        QGraphicsTextItem::setTextWidth(width);
+        return;
+    }
+    labelWidth = width;
+    updateLabel();
+}
+
+void EditableTextItem::setTextInteractionFlags(Qt::TextInteractionFlags flags)
+{
+    if (flags != Qt::NoTextInteraction) {
+        createDocument();
+    }
+    if (hasDocument) {
+        QGraphicsTextItem::setTextInteractionFlags(flags);
+        return;
+    }
+    setFlag(QGraphicsItem::ItemIsFocusable, false);
+    setFlag(QGraphicsItem::ItemAcceptsInputMethod, false);
+}
+
+QTextCursor EditableTextItem::textCursor()
+{
+    createDocument();
+    return QGraphicsTextItem::textCursor();
+}
+
+void EditableTextItem::setTextCursor(const QTextCursor &cursor)
+{
+    createDocument();
+    QGraphicsTextItem::setTextCursor(cursor);
+}
+
+QTextDocument* EditableTextItem::document()
+{
+    createDocument();
+    return QGraphicsTextItem::document();
+}
+
+QColor EditableTextItem::defaultTextColor() const
+{
+    return labelColor;
+}
+
+void EditableTextItem::setDefaultTextColor(const QColor &color)
+{
+    labelColor = color;
+    if (hasDocument) {
+        QGraphicsTextItem::setDefaultTextColor(color);
+        return;
+    }
+    update();
+}
+
+void EditableTextItem::createDocument()
+{
+    if (hasDocument) return;
+    prepareGeometryChange();
+    QGraphicsTextItem::setDefaultTextColor(labelColor);
+    QGraphicsTextItem::setFont(labelFont);
+    QGraphicsTextItem::setTextWidth(labelWidth);
+    QGraphicsTextItem::document()->setDefaultTextOption(labelOption);
+    QGraphicsTextItem::setPlainText(labelText);
+    hasDocument = true;
+    labelText.clear();
+    staticText = QStaticText();
+}
+
+void EditableTextItem::updateLabel()
+{
+    prepareGeometryChange();
+    labelValid = false;
+    update();
+}
+
+void EditableTextItem::layoutLabel() const
+{
+    if (labelValid) return;
+    staticText.setText(labelText);
+    staticText.setTextOption(labelOption);
+    staticText.setTextWidth(labelWidth < 0 ? -1 : qMax(labelWidth - 2 * LABEL_DOCUMENT_MARGIN, qreal(0)));
+    staticText.prepare(QTransform(), labelFont);
+    QSizeF size = staticText.size();
+    if (labelText.isEmpty()) {
+        // the empty document has one line as well
+        const FontManager& fonts = FontManager::instance();
+        if (labelFont == fonts.getFont(fontRole)) {
+            size.setHeight(fonts.getFontMetrics(fontRole).height());
+        } else {
+            size.setHeight(QFontMetricsF(labelFont).height());
+        }
+    }
+    labelRect = QRectF(0, 0,
+                       labelWidth < 0 ? size.width() + 2 * LABEL_DOCUMENT_MARGIN : labelWidth,
+                       size.height() + 2 * LABEL_DOCUMENT_MARGIN);
+    labelValid = true;
+}
+
 void EditableTextItem::mousePressEvent(QGraphicsSceneMouseEvent *event) {
     if (dynamic_cast<CyberiadaSMEditorScene*>(scene())->getCurrentTool() != ToolType::Select ||
         SettingsManager::instance().getInspectorMode()) {
@@ -76,7 +260,27 @@ void EditableTextItem::mousePressEvent(QGraphicsSceneMouseEvent *event) {
         return;
     }
 
-    QGraphicsTextItem::mousePressEvent(event);
+    if (hasDocument) {
+        QGraphicsTextItem::mousePressEvent(event);
+    } else {
+        QGraphicsItem::mousePressEvent(event);
+    }
+}
+
+void EditableTextItem::mouseMoveEvent(QGraphicsSceneMouseEvent *event) {
+    if (hasDocument) {
+        QGraphicsTextItem::mouseMoveEvent(event);
+    } else {
+        QGraphicsItem::mouseMoveEvent(event);
+    }
+}
+
+void EditableTextItem::mouseReleaseEvent(QGraphicsSceneMouseEvent *event) {
+    if (hasDocument) {
+        QGraphicsTextItem::mouseReleaseEvent(event);
+    } else {
+        QGraphicsItem::mouseReleaseEvent(event);
+    }
 }
 
 void EditableTextItem::mouseDoubleClickEvent(QGraphicsSceneMouseEvent *event) {
@@ -120,16 +324,34 @@ void EditableTextItem::hoverEnterEvent(QGraphicsSceneHoverEvent *event) {
 }
 
 void EditableTextItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget) {
+    if (!isEdit && paintDetailLevel(painter) < minimumDetail) {
+        return;
+    }
     painter->setFont(QFont(font()));
 
-    QGraphicsTextItem::paint(painter, option, widget);
+    if (hasDocument) {
+        QGraphicsTextItem::paint(painter, option, widget);
+        return;
+    }
+    layoutLabel();
+    painter->setPen(labelColor);
+    painter->drawStaticText(QPointF(LABEL_DOCUMENT_MARGIN, LABEL_DOCUMENT_MARGIN), staticText);
 }
 
 void EditableTextItem::setTextAlignment(Qt::Alignment alignment) {
     QTextOption textOption;
     textOption.setAlignment(alignment);
     textOption.setWrapMode(QTextOption::WrapAnywhere);
-    document()->setDefaultTextOption(textOption);
+    labelOption = textOption;
+    if (hasDocument) {
+        QGraphicsTextItem::document()->setDefaultTextOption(textOption);
+        return;
+    }
+    updateLabel();
+}
+
+void EditableTextItem::setMinimumDetail(DetailLevel level) {
+    minimumDetail = level;
 }
 
 void EditableTextItem::setTextWidthEnabled(bool enabled) {
@@ -142,7 +364,12 @@ void EditableTextItem::setFontStyleChangeable(bool isChangeable) {
 
 void EditableTextItem::setFontBoldness(bool isBold)
 {
-    this->isBold = isBold;
+    setFontRole(isBold ? FontManager::BoldTextFont : FontManager::TextFont);
+}
+
+void EditableTextItem::setFontRole(FontManager::FontRole role)
+{
+    fontRole = role;
     onFontChanged(font());
 }
 
@@ -161,14 +388,8 @@ void EditableTextItem::onFontChanged(const QFont &newFont)
         emit sizeChanged();
         return;
     }
-    if (isBold) {
-        QFont newBoldFont = newFont;
-        newBoldFont.setBold(isBold);
-        setFont(newBoldFont);
-        emit sizeChanged();
-        return;
-    }
-    setFont(newFont);
+    // the font of the role is shared by the items
+    setFont(FontManager::instance().getFont(fontRole));
     emit sizeChanged();
 
     updateTextWidth();
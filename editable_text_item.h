@@ -25,21 +25,53 @@
 #define EDITABLETEXTITEM_H
 
 #include <QGraphicsTextItem>
+#include <QStaticText>
+#include <QTextOption>
+#include <QTextCursor>
+#include "cyberiada_constants.h"
+#include "fontmanager.h"
 
-
+// The text is painted as a static label until it is edited for the first time:
+// the QTextDocument of the QGraphicsTextItem is created only then. The accessors
+// of QGraphicsTextItem that would create the document are shadowed below.
 class EditableTextItem : public QGraphicsTextItem {
     Q_OBJECT
 public:
     explicit EditableTextItem(QGraphicsItem *parent = nullptr);
     explicit EditableTextItem(const QString &text, QGraphicsItem *parent = nullptr);
 
+    QRectF boundingRect() const override;
+    QPainterPath shape() const override;
+    bool contains(const QPointF &point) const override;
+
+    QString toPlainText() const;
+    void setPlainText(const QString &text);
+    QFont font() const;
+    void setFont(const QFont &font);
+    qreal textWidth() const;
+    void setTextWidth(qreal width);
+    // any interaction except none turns the label into the editor
+    void setTextInteractionFlags(Qt::TextInteractionFlags flags);
+    QTextCursor textCursor();
+    void setTextCursor(const QTextCursor &cursor);
+    QTextDocument* document();
+    // the color is kept by the item: QGraphicsTextItem::defaultTextColor creates the document
+    QColor defaultTextColor() const;
+    void setDefaultTextColor(const QColor &color);
+
     void setFontStyleChangeable(bool isChangeable);
     void setFontBoldness(bool isBold);
+    // the item uses the shared font of the role from the font manager
+    void setFontRole(FontManager::FontRole role);
     void setTextMargin(double newTextMargin);
+    // the text is not painted at the smaller scales
+    void setMinimumDetail(DetailLevel level);
 
 protected:
     void focusOutEvent(QFocusEvent *event) override;
     void mousePressEvent(QGraphicsSceneMouseEvent *event) override;
+    void mouseMoveEvent(QGraphicsSceneMouseEvent *event) override;
+    void mouseReleaseEvent(QGraphicsSceneMouseEvent *event) override;
     void mouseDoubleClickEvent(QGraphicsSceneMouseEvent *event) override;
     void keyPressEvent(QKeyEvent *event);
     void hoverEnterEvent(QGraphicsSceneHoverEvent *event) override;
@@ -58,12 +90,30 @@ protected slots:
 
 protected:
     void updateTextWidth();
-    bool isEdit;
+    bool isEdit = false;
     bool align;
     bool isFontStyleChangeable = true;
-    bool isBold = false;
+    FontManager::FontRole fontRole = FontManager::TextFont;
     bool isTextWidthEnabled = true;
-    double textMargin;
+    double textMargin = 0;
+    DetailLevel minimumDetail = DetailLevel::Full;
+
+private:
+    void createDocument();
+    void updateLabel();
+    // the static text is laid out when the label is shown or measured
+    void layoutLabel() const;
+
+    // the text is kept in the document after the first editing
+    bool hasDocument = false;
+    QString labelText;
+    QFont labelFont;
+    qreal labelWidth = -1;
+    QTextOption labelOption;
+    QColor labelColor;
+    mutable QStaticText staticText;
+    mutable QRectF labelRect;
+    mutable bool labelValid = false;
 };
 
 
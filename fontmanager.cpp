@@ -1 +1,84 @@
+/* -----------------------------------------------------------------------------
+ * The Cyberiada State Machine Editor
+ * -----------------------------------------------------------------------------
+ *
+ * Font Manager for the State Machine Editor
+ *
+ * Copyright (C) 2025 Anastasia Viktorova <viktorovaa.04@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see https://www.gnu.org/licenses/
+ *
+ * ----------------------------------------------------------------------------- */
+
+#include <QFontDatabase>
+#include <QStringList>
+
 #include "fontmanager.h"
+#include "cyberiada_constants.h"
+#include "myassert.h"
+
+FontManager::FontManager()
+{
+    updateFonts();
+}
+
+void FontManager::loadApplicationFonts()
+{
+    if (applicationFontsLoaded) return;
+    applicationFontsLoaded = true;
+    int fontId = QFontDatabase::addApplicationFont(FORMAL_COMMENT_FONT_FILE);
+    if (fontId != -1) {
+        QStringList fontFamilies = QFontDatabase::applicationFontFamilies(fontId);
+        if (!fontFamilies.isEmpty()) {
+            formalCommentFamily = fontFamilies.at(0);
+        }
+    }
+    updateFonts();
+}
+
+const QFont& FontManager::getFont(FontRole role) const
+{
+    MY_ASSERT(role >= 0 && role < FontRoleCount);
+    return fonts[role];
+}
+
+const QFontMetricsF& FontManager::getFontMetrics(FontRole role) const
+{
+    MY_ASSERT(role >= 0 && role < FontRoleCount);
+    return metrics.at(role);
+}
+
+void FontManager::setFont(const QFont &font)
+{
+    if (currentFont != font) {
+        currentFont = font;
+        updateFonts();
+        emit fontChanged(currentFont);
+    }
+}
+
+void FontManager::updateFonts()
+{
+    fonts[TextFont] = currentFont;
+    fonts[BoldTextFont] = currentFont;
+    fonts[BoldTextFont].setBold(true);
+    // the system font is used if the bundled one was not loaded
+    QString family = formalCommentFamily.isEmpty() ? QString(FORMAL_COMMENT_FONT_NAME) : formalCommentFamily;
+    fonts[FormalCommentFont] = QFont(family, currentFont.pointSize());
+
+    metrics.clear();
+    for (int i = 0; i < FontRoleCount; i++) {
+        metrics.append(QFontMetricsF(fonts[i]));
+    }
+}
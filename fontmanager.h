@@ -25,12 +25,25 @@
 #define FONTMANAGER_H
 
 #include <QFont>
+#include <QFontMetricsF>
+#include <QList>
 #include <QObject>
+#include <QString>
 
+// The fonts of the scene items. The bundled fonts are registered in the font
+// database once at startup; the fonts of the roles and their metrics are cached
+// and shared by the items until the editor font is changed.
 class FontManager : public QObject {
     Q_OBJECT
 
 public:
+    enum FontRole {
+        TextFont = 0,
+        BoldTextFont,
+        FormalCommentFont,
+        FontRoleCount
+    };
+
     FontManager(FontManager &other) = delete;
 
     void operator=(const FontManager &) = delete;
@@ -40,22 +53,28 @@ public:
         return instance;
     }
 
+    void loadApplicationFonts();
+
     QFont getFont() const {
         return currentFont;
     }
 
-    void setFont(const QFont &font) {
-        if (currentFont != font) {
-            currentFont = font;
-            emit fontChanged(currentFont);
-        }
-    }
+    const QFont& getFont(FontRole role) const;
+    const QFontMetricsF& getFontMetrics(FontRole role) const;
+
+    void setFont(const QFont &font);
 
 signals:
     void fontChanged(const QFont &newFont);
 
 private:
-    FontManager() = default;
+    FontManager();
+    void updateFonts();
+
     QFont currentFont;
+    bool applicationFontsLoaded = false;
+    QString formalCommentFamily;
+    QFont fonts[FontRoleCount];
+    QList<QFontMetricsF> metrics;
 };
 #endif // FONTMANAGER_H
@@ -26,11 +26,13 @@
 #include "smeditor_window.h"
 #include "cyberiada_constants.h"
 #include "settings_manager.h"
+#include "fontmanager.h"
 
 int main(int argc, char *argv[])
 {
 	qsrand(QDateTime::currentDateTime().toTime_t());
 	CyberiadaSMEditorApplication app(argc, argv);
+	FontManager::instance().loadApplicationFonts();
     try {
 		CyberiadaSMEditorWindow win;
 		win.show();
@@ -26,6 +26,10 @@ void SettingsManager::load() {
     selectionColor = QColor(s.value("display/selectionColor", QColor(Qt::darkGray).name()).toString());
     selectionBorderWidth = s.value("display/selectionBorderWidth", 2).toInt();
     selectionInvertText = s.value("display/selectionInvertText", false).toBool();
+
+    undoMemoryLimit = s.value("editing/undoMemoryLimit", 64).toInt();
+
+    treeFetchChunk = s.value("tree/fetchChunk", 256).toInt();
 }
 
 void SettingsManager::loadDefaults()
@@ -43,6 +47,10 @@ void SettingsManager::loadDefaults()
     setSelectionColor(QColor(Qt::red));
     setSelectionBorderWidth(2);
     setSelectionInvertText(false);
+
+    setUndoMemoryLimit(64);
+
+    setTreeFetchChunk(256);
 }
 
 void SettingsManager::setShowGrid(bool value)
@@ -131,3 +139,21 @@ void SettingsManager::setSelectionInvertText(bool value)
         emit selectionSettingsChanged();
     }
 }
+
+void SettingsManager::setUndoMemoryLimit(int value)
+{
+    if (undoMemoryLimit != value) {
+        undoMemoryLimit = value;
+        QSettings().setValue("editing/undoMemoryLimit", value);
+        emit undoSettingsChanged();
+    }
+}
+
+void SettingsManager::setTreeFetchChunk(int value)
+{
+    if (treeFetchChunk != value) {
+        treeFetchChunk = value;
+        QSettings().setValue("tree/fetchChunk", value);
+        emit treeSettingsChanged();
+    }
+}
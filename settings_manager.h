@@ -39,6 +39,14 @@ public:
     bool getSelectionInvertText() const { return selectionInvertText; }
     void setSelectionInvertText(bool value);
 
+    // megabytes
+    int getUndoMemoryLimit() const { return undoMemoryLimit; }
+    void setUndoMemoryLimit(int value);
+
+    // the number of the tree rows populated at once
+    int getTreeFetchChunk() const { return treeFetchChunk; }
+    void setTreeFetchChunk(int value);
+
 signals:
     void settingsChanged();
 
@@ -51,6 +59,9 @@ signals:
 
     void selectionSettingsChanged();
 
+    void undoSettingsChanged();
+    void treeSettingsChanged();
+
 private:
     SettingsManager();
     SettingsManager(const SettingsManager&) = delete;
@@ -73,6 +84,12 @@ private:
     QColor selectionColor;
     int selectionBorderWidth;
     bool selectionInvertText;
+
+    // editing
+    int undoMemoryLimit;
+
+    // tree
+    int treeFetchChunk;
 };
 
 #endif // SETTINGS_MANAGER_H
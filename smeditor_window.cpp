@@ -28,6 +28,11 @@
 #include <QFontDialog>
 #include <QFont>
 #include <QMessageBox>
+#include <QProgressDialog>
+#include <QElapsedTimer>
+#include <QStatusBar>
+#include <QProgressBar>
+#include <QMenu>
 
 #include "smeditor_window.h"
 #include "myassert.h"
@@ -35,6 +40,7 @@
 #include "dialogs/preferences_dialog.h"
 #include "dialogs/open_file_dialog.h"
 #include "settings_manager.h"
+#include "cyberiadasm_document_loader.h"
 
 
 CyberiadaSMEditorWindow::CyberiadaSMEditorWindow(QWidget* parent):
@@ -49,11 +55,30 @@ CyberiadaSMEditorWindow::CyberiadaSMEditorWindow(QWidget* parent):
     scene = new CyberiadaSMEditorScene(model, this);
 	sceneView->setScene(scene);
 
+    initializeUndo();
+
     openFileName = QString();
+    loader = NULL;
+    loadProgress = NULL;
+    loadInspectorMode = false;
+    loadedParseTime = 0;
+    loadedFirstFrameTime = -1;
+    buildProgress = new QProgressBar(this);
+    buildProgress->setMaximumWidth(200);
+    buildProgress->setTextVisible(false);
+    buildProgress->hide();
+    statusBar()->addPermanentWidget(buildProgress);
     initializeTools();
 
     connect(SMView, SIGNAL(currentIndexActivated(QModelIndex)),
             scene, SLOT(slotElementSelected(QModelIndex)));
+    // the items of the collapsed state machine are released
+    connect(SMView, &QTreeView::collapsed, scene, &CyberiadaSMEditorScene::slotStateMachineCollapsed);
+    connect(model, &CyberiadaSMModel::saveStarted, this, &CyberiadaSMEditorWindow::slotSaveStarted);
+    connect(model, &CyberiadaSMModel::saveFinished, this, &CyberiadaSMEditorWindow::slotSaveFinished);
+    connect(model, &CyberiadaSMModel::saveFailed, this, &CyberiadaSMEditorWindow::slotSaveFailed);
+    connect(scene, &CyberiadaSMEditorScene::buildProgress, this, &CyberiadaSMEditorWindow::slotSceneBuildProgress);
+    connect(scene, &CyberiadaSMEditorScene::buildFinished, this, &CyberiadaSMEditorWindow::slotSceneBuildFinished);
 }
 
 void CyberiadaSMEditorWindow::slotFileOpen()
@@ -62,38 +87,160 @@ void CyberiadaSMEditorWindow::slotFileOpen()
     if (dlg.exec() != QDialog::Accepted) { return; }
 
     QString fileName = dlg.selectedFile();
-    bool inspector = dlg.inspectorModeEnabled();
+    if (fileName.isEmpty()) { return; }
 
-    if (!fileName.isEmpty()) {
-        actionInspectorMode->setChecked(inspector);
-        SettingsManager::instance().setInspectorMode(inspector);
-
-        model->loadDocument(fileName);
-        SMView->setRootIndex(model->rootIndex());
-        SMView->expandToDepth(2);
-        QModelIndex sm = model->firstSMIndex();
-        if (sm.isValid()) {
-            scene->loadScene();
-            SMView->select(sm);
+    stopLoader();
+
+    loadInspectorMode = dlg.inspectorModeEnabled();
+
+    // the parsing is done in the worker thread, the GUI stays responsive
+    loader = new CyberiadaSMDocumentLoader(fileName, dlg.reconstructionEnabled(), false, this);
+    connect(loader, &QThread::finished, this, &CyberiadaSMEditorWindow::slotDocumentLoaded);
+
+    loadProgress = new QProgressDialog(tr("Loading %1...").arg(QFileInfo(fileName).fileName()),
+                                       tr("Cancel"), 0, 0, this);
+    loadProgress->setWindowTitle(tr("Load State Machine"));
+    loadProgress->setWindowModality(Qt::WindowModal);
+    loadProgress->setMinimumDuration(500);
+    connect(loadProgress, &QProgressDialog::canceled, this, &CyberiadaSMEditorWindow::slotDocumentLoadCanceled);
+
+    loader->start();
+}
+
+void CyberiadaSMEditorWindow::stopLoader()
+{
+    if (!loader) { return; }
+    disconnect(loader, &QThread::finished, this, &CyberiadaSMEditorWindow::slotDocumentLoaded);
+    loader->requestInterruption();
+    // the parser cannot be interrupted, the document is dropped when it is ready
+    loader->wait();
+    delete loader;
+    loader = NULL;
+    if (loadProgress) {
+        delete loadProgress;
+        loadProgress = NULL;
+    }
+}
+
+void CyberiadaSMEditorWindow::closeEvent(QCloseEvent* event)
+{
+    stopLoader();
+    QMainWindow::closeEvent(event);
+}
+
+void CyberiadaSMEditorWindow::slotDocumentLoadCanceled()
+{
+    if (loader) {
+        loader->cancel();
+    }
+    statusBar()->showMessage(tr("Loading canceled"), 5000);
+}
+
+void CyberiadaSMEditorWindow::slotDocumentLoaded()
+{
+    MY_ASSERT(loader);
+    CyberiadaSMDocumentLoader* finished_loader = loader;
+    loader = NULL;
+    finished_loader->deleteLater();
+    if (loadProgress) {
+        loadProgress->deleteLater();
+        loadProgress = NULL;
+    }
+
+    if (finished_loader->isCanceled()) {
+        return;
+    }
+    if (finished_loader->hasError()) {
+        QMessageBox::critical(this, tr("Load State Machine"), finished_loader->error());
+        return;
+    }
+
+    QString fileName = finished_loader->path();
+    actionInspectorMode->setChecked(loadInspectorMode);
+    SettingsManager::instance().setInspectorMode(loadInspectorMode);
+
+    QElapsedTimer timer;
+    timer.start();
+    model->setDocument(finished_loader->takeDocument());
+    if (model->hasRecoveryJournal()) {
+        if (QMessageBox::question(this, tr("Load State Machine"),
+                                  tr("The editor was not closed properly.\n"
+                                     "Restore the unsaved changes of %1?").arg(QFileInfo(fileName).fileName()),
+                                  QMessageBox::Yes | QMessageBox::No, QMessageBox::Yes) == QMessageBox::Yes) {
+            if (model->recoverJournal() < 0) {
+                QMessageBox::warning(this, tr("Load State Machine"), tr("Cannot restore the unsaved changes."));
+            }
+        } else {
+            model->discardRecoveryJournal();
+        }
+        // the time spent in the dialog is not a part of the build
+        timer.restart();
+    }
+    SMView->setRootIndex(model->rootIndex());
+    SMView->expandToDepth(2);
+    loadedFileName = QFileInfo(fileName).fileName();
+    loadedParseTime = finished_loader->parseTime();
+    loadedFirstFrameTime = -1;
+    QModelIndex sm = model->firstSMIndex();
+    if (sm.isValid()) {
+        scene->loadScene();
+        SMView->select(sm);
+    }
+    // the visible part of the scene is built by now
+    loadedFirstFrameTime = timer.elapsed();
+
+    if (scene->isBuilding()) {
+        statusBar()->showMessage(tr("Loading %1: parsing %2 ms, first frame %3 ms")
+                                 .arg(loadedFileName)
+                                 .arg(loadedParseTime)
+                                 .arg(loadedFirstFrameTime));
+    } else {
+        statusBar()->showMessage(tr("Loaded %1: parsing %2 ms, building %3 ms")
+                                 .arg(loadedFileName)
+                                 .arg(loadedParseTime)
+                                 .arg(loadedFirstFrameTime));
+    }
+
+    QFileInfo fileInfo(fileName);
+    openFileName = fileInfo.fileName();
+
+    if (!openFileName.isEmpty()) {
+        if (SettingsManager::instance().getInspectorMode()) {
+            setWindowTitle(openFileName + " (inspector mode)");
+        } else {
+            setWindowTitle(openFileName);
         }
+    }
+}
 
-       QFileInfo fileInfo(fileName);
-       openFileName = fileInfo.fileName();
+void CyberiadaSMEditorWindow::slotSceneBuildProgress(int built, int total)
+{
+    if (built >= total) {
+        buildProgress->hide();
+        return;
+    }
+    buildProgress->setRange(0, total);
+    buildProgress->setValue(built);
+    buildProgress->show();
+}
 
-       if (!openFileName.isEmpty()) {
-           if (SettingsManager::instance().getInspectorMode()) {
-               setWindowTitle(openFileName + " (inspector mode)");
-           } else {
-               setWindowTitle(openFileName);
-           }
-       }
+void CyberiadaSMEditorWindow::slotSceneBuildFinished(qint64 msec)
+{
+    buildProgress->hide();
+    if (loadedFirstFrameTime < 0) {
+        // the whole scene was built with the first frame, slotDocumentLoaded reports it
+        return;
     }
+    statusBar()->showMessage(tr("Loaded %1: parsing %2 ms, first frame %3 ms, building %4 ms")
+                             .arg(loadedFileName)
+                             .arg(loadedParseTime)
+                             .arg(loadedFirstFrameTime)
+                             .arg(msec));
 }
 
 void CyberiadaSMEditorWindow::slotFileSave()
 {
-    if (model->rootDocument() && !model->rootDocument()->get_file_path().empty()) {
-        qDebug() << model->rootDocument()->get_file_path().empty();
+    if (model->rootDocument() && model->hasFilePath()) {
         model->saveDocument();
     } else {
         slotFileSaveAs();
@@ -130,6 +277,22 @@ void CyberiadaSMEditorWindow::slotFileSaveAs()
     }
 }
 
+void CyberiadaSMEditorWindow::slotSaveStarted(const QString& path)
+{
+    statusBar()->showMessage(tr("Saving %1...").arg(QFileInfo(path).fileName()));
+}
+
+void CyberiadaSMEditorWindow::slotSaveFinished(const QString& path, qint64 msec)
+{
+    statusBar()->showMessage(tr("Saved %1 in %2 ms").arg(QFileInfo(path).fileName()).arg(msec), 5000);
+}
+
+void CyberiadaSMEditorWindow::slotSaveFailed(const QString& path, const QString& error)
+{
+    statusBar()->clearMessage();
+    QMessageBox::critical(this, tr("Save State Machine"), path + ":\n" + error);
+}
+
 void CyberiadaSMEditorWindow::slotFileExport()
 {
     QRectF sceneRect = scene->sceneRect();
@@ -192,6 +355,20 @@ void CyberiadaSMEditorWindow::initializeTools()
     actionPolylineMode->setChecked(sm.getPolylineMode());
 }
 
+void CyberiadaSMEditorWindow::initializeUndo()
+{
+    QUndoStack* stack = model->undoStack();
+    QAction* undoAction = stack->createUndoAction(this, tr("&Undo"));
+    undoAction->setShortcut(QKeySequence::Undo);
+    QAction* redoAction = stack->createRedoAction(this, tr("&Redo"));
+    redoAction->setShortcut(QKeySequence::Redo);
+
+    QMenu* menuEdit = new QMenu(tr("&Edit"), this);
+    menuEdit->addAction(undoAction);
+    menuEdit->addAction(redoAction);
+    menuBar->insertMenu(menuView->menuAction(), menuEdit);
+}
+
 void CyberiadaSMEditorWindow::slotFontTriggered()
 {
     bool ok;
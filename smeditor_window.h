@@ -29,13 +29,23 @@
 #include "cyberiadasm_model.h"
 #include "cyberiadasm_editor_scene.h"
 
+class QProgressDialog;
+class QProgressBar;
+class CyberiadaSMDocumentLoader;
+
 class CyberiadaSMEditorWindow: public QMainWindow, public Ui_SMEditorWindow {
 Q_OBJECT
 public:
     CyberiadaSMEditorWindow(QWidget* parent = 0);
 
+protected:
+    void                    closeEvent(QCloseEvent* event) override;
+
 private:
     void                    initializeTools();
+    void                    initializeUndo();
+    // the running load is interrupted and its result is thrown away
+    void                    stopLoader();
 
 public slots:
 	void                    slotFileOpen();
@@ -64,6 +74,15 @@ public slots:
 
     void                    slotDeleteElement();
 
+private slots:
+    void                    slotDocumentLoaded();
+    void                    slotDocumentLoadCanceled();
+    void                    slotSaveStarted(const QString& path);
+    void                    slotSaveFinished(const QString& path, qint64 msec);
+    void                    slotSaveFailed(const QString& path, const QString& error);
+    void                    slotSceneBuildProgress(int built, int total);
+    void                    slotSceneBuildFinished(qint64 msec);
+
 private:
 	CyberiadaSMModel*       model;
 	CyberiadaSMEditorScene* scene;
@@ -72,6 +91,16 @@ private:
 
     QString openFileName;
 
+    // the document being parsed in the background
+    CyberiadaSMDocumentLoader* loader;
+    QProgressDialog*        loadProgress;
+    bool                    loadInspectorMode;
+    // the scene of the loaded document is built in the background
+    QProgressBar*           buildProgress;
+    QString                 loadedFileName;
+    qint64                  loadedParseTime;
+    qint64                  loadedFirstFrameTime;
+
     QMap<ToolType, QAction*> toolActMap;
 };
 
@@ -34,6 +34,7 @@
 #include "cyberiadasm_editor_transition_item.h"
 #include "cyberiada_constants.h"
 #include "cyberiadasm_editor_scene.h"
+#include "cyberiadasm_editor_geometry.h"
 #include "settings_manager.h"
 
 /* -----------------------------------------------------------------------------
@@ -43,15 +44,17 @@
 TemporaryTransition::TemporaryTransition(QObject *parent_object,
                                          CyberiadaSMModel *model,
                                          QGraphicsItem *parent,
-                                         QMap<Cyberiada::ID, QGraphicsItem*>& elementItem,
+                                         CyberiadaSMEditorItemRegistry& elementItem,
                                          CyberiadaSMEditorAbstractItem* source,
                                          QPointF& targetPoint) :
     // QObject(parent_object),
     QGraphicsItem(parent),
     model(model),
-    elementIdToItemMap(elementItem),
+    itemRegistry(elementItem),
     source(source),
     target(source),
+    sourceHandle(CyberiadaSMEditorItemRegistry::invalidHandle),
+    targetHandle(CyberiadaSMEditorItemRegistry::invalidHandle),
     targetPoint(targetPoint)
 {
     setAcceptHoverEvents(true);
@@ -107,6 +110,7 @@ CyberiadaSMEditorAbstractItem *TemporaryTransition::getSource() const
 void TemporaryTransition::setSource(CyberiadaSMEditorAbstractItem *newSource)
 {
     source = newSource;
+    sourceHandle = CyberiadaSMEditorItemRegistry::invalidHandle;
 }
 
 Cyberiada::Element *TemporaryTransition::getSourceElement() const
@@ -127,10 +131,14 @@ void TemporaryTransition::setSourcePoint(const QPointF &point)
 
 QPointF TemporaryTransition::sourceCenter() const
 {
-    Cyberiada::ID id = source->getId();
-    if(!elementIdToItemMap.value(id)) return QPoint();
-    MY_ASSERT(elementIdToItemMap.value(id));
-    return (elementIdToItemMap.value(id))->sceneBoundingRect().center();
+    // the item of the end can be deleted while the transition is drawn
+    QGraphicsItem* item = itemRegistry.item(sourceHandle);
+    if (item == nullptr) {
+        sourceHandle = itemRegistry.handle(source->getId());
+        item = itemRegistry.item(sourceHandle);
+    }
+    if(!item) return QPoint();
+    return item->sceneBoundingRect().center();
 }
 
 CyberiadaSMEditorAbstractItem *TemporaryTransition::getTarget() const
@@ -141,6 +149,7 @@ CyberiadaSMEditorAbstractItem *TemporaryTransition::getTarget() const
 void TemporaryTransition::setTarget(CyberiadaSMEditorAbstractItem *newTarget)
 {
     target = newTarget;
+    targetHandle = CyberiadaSMEditorItemRegistry::invalidHandle;
 }
 
 Cyberiada::Element *TemporaryTransition::getTargetElement() const
@@ -161,10 +170,14 @@ void TemporaryTransition::setTargetPoint(const QPointF &point)
 
 QPointF TemporaryTransition::targetCenter() const
 {
-    Cyberiada::ID id = target->getId();
-    if(!elementIdToItemMap.value(id)) return QPoint();
-    MY_ASSERT(elementIdToItemMap.value(id));
-    return (elementIdToItemMap.value(id))->sceneBoundingRect().center();
+    // the item of the end can be deleted while the transition is drawn
+    QGraphicsItem* item = itemRegistry.item(targetHandle);
+    if (item == nullptr) {
+        targetHandle = itemRegistry.handle(target->getId());
+        item = itemRegistry.item(targetHandle);
+    }
+    if(!item) return QPoint();
+    return item->sceneBoundingRect().center();
 }
 
 QPainterPath TemporaryTransition::path() const
@@ -314,87 +327,16 @@ void TemporaryTransition::drawArrow(QPainter* painter)
 
 CyberiadaSMEditorAbstractItem *TemporaryTransition::itemUnderCursor()
 {
-    QList<QGraphicsItem*> items = scene()->items(prevPosition);
-
-    CyberiadaSMEditorAbstractItem* cItem = nullptr;
-    for (QGraphicsItem* item : items) {
-        cItem = dynamic_cast<CyberiadaSMEditorAbstractItem*>(item);
-        if (!cItem) { continue; }
-
-        if (cItem->type() == CyberiadaSMEditorAbstractItem::StateItem ||
-            cItem->type() == CyberiadaSMEditorAbstractItem::CompositeStateItem ||
-            cItem->type() == CyberiadaSMEditorAbstractItem::VertexItem) {
-            return cItem;
-        }
-    }
-    return nullptr;
+    CyberiadaSMEditorScene* cScene = dynamic_cast<CyberiadaSMEditorScene*>(scene());
+    if (!cScene) return nullptr;
+    return cScene->getSpatialIndex().connectableAt(prevPosition);
 }
 
 QPointF TemporaryTransition::findIntersectionWithItem(const CyberiadaSMEditorAbstractItem *item,
                                                                   const QPointF& start, const QPointF& end,
                                                                   bool* hasIntersections)
 {
-    if (!item) return QPointF();
-
-    int margin = 60;
-    QRectF adjustedRect = item->sceneBoundingRect().adjusted(-margin, -margin, margin, margin);
-
-    if (!adjustedRect.contains(start)) {
-        *hasIntersections = false;
-        return QPointF();
-    }
-
-    QPointF dir = end - start;
-    if (dir.isNull()) {
-        return QPointF();
-    }
-
-    if (item->type() == CyberiadaSMEditorAbstractItem::VertexItem) {
-        *hasIntersections = true;
-        return item->sceneBoundingRect().center();
-    }
-
-    QLineF rayForward(start, start + dir * 1e5);
-    QLineF rayBackward(start, start - dir * 1e5);
-
-    QPainterPath shape = item->shape();
-    QPainterPath sceneShape = item->sceneTransform().map(shape);
-    QPolygonF polygon = sceneShape.toFillPolygon();
-
-    QPointF closestIntersection;
-    qreal minDist = std::numeric_limits<qreal>::max();
-
-    for (int i = 0; i < polygon.size(); ++i) {
-        QPointF p1 = polygon[i];
-        QPointF p2 = polygon[(i + 1) % polygon.size()];
-
-        QLineF edge(p1, p2);
-        QPointF intersectionPoint;
-
-        // find closest intersection to start point
-        if (rayForward.intersect(edge, &intersectionPoint) == QLineF::BoundedIntersection) {
-            qreal dist = QLineF(start, intersectionPoint).length();
-            if (dist < minDist) {
-                minDist = dist;
-                closestIntersection = intersectionPoint;
-            }
-        }
-        if (rayBackward.intersect(edge, &intersectionPoint) == QLineF::BoundedIntersection) {
-            qreal dist = QLineF(start, intersectionPoint).length();
-            if (dist < minDist) {
-                minDist = dist;
-                closestIntersection = intersectionPoint;
-            }
-        }
-    }
-
-    if (minDist < std::numeric_limits<qreal>::max()) {
-        *hasIntersections = true;
-        return closestIntersection;
-    } else {
-        *hasIntersections = false;
-        return QPointF();
-    }
+    return CyberiadaSMEditorGeometry::itemIntersection(item, start, end, hasIntersections);
 }
 
 void TemporaryTransition::slotMoveDot(QGraphicsItem *signalOwner, qreal dx, qreal dy, QPointF p)
@@ -11,6 +11,7 @@
 #include <QPainter>
 
 #include "cyberiadasm_editor_items.h"
+#include "cyberiadasm_editor_item_registry.h"
 #include "dotsignal.h"
 
 
@@ -24,7 +25,7 @@ public:
     explicit TemporaryTransition(QObject *parent_object,
                                  CyberiadaSMModel *model,
                                  QGraphicsItem *parent,
-                                 QMap<Cyberiada::ID, QGraphicsItem*> &elementItem,
+                                 CyberiadaSMEditorItemRegistry& elementItem,
                                  CyberiadaSMEditorAbstractItem* source,
                                  QPointF& targetPoint);
     ~TemporaryTransition();
@@ -65,10 +66,12 @@ private:
                                      bool* hasIntersections);
 
     CyberiadaSMModel* model;
-    QMap<Cyberiada::ID, QGraphicsItem*>& elementIdToItemMap;
+    CyberiadaSMEditorItemRegistry& itemRegistry;
 
     CyberiadaSMEditorAbstractItem* source;
     CyberiadaSMEditorAbstractItem* target;
+    mutable CyberiadaSMEditorItemRegistry::Handle sourceHandle;
+    mutable CyberiadaSMEditorItemRegistry::Handle targetHandle;
     QPointF sourcePoint;
     QPointF targetPoint;
 
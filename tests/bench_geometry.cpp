@@ -0,0 +1,92 @@
+/* -----------------------------------------------------------------------------
+ * The Cyberiada State Machine Editor
+ * -----------------------------------------------------------------------------
+ *
+ * The Outline Intersection Benchmark
+ *
+ * Copyright (C) 2024 Alexey Fedoseev <aleksey@fedoseev.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see https://www.gnu.org/licenses/
+ *
+ * ----------------------------------------------------------------------------- */
+
+#include <QtTest>
+#include <QtMath>
+
+#include "cyberiadasm_editor_geometry.h"
+
+// the lines go from the center of the outline in the evenly spread directions
+#define BENCH_LINES_COUNT 1000
+
+class BenchGeometry: public QObject {
+Q_OBJECT
+
+private slots:
+    void intersection_data();
+    void intersection();
+};
+
+void BenchGeometry::intersection_data()
+{
+    QTest::addColumn<bool>("circle");
+    QTest::addColumn<bool>("analytic");
+    QTest::newRow("rounded rect analytic") << false << true;
+    QTest::newRow("rounded rect polygon") << false << false;
+    QTest::newRow("circle analytic") << true << true;
+    QTest::newRow("circle polygon") << true << false;
+}
+
+void BenchGeometry::intersection()
+{
+    QFETCH(bool, circle);
+    QFETCH(bool, analytic);
+    QRectF rect(0, 0, 200, 100);
+    qreal radius = circle ? 50 : 10;
+    if (circle) {
+        rect = QRectF(0, 0, 2 * radius, 2 * radius);
+    }
+    // the flattened outline the items were intersected with before
+    QPainterPath path;
+    if (circle) {
+        path.addEllipse(rect);
+    } else {
+        path.addRoundedRect(rect, radius, radius);
+    }
+    QPointF start = rect.center();
+    QList<QPointF> dirs;
+    for (int i = 0; i < BENCH_LINES_COUNT; i++) {
+        qreal angle = 2 * M_PI * i / BENCH_LINES_COUNT;
+        dirs.append(QPointF(qCos(angle), qSin(angle)));
+    }
+    int found = 0;
+    QBENCHMARK {
+        found = 0;
+        for (int i = 0; i < dirs.size(); i++) {
+            QPointF point;
+            bool result;
+            if (!analytic) {
+                result = CyberiadaSMEditorGeometry::linePath(start, dirs[i], path, &point);
+            } else if (circle) {
+                result = CyberiadaSMEditorGeometry::lineCircle(start, dirs[i], rect.center(), radius, &point);
+            } else {
+                result = CyberiadaSMEditorGeometry::lineRoundedRect(start, dirs[i], rect, radius, &point);
+            }
+            if (result) found++;
+        }
+    }
+    QCOMPARE(found, BENCH_LINES_COUNT);
+}
+
+QTEST_MAIN(BenchGeometry)
+#include "bench_geometry.moc"
@@ -0,0 +1,187 @@
+/* -----------------------------------------------------------------------------
+ * The Cyberiada State Machine Editor
+ * -----------------------------------------------------------------------------
+ *
+ * The Model Benchmark
+ *
+ * Copyright (C) 2024 Alexey Fedoseev <aleksey@fedoseev.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see https://www.gnu.org/licenses/
+ *
+ * ----------------------------------------------------------------------------- */
+
+#include <QtTest>
+
+#include "cyberiadasm_model.h"
+#include "cyberiadasm_undo.h"
+
+#define BENCH_STATES_COUNT  10000
+#define BENCH_LOOKUPS_COUNT 1000
+#define BENCH_NESTING_DEPTH 10
+#define BENCH_SIBLINGS_COUNT 100
+#define BENCH_DRAG_STEPS    100
+#define BENCH_EDITS_COUNT   10000
+#define BENCH_EDITED_STATES 100
+
+class BenchModel: public QObject {
+Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+
+    void idLookup_data();
+    void idLookup();
+    void nestedDrag();
+    void undoMemory_data();
+    void undoMemory();
+
+private:
+    // the flat document of BENCH_STATES_COUNT states is set to the model like the loaded one
+    void setLargeDocument();
+
+    CyberiadaSMModel*         model;
+    Cyberiada::StateMachine*  sm;
+    QList<Cyberiada::State*>  states;
+};
+
+void BenchModel::init()
+{
+    model = new CyberiadaSMModel(NULL);
+    sm = NULL;
+    states.clear();
+}
+
+void BenchModel::cleanup()
+{
+    delete model;
+    model = NULL;
+}
+
+void BenchModel::setLargeDocument()
+{
+    Cyberiada::LocalDocument* doc = new Cyberiada::LocalDocument();
+    sm = doc->new_state_machine("SM", Cyberiada::Rect(0, 0, 100 * 150, 100 * 100));
+    for (int i = 0; i < BENCH_STATES_COUNT; i++) {
+        states.append(doc->new_state(sm, QString("State %1").arg(i).toStdString(), Cyberiada::Action(),
+                                     Cyberiada::Rect((i % 100) * 150, (i / 100) * 100, 100, 50),
+                                     Cyberiada::Rect(), Cyberiada::Color()));
+    }
+    model->setDocument(doc);
+}
+
+void BenchModel::idLookup_data()
+{
+    QTest::addColumn<bool>("indexed");
+    QTest::newRow("id index") << true;
+    QTest::newRow("find_element_by_id") << false;
+}
+
+void BenchModel::idLookup()
+{
+    QFETCH(bool, indexed);
+    setLargeDocument();
+    QList<QString> ids;
+    for (int i = 0; i < BENCH_LOOKUPS_COUNT; i++) {
+        ids.append(QString(states[i * (BENCH_STATES_COUNT / BENCH_LOOKUPS_COUNT)]->get_id().c_str()));
+    }
+    const Cyberiada::LocalDocument* doc = model->rootDocument();
+    int found = 0;
+    QBENCHMARK {
+        found = 0;
+        for (int i = 0; i < ids.size(); i++) {
+            const Cyberiada::Element* element;
+            if (indexed) {
+                element = model->idToElement(ids[i]);
+            } else {
+                // the linear search of the library the index replaces
+                element = doc->find_element_by_id(ids[i].toStdString());
+            }
+            if (element) found++;
+        }
+    }
+    QCOMPARE(found, BENCH_LOOKUPS_COUNT);
+}
+
+void BenchModel::nestedDrag()
+{
+    // every level has the siblings before the composite state of the next level
+    Cyberiada::LocalDocument* doc = new Cyberiada::LocalDocument();
+    sm = doc->new_state_machine("SM", Cyberiada::Rect(0, 0, 10000, 10000));
+    Cyberiada::ElementCollection* parent = sm;
+    Cyberiada::State* dragged = NULL;
+    for (int level = 0; level < BENCH_NESTING_DEPTH; level++) {
+        for (int i = 0; i < BENCH_SIBLINGS_COUNT; i++) {
+            doc->new_state(parent, QString("State %1.%2").arg(level).arg(i).toStdString(), Cyberiada::Action(),
+                           Cyberiada::Rect(i * 10, 0, 5, 5), Cyberiada::Rect(), Cyberiada::Color());
+        }
+        dragged = doc->new_state(parent, QString("Level %1").arg(level).toStdString(), Cyberiada::Action(),
+                                 Cyberiada::Rect(10, 10, 5000 - level * 400, 5000 - level * 400),
+                                 Cyberiada::Rect(), Cyberiada::Color());
+        parent = dragged;
+    }
+    model->setDocument(doc);
+
+    // a drag step is what the state item does on a mouse move
+    int step = 0;
+    QBENCHMARK {
+        for (int i = 0; i < BENCH_DRAG_STEPS; i++, step++) {
+            QModelIndex index = model->elementToIndex(dragged);
+            QVERIFY(model->updateGeometry(index, Cyberiada::Rect(10 + step % 50, 10, 1400, 1400)));
+            QVERIFY(model->parent(index).isValid());
+        }
+    }
+}
+
+void BenchModel::undoMemory_data()
+{
+    QTest::addColumn<qint64>("limit");
+    QTest::newRow("unlimited") << qint64(0);
+    QTest::newRow("1 MiB") << qint64(1024 * 1024);
+}
+
+void BenchModel::undoMemory()
+{
+    QFETCH(qint64, limit);
+    model->setDocument(new Cyberiada::LocalDocument());
+    sm = model->newStateMachine("SM", Cyberiada::Rect(0, 0, 10000, 1000));
+    for (int i = 0; i < BENCH_EDITED_STATES; i++) {
+        states.append(model->newState(sm, QString("State %1").arg(i).toStdString(), Cyberiada::Action(),
+                                      Cyberiada::Rect(i * 100, 10, 50, 50)));
+    }
+    CyberiadaSMUndoStack* stack = model->undoStack();
+    stack->reset();
+    stack->setMemoryLimit(limit);
+
+    // the titles and the moves of the different states are not merged
+    QBENCHMARK_ONCE {
+        for (int i = 0; i < BENCH_EDITS_COUNT; i++) {
+            QModelIndex index = model->elementToIndex(states[i % BENCH_EDITED_STATES]);
+            if (i % 2) {
+                QVERIFY(model->updateTitle(index, QString("Title %1").arg(i)));
+            } else {
+                QVERIFY(model->updateGeometry(index, Cyberiada::Rect((i % BENCH_EDITED_STATES) * 100, i % 500, 50, 50)));
+            }
+        }
+    }
+    if (limit > 0) {
+        QVERIFY(stack->memoryUsage() <= limit);
+    }
+    qDebug() << "undo commands:" << stack->count();
+    // the memory taken by the history is the result
+    QTest::setBenchmarkResult(stack->memoryUsage(), QTest::BytesAllocated);
+}
+
+QTEST_MAIN(BenchModel)
+#include "bench_model.moc"
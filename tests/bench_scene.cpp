@@ -0,0 +1,498 @@
+/* -----------------------------------------------------------------------------
+ * The Cyberiada State Machine Editor
+ * -----------------------------------------------------------------------------
+ *
+ * The Editor Scene Benchmark
+ *
+ * Copyright (C) 2024 Alexey Fedoseev <aleksey@fedoseev.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see https://www.gnu.org/licenses/
+ *
+ * ----------------------------------------------------------------------------- */
+
+#include <QtTest>
+#include <QGraphicsView>
+#include <QMap>
+#include <QImage>
+#include <QPainter>
+#include <QScrollBar>
+
+#include "cyberiadasm_model.h"
+#include "cyberiadasm_editor_scene.h"
+#include "cyberiadasm_editor_sm_item.h"
+#include "settings_manager.h"
+#include "dotsignal.h"
+#include "editable_text_item.h"
+
+// the chart is a square of BENCH_GRID_SIDE x BENCH_GRID_SIDE states, the neighbours
+// in a row are connected by the transitions
+#define BENCH_GRID_SIDE      100
+#define BENCH_STATE_WIDTH    100
+#define BENCH_STATE_HEIGHT   50
+#define BENCH_STATE_STEP_X   150
+#define BENCH_STATE_STEP_Y   100
+#define BENCH_LOOKUPS_COUNT  1000
+#define BENCH_SELECTED_COUNT 100
+#define BENCH_VIEW_WIDTH     1280
+#define BENCH_VIEW_HEIGHT    800
+#define BENCH_WAIT_MSEC      120000
+// the part of the chart painted by the level of detail benchmark, in states
+#define BENCH_PAINT_SIDE     20
+// the pan of the grid benchmark, in pixels per frame
+#define BENCH_PAN_FRAMES     20
+#define BENCH_PAN_STEP       10
+// the deep chart of the bounds benchmark
+#define BENCH_NESTING_DEPTH  10
+#define BENCH_SIBLINGS_COUNT 100
+// the mouse moves of the drag benchmark
+#define BENCH_DRAG_STEPS     100
+// the selected items of the grabbers benchmark, 8 grabbers each
+#define BENCH_GRABBER_OWNERS 8
+// the labels of the label benchmarks, in a square
+#define BENCH_LABELS_SIDE    30
+
+class BenchScene: public QObject {
+Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void registryLookup_data();
+    void registryLookup();
+    void selectItems();
+    void paintView();
+    void firstFrame_data();
+    void firstFrame();
+    void paintLevelOfDetail_data();
+    void paintLevelOfDetail();
+    void gridPan_data();
+    void gridPan();
+    void smBounds_data();
+    void smBounds();
+    void dragTarget_data();
+    void dragTarget();
+    void grabbers_data();
+    void grabbers();
+    void labelCreate_data();
+    void labelCreate();
+    void labelPaint_data();
+    void labelPaint();
+
+private:
+    // builds all the items of the chart and waits for the end of the build
+    void loadScene();
+    // the view is centered on the middle of the chart at the scale
+    void resetView(qreal scale = 1.0);
+    void renderView(QImage& image);
+    // the labels are created in the scene; the edited ones get the text document at once
+    void addLabels(QGraphicsScene* label_scene, bool edited);
+
+    CyberiadaSMModel*              model;
+    CyberiadaSMEditorScene*        scene;
+    QGraphicsView*                 view;
+    Cyberiada::StateMachine*       sm;
+    QList<Cyberiada::State*>       states;
+    QList<Cyberiada::Transition*>  transitions;
+};
+
+void BenchScene::initTestCase()
+{
+    Cyberiada::LocalDocument* doc = new Cyberiada::LocalDocument();
+    sm = doc->new_state_machine("SM", Cyberiada::Rect(0, 0, BENCH_GRID_SIDE * BENCH_STATE_STEP_X,
+                                                      BENCH_GRID_SIDE * BENCH_STATE_STEP_Y));
+    for (int row = 0; row < BENCH_GRID_SIDE; row++) {
+        for (int column = 0; column < BENCH_GRID_SIDE; column++) {
+            Cyberiada::State* state = doc->new_state(sm, QString("State %1.%2").arg(row).arg(column).toStdString(),
+                                                     Cyberiada::Action(Cyberiada::actionEntry, "x = 1"),
+                                                     Cyberiada::Rect(column * BENCH_STATE_STEP_X + 10,
+                                                                     row * BENCH_STATE_STEP_Y + 10,
+                                                                     BENCH_STATE_WIDTH, BENCH_STATE_HEIGHT),
+                                                     Cyberiada::Rect(), Cyberiada::Color());
+            if (column > 0) {
+                transitions.append(doc->new_transition(sm, Cyberiada::transitionExternal, states.last(), state,
+                                                       Cyberiada::Action("tick", "", "x = 2"),
+                                                       Cyberiada::Polyline(), Cyberiada::Point(), Cyberiada::Point(),
+                                                       Cyberiada::Point(), Cyberiada::Rect(), Cyberiada::Color()));
+            }
+            states.append(state);
+        }
+    }
+    model = new CyberiadaSMModel(NULL);
+    model->setDocument(doc);
+    scene = new CyberiadaSMEditorScene(model);
+    view = new QGraphicsView(scene);
+    view->resize(BENCH_VIEW_WIDTH, BENCH_VIEW_HEIGHT);
+    loadScene();
+    qDebug() << "scene items:" << scene->items().size();
+}
+
+void BenchScene::cleanupTestCase()
+{
+    delete view;
+    view = NULL;
+    delete scene;
+    scene = NULL;
+    delete model;
+    model = NULL;
+}
+
+void BenchScene::loadScene()
+{
+    QSignalSpy finished(scene, &CyberiadaSMEditorScene::buildFinished);
+    scene->loadScene();
+    if (finished.isEmpty()) {
+        QVERIFY(finished.wait(BENCH_WAIT_MSEC));
+    }
+}
+
+void BenchScene::resetView(qreal scale)
+{
+    view->resetTransform();
+    view->scale(scale, scale);
+    view->centerOn(BENCH_GRID_SIDE * BENCH_STATE_STEP_X / 2, BENCH_GRID_SIDE * BENCH_STATE_STEP_Y / 2);
+}
+
+void BenchScene::renderView(QImage& image)
+{
+    QPainter painter(&image);
+    view->render(&painter);
+}
+
+void BenchScene::registryLookup_data()
+{
+    QTest::addColumn<bool>("registry");
+    QTest::newRow("registry") << true;
+    QTest::newRow("QMap") << false;
+}
+
+void BenchScene::registryLookup()
+{
+    QFETCH(bool, registry);
+    CyberiadaSMEditorItemRegistry& items = scene->getRegistry();
+    // the ID -> item map the registry replaced, with the linear reverse lookup
+    QMap<Cyberiada::ID, QGraphicsItem*> map;
+    QList<QGraphicsItem*> registered = items.items();
+    for (int i = 0; i < registered.size(); i++) {
+        map.insert(items.key(registered[i]), registered[i]);
+    }
+    QList<Cyberiada::ID> ids;
+    QList<QGraphicsItem*> looked_up;
+    for (int i = 0; i < BENCH_LOOKUPS_COUNT; i++) {
+        ids.append(states[i * (states.size() / BENCH_LOOKUPS_COUNT)]->get_id());
+        looked_up.append(items.value(ids.last()));
+    }
+    int found = 0;
+    QBENCHMARK {
+        found = 0;
+        for (int i = 0; i < ids.size(); i++) {
+            if (registry) {
+                if (items.value(ids[i]) && !items.key(looked_up[i]).empty()) found++;
+            } else {
+                if (map.value(ids[i]) && !map.key(looked_up[i]).empty()) found++;
+            }
+        }
+    }
+    QCOMPARE(found, BENCH_LOOKUPS_COUNT);
+}
+
+void BenchScene::selectItems()
+{
+    // every selection change finds the element of the selected item
+    QList<QGraphicsItem*> selected;
+    for (int i = 0; i < BENCH_SELECTED_COUNT; i++) {
+        selected.append(scene->getRegistry().value(states[i * (states.size() / BENCH_SELECTED_COUNT)]->get_id()));
+    }
+    QBENCHMARK {
+        for (int i = 0; i < selected.size(); i++) {
+            scene->clearSelection();
+            selected[i]->setSelected(true);
+        }
+    }
+    scene->clearSelection();
+}
+
+void BenchScene::paintView()
+{
+    // the transitions resolve their ends through the registry handles on every paint
+    resetView();
+    QImage image(view->viewport()->size(), QImage::Format_ARGB32_Premultiplied);
+    QBENCHMARK {
+        renderView(image);
+    }
+}
+
+void BenchScene::firstFrame_data()
+{
+    QTest::addColumn<bool>("full");
+    QTest::newRow("first frame") << false;
+    QTest::newRow("full build") << true;
+}
+
+void BenchScene::firstFrame()
+{
+    QFETCH(bool, full);
+    QImage image(view->viewport()->size(), QImage::Format_ARGB32_Premultiplied);
+    // the first frame shows the items built by the first slice, the rest are built by the timer
+    QBENCHMARK {
+        if (full) {
+            loadScene();
+        } else {
+            scene->loadScene();
+        }
+        renderView(image);
+    }
+    if (scene->isBuilding()) {
+        QSignalSpy finished(scene, &CyberiadaSMEditorScene::buildFinished);
+        QVERIFY(finished.wait(BENCH_WAIT_MSEC));
+    }
+}
+
+void BenchScene::paintLevelOfDetail_data()
+{
+    QTest::addColumn<qreal>("scale");
+    QTest::newRow("outline") << qreal(LOD_OUTLINE_SCALE / 2);
+    QTest::newRow("titles") << qreal((LOD_OUTLINE_SCALE + LOD_TITLES_SCALE) / 2);
+    QTest::newRow("full") << qreal(1.0);
+}
+
+void BenchScene::paintLevelOfDetail()
+{
+    QFETCH(qreal, scale);
+    // the same items are painted at every scale, the tier is chosen by the painter transform
+    QRectF source(0, 0, BENCH_PAINT_SIDE * BENCH_STATE_STEP_X, BENCH_PAINT_SIDE * BENCH_STATE_STEP_Y);
+    QRectF target(0, 0, source.width() * scale, source.height() * scale);
+    QImage image(target.size().toSize(), QImage::Format_ARGB32_Premultiplied);
+    QBENCHMARK {
+        QPainter painter(&image);
+        scene->render(&painter, target, source);
+    }
+}
+
+void BenchScene::gridPan_data()
+{
+    QTest::addColumn<bool>("grid");
+    QTest::newRow("grid on") << true;
+    QTest::newRow("grid off") << false;
+}
+
+void BenchScene::gridPan()
+{
+    QFETCH(bool, grid);
+    SettingsManager& settings = SettingsManager::instance();
+    bool show_grid = settings.getShowGrid();
+    settings.setShowGrid(grid);
+    resetView();
+    QScrollBar* scroll = view->horizontalScrollBar();
+    int start = scroll->value();
+    QImage image(view->viewport()->size(), QImage::Format_ARGB32_Premultiplied);
+    // the result is the time of BENCH_PAN_FRAMES frames
+    QBENCHMARK {
+        for (int i = 0; i < BENCH_PAN_FRAMES; i++) {
+            scroll->setValue(start + i * BENCH_PAN_STEP);
+            renderView(image);
+        }
+    }
+    settings.setShowGrid(show_grid);
+}
+
+void BenchScene::smBounds_data()
+{
+    QTest::addColumn<int>("mode");
+    QTest::newRow("cached") << 0;
+    QTest::newRow("uncached") << 1;
+    QTest::newRow("after child move") << 2;
+}
+
+void BenchScene::smBounds()
+{
+    QFETCH(int, mode);
+    // every level has the siblings next to the composite state of the next level
+    Cyberiada::LocalDocument* doc = new Cyberiada::LocalDocument();
+    Cyberiada::StateMachine* deep_sm = doc->new_state_machine("SM", Cyberiada::Rect(0, 0, 10000, 10000));
+    Cyberiada::ElementCollection* parent = deep_sm;
+    Cyberiada::State* deepest = NULL;
+    for (int level = 0; level < BENCH_NESTING_DEPTH; level++) {
+        for (int i = 0; i < BENCH_SIBLINGS_COUNT; i++) {
+            doc->new_state(parent, QString("State %1.%2").arg(level).arg(i).toStdString(), Cyberiada::Action(),
+                           Cyberiada::Rect(i * 10, 0, 5, 5), Cyberiada::Rect(), Cyberiada::Color());
+        }
+        deepest = doc->new_state(parent, QString("Level %1").arg(level).toStdString(), Cyberiada::Action(),
+                                 Cyberiada::Rect(10, 10, 5000 - level * 400, 5000 - level * 400),
+                                 Cyberiada::Rect(), Cyberiada::Color());
+        parent = deepest;
+    }
+    CyberiadaSMModel deep_model(NULL);
+    deep_model.setDocument(doc);
+    CyberiadaSMEditorScene deep_scene(&deep_model);
+    QGraphicsView deep_view(&deep_scene);
+    QSignalSpy finished(&deep_scene, &CyberiadaSMEditorScene::buildFinished);
+    deep_scene.loadScene();
+    if (finished.isEmpty()) {
+        QVERIFY(finished.wait(BENCH_WAIT_MSEC));
+    }
+    CyberiadaSMEditorSMItem* sm_item = dynamic_cast<CyberiadaSMEditorSMItem*>(
+        deep_scene.getRegistry().value(deep_sm->get_id()));
+    QVERIFY(sm_item != NULL);
+    QModelIndex deepest_index = deep_model.elementToIndex(deepest);
+
+    // the uncached bounds are what the item computed on every call before
+    int step = 0;
+    QRectF bounds;
+    QBENCHMARK {
+        if (mode == 1) {
+            sm_item->invalidateBounds();
+        } else if (mode == 2) {
+            QVERIFY(deep_model.updateGeometry(deepest_index, Cyberiada::Rect(10 + step++ % 50, 10, 1400, 1400)));
+        }
+        bounds = sm_item->boundingRect();
+    }
+    QVERIFY(!bounds.isEmpty());
+}
+
+void BenchScene::dragTarget_data()
+{
+    QTest::addColumn<bool>("indexed");
+    QTest::newRow("spatial index") << true;
+    QTest::newRow("scene items") << false;
+}
+
+void BenchScene::dragTarget()
+{
+    QFETCH(bool, indexed);
+    QGraphicsItem* dragged = scene->getRegistry().value(states.first()->get_id());
+    QVERIFY(dragged != NULL);
+    QPointF start = dragged->pos();
+    QPointF offset = dragged->boundingRect().center();
+    int found = 0;
+    // every mouse move places the state and looks for the new parent under it
+    QBENCHMARK {
+        found = 0;
+        for (int i = 0; i < BENCH_DRAG_STEPS; i++) {
+            QPointF pos = start + QPointF(i * BENCH_STATE_STEP_X / 3, i * BENCH_STATE_STEP_Y / 3);
+            dragged->setPos(pos);
+            QPointF point = dragged->mapToScene(offset);
+            CyberiadaSMEditorAbstractItem* container = NULL;
+            if (indexed) {
+                container = scene->getSpatialIndex().containerAt(point, dragged);
+            } else {
+                // the items under the point the drag tested before the index
+                foreach(QGraphicsItem* item, scene->items(point)) {
+                    CyberiadaSMEditorAbstractItem* candidate = dynamic_cast<CyberiadaSMEditorAbstractItem*>(item);
+                    if (candidate && candidate != dragged &&
+                        (candidate->type() == CyberiadaSMEditorAbstractItem::SMItem ||
+                         candidate->type() == CyberiadaSMEditorAbstractItem::StateItem ||
+                         candidate->type() == CyberiadaSMEditorAbstractItem::CompositeStateItem)) {
+                        container = candidate;
+                        break;
+                    }
+                }
+            }
+            if (container) found++;
+        }
+    }
+    dragged->setPos(start);
+    QCOMPARE(found, BENCH_DRAG_STEPS);
+}
+
+void BenchScene::grabbers_data()
+{
+    QTest::addColumn<bool>("pooled");
+    QTest::newRow("scene pool") << true;
+    QTest::newRow("new and delete") << false;
+}
+
+void BenchScene::grabbers()
+{
+    QFETCH(bool, pooled);
+    QList<QGraphicsItem*> owners;
+    for (int i = 0; i < BENCH_GRABBER_OWNERS; i++) {
+        owners.append(scene->getRegistry().value(states[i]->get_id()));
+    }
+    // the grabbers of the selected items are shown and hidden again
+    QList<DotSignal*> dots;
+    QBENCHMARK {
+        for (int i = 0; i < owners.size(); i++) {
+            for (int j = 0; j < 8; j++) {
+                dots.append(pooled ? scene->acquireDot(owners[i]) : new DotSignal(owners[i]));
+            }
+        }
+        for (int i = 0; i < dots.size(); i++) {
+            if (pooled) {
+                scene->releaseDot(dots[i]);
+            } else {
+                delete dots[i];
+            }
+        }
+        dots.clear();
+    }
+    int in_scene = 0;
+    foreach(QGraphicsItem* item, scene->items()) {
+        if (dynamic_cast<DotSignal*>(item)) {
+            in_scene++;
+        }
+    }
+    // the built scene has no grabbers until the items are selected
+    qDebug() << "grabbers in the scene:" << in_scene << "of" << scene->items().size() << "items";
+}
+
+void BenchScene::addLabels(QGraphicsScene* label_scene, bool edited)
+{
+    for (int i = 0; i < BENCH_LABELS_SIDE * BENCH_LABELS_SIDE; i++) {
+        EditableTextItem* label = new EditableTextItem(QString("State %1").arg(i));
+        label->setPos((i % BENCH_LABELS_SIDE) * BENCH_STATE_STEP_X, (i / BENCH_LABELS_SIDE) * BENCH_STATE_STEP_Y);
+        label->setTextWidth(BENCH_STATE_WIDTH);
+        if (edited) {
+            label->document();
+        }
+        label_scene->addItem(label);
+    }
+}
+
+void BenchScene::labelCreate_data()
+{
+    QTest::addColumn<bool>("edited");
+    QTest::newRow("static label") << false;
+    QTest::newRow("text document") << true;
+}
+
+void BenchScene::labelCreate()
+{
+    QFETCH(bool, edited);
+    QBENCHMARK {
+        QGraphicsScene label_scene;
+        addLabels(&label_scene, edited);
+    }
+}
+
+void BenchScene::labelPaint_data()
+{
+    labelCreate_data();
+}
+
+void BenchScene::labelPaint()
+{
+    QFETCH(bool, edited);
+    QGraphicsScene label_scene;
+    addLabels(&label_scene, edited);
+    QRectF source(0, 0, BENCH_LABELS_SIDE * BENCH_STATE_STEP_X, BENCH_LABELS_SIDE * BENCH_STATE_STEP_Y);
+    QImage image(source.size().toSize(), QImage::Format_ARGB32_Premultiplied);
+    QBENCHMARK {
+        QPainter painter(&image);
+        label_scene.render(&painter, source, source);
+    }
+}
+
+QTEST_MAIN(BenchScene)
+#include "bench_scene.moc"
@@ -0,0 +1,47 @@
+/* -----------------------------------------------------------------------------
+ * The Cyberiada State Machine Editor
+ * -----------------------------------------------------------------------------
+ *
+ * The Stub Editor Item Used by the Tests
+ *
+ * Copyright (C) 2024 Alexey Fedoseev <aleksey@fedoseev.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see https://www.gnu.org/licenses/
+ *
+ * ----------------------------------------------------------------------------- */
+
+#ifndef CYBERIADA_SM_TEST_ITEM_HEADER
+#define CYBERIADA_SM_TEST_ITEM_HEADER
+
+#include "cyberiadasm_editor_items.h"
+
+// the rectangle item of the given editor type without the model element
+class TestItem: public CyberiadaSMEditorAbstractItem {
+public:
+    TestItem(int item_type, const QRectF& r, QGraphicsItem* parent = NULL):
+        CyberiadaSMEditorAbstractItem(NULL, NULL, parent), itemType(item_type), rect(r.size())
+    {
+        setPos(r.topLeft());
+    }
+
+    int type() const override { return itemType; }
+    QRectF boundingRect() const override { return rect; }
+    void paint(QPainter*, const QStyleOptionGraphicsItem*, QWidget*) override {}
+
+private:
+    int    itemType;
+    QRectF rect;
+};
+
+#endif
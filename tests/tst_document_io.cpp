@@ -0,0 +1,230 @@
+/* -----------------------------------------------------------------------------
+ * The Cyberiada State Machine Editor
+ * -----------------------------------------------------------------------------
+ *
+ * The Background Document Load / Save Test
+ *
+ * Copyright (C) 2024 Alexey Fedoseev <aleksey@fedoseev.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see https://www.gnu.org/licenses/
+ *
+ * ----------------------------------------------------------------------------- */
+
+#include <QtTest>
+#include <QTemporaryDir>
+
+#include "cyberiadasm_document_loader.h"
+#include "cyberiadasm_model.h"
+
+#define TEST_WAIT_MSEC 10000
+
+class TestDocumentIO: public QObject {
+Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+
+    void load();
+    void loadMissing();
+    void cancelLoad();
+    void destroyRunningLoader();
+    void save();
+    void saveSnapshot();
+    void saveQueued();
+    void saveFailed();
+
+private:
+    // the file is written synchronously by the library to be read by the loader
+    void writeDocument(const QString& path, const QString& state_name);
+    // returns the name of the state with the test id or the empty string
+    QString loadStateName(const QString& path);
+    // the model gets the document with one state that is saved by the tests
+    Cyberiada::State* initModel(CyberiadaSMModel& model);
+
+    QTemporaryDir*            dir;
+    Cyberiada::ID             stateID;
+};
+
+void TestDocumentIO::init()
+{
+    dir = new QTemporaryDir();
+    QVERIFY(dir->isValid());
+    stateID = Cyberiada::ID();
+}
+
+void TestDocumentIO::cleanup()
+{
+    delete dir;
+    dir = NULL;
+}
+
+void TestDocumentIO::writeDocument(const QString& path, const QString& state_name)
+{
+    Cyberiada::LocalDocument doc;
+    Cyberiada::StateMachine* sm = doc.new_state_machine("SM", Cyberiada::Rect(0, 0, 400, 300));
+    Cyberiada::State* state = doc.new_state(sm, state_name.toStdString(), Cyberiada::Action(),
+                                            Cyberiada::Rect(10, 10, 100, 50), Cyberiada::Rect(), Cyberiada::Color());
+    stateID = state->get_id();
+    doc.save_as(path.toStdString(), Cyberiada::formatCyberiada10);
+}
+
+QString TestDocumentIO::loadStateName(const QString& path)
+{
+    CyberiadaSMDocumentLoader loader(path);
+    loader.start();
+    if (!loader.wait(TEST_WAIT_MSEC) || loader.hasError()) {
+        return QString();
+    }
+    Cyberiada::LocalDocument* doc = loader.takeDocument();
+    if (!doc) {
+        return QString();
+    }
+    QString name;
+    const Cyberiada::Element* element = doc->find_element_by_id(stateID);
+    if (element) {
+        name = element->get_name().c_str();
+    }
+    delete doc;
+    return name;
+}
+
+Cyberiada::State* TestDocumentIO::initModel(CyberiadaSMModel& model)
+{
+    model.setDocument(new Cyberiada::LocalDocument());
+    Cyberiada::StateMachine* sm = model.newStateMachine("SM", Cyberiada::Rect(0, 0, 400, 300));
+    Cyberiada::State* state = model.newState(sm, "Saved", Cyberiada::Action(), Cyberiada::Rect(10, 10, 100, 50));
+    stateID = state->get_id();
+    return state;
+}
+
+void TestDocumentIO::load()
+{
+    QString path = dir->filePath("load.graphml");
+    writeDocument(path, "Loaded");
+    CyberiadaSMDocumentLoader loader(path);
+    loader.start();
+    QVERIFY(loader.wait(TEST_WAIT_MSEC));
+    QVERIFY(!loader.hasError());
+    QVERIFY(!loader.isCanceled());
+    Cyberiada::LocalDocument* doc = loader.takeDocument();
+    QVERIFY(doc != NULL);
+    // the document is handed over once
+    QVERIFY(loader.takeDocument() == NULL);
+    const Cyberiada::Element* element = doc->find_element_by_id(stateID);
+    QVERIFY(element != NULL);
+    QCOMPARE(QString(element->get_name().c_str()), QString("Loaded"));
+    delete doc;
+    QCOMPARE(loadStateName(path), QString("Loaded"));
+}
+
+void TestDocumentIO::loadMissing()
+{
+    CyberiadaSMDocumentLoader loader(dir->filePath("missing.graphml"));
+    loader.start();
+    QVERIFY(loader.wait(TEST_WAIT_MSEC));
+    QVERIFY(loader.hasError());
+    QVERIFY(loader.takeDocument() == NULL);
+}
+
+void TestDocumentIO::cancelLoad()
+{
+    QString path = dir->filePath("cancel.graphml");
+    writeDocument(path, "Canceled");
+    CyberiadaSMDocumentLoader loader(path);
+    loader.start();
+    loader.cancel();
+    QVERIFY(loader.wait(TEST_WAIT_MSEC));
+    // the parser is not interrupted, the owner drops the result of the canceled loader
+    QVERIFY(loader.isCanceled());
+    QVERIFY(!loader.hasError());
+}
+
+void TestDocumentIO::destroyRunningLoader()
+{
+    QString path = dir->filePath("destroy.graphml");
+    writeDocument(path, "Destroyed");
+    CyberiadaSMDocumentLoader* loader = new CyberiadaSMDocumentLoader(path);
+    loader->start();
+    // the destructor waits for the worker and deletes the document that was not taken
+    delete loader;
+}
+
+void TestDocumentIO::save()
+{
+    CyberiadaSMModel model(NULL);
+    initModel(model);
+    QString path = dir->filePath("save.graphml");
+    QSignalSpy started(&model, &CyberiadaSMModel::saveStarted);
+    QSignalSpy finished(&model, &CyberiadaSMModel::saveFinished);
+    model.saveAsDocument(path, Cyberiada::formatCyberiada10);
+    QCOMPARE(started.count(), 1);
+    QVERIFY(model.isSaving());
+    QVERIFY(finished.wait(TEST_WAIT_MSEC));
+    QVERIFY(!model.isSaving());
+    QCOMPARE(finished.first().first().toString(), path);
+    QCOMPARE(model.filePath(), path);
+    // the temporary file is renamed over the target
+    QVERIFY(!QFile::exists(dir->filePath(".save.graphml.tmp")));
+    QCOMPARE(loadStateName(path), QString("Saved"));
+}
+
+void TestDocumentIO::saveSnapshot()
+{
+    CyberiadaSMModel model(NULL);
+    Cyberiada::State* state = initModel(model);
+    QString path = dir->filePath("snapshot.graphml");
+    QSignalSpy finished(&model, &CyberiadaSMModel::saveFinished);
+    model.saveAsDocument(path, Cyberiada::formatCyberiada10);
+    // the edit waits for the copy, the file has the document as it was when the save started
+    QVERIFY(model.updateTitle(model.elementToIndex(state), "Edited"));
+    QVERIFY(finished.wait(TEST_WAIT_MSEC));
+    QCOMPARE(loadStateName(path), QString("Saved"));
+    QCOMPARE(QString(state->get_name().c_str()), QString("Edited"));
+}
+
+void TestDocumentIO::saveQueued()
+{
+    CyberiadaSMModel model(NULL);
+    Cyberiada::State* state = initModel(model);
+    QString path = dir->filePath("queued.graphml");
+    QSignalSpy finished(&model, &CyberiadaSMModel::saveFinished);
+    model.saveAsDocument(path, Cyberiada::formatCyberiada10);
+    QVERIFY(model.updateTitle(model.elementToIndex(state), "Queued"));
+    // the running save is not restarted, the request is saved after it
+    model.saveAsDocument(path, Cyberiada::formatCyberiada10);
+    while (finished.count() < 2) {
+        QVERIFY(finished.wait(TEST_WAIT_MSEC));
+    }
+    QCOMPARE(loadStateName(path), QString("Queued"));
+}
+
+void TestDocumentIO::saveFailed()
+{
+    CyberiadaSMModel model(NULL);
+    initModel(model);
+    QString path = dir->filePath("missing/failed.graphml");
+    QSignalSpy finished(&model, &CyberiadaSMModel::saveFinished);
+    QSignalSpy failed(&model, &CyberiadaSMModel::saveFailed);
+    model.saveAsDocument(path, Cyberiada::formatCyberiada10);
+    QVERIFY(failed.wait(TEST_WAIT_MSEC));
+    QCOMPARE(finished.count(), 0);
+    QCOMPARE(failed.first().first().toString(), path);
+    QVERIFY(!failed.first().at(1).toString().isEmpty());
+    // the document keeps its path
+    QVERIFY(!model.hasFilePath());
+}
+
+QTEST_MAIN(TestDocumentIO)
+#include "tst_document_io.moc"
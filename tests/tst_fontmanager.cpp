@@ -0,0 +1,95 @@
+/* -----------------------------------------------------------------------------
+ * The Cyberiada State Machine Editor
+ * -----------------------------------------------------------------------------
+ *
+ * The Font Manager Test
+ *
+ * Copyright (C) 2024 Alexey Fedoseev <aleksey@fedoseev.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see https://www.gnu.org/licenses/
+ *
+ * ----------------------------------------------------------------------------- */
+
+#include <QtTest>
+
+#include "fontmanager.h"
+
+class TestFontManager: public QObject {
+Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+
+    void sharedFonts();
+    void loadOnce();
+    void fontChanged();
+
+private:
+    QFont initialFont;
+};
+
+void TestFontManager::init()
+{
+    initialFont = FontManager::instance().getFont();
+}
+
+void TestFontManager::cleanup()
+{
+    FontManager::instance().setFont(initialFont);
+}
+
+void TestFontManager::sharedFonts()
+{
+    FontManager& fonts = FontManager::instance();
+    // the items get the references to the cached fonts and metrics
+    QVERIFY(&fonts.getFont(FontManager::BoldTextFont) == &fonts.getFont(FontManager::BoldTextFont));
+    QVERIFY(&fonts.getFontMetrics(FontManager::TextFont) == &fonts.getFontMetrics(FontManager::TextFont));
+    QVERIFY(fonts.getFont(FontManager::BoldTextFont).bold());
+    QCOMPARE(fonts.getFont(FontManager::TextFont), fonts.getFont());
+    QCOMPARE(fonts.getFontMetrics(FontManager::TextFont).height(),
+             QFontMetricsF(fonts.getFont(FontManager::TextFont)).height());
+}
+
+void TestFontManager::loadOnce()
+{
+    FontManager& fonts = FontManager::instance();
+    fonts.loadApplicationFonts();
+    QFont comment = fonts.getFont(FontManager::FormalCommentFont);
+    QVERIFY(!comment.family().isEmpty());
+    fonts.loadApplicationFonts();
+    QCOMPARE(fonts.getFont(FontManager::FormalCommentFont), comment);
+}
+
+void TestFontManager::fontChanged()
+{
+    FontManager& fonts = FontManager::instance();
+    QSignalSpy changed(&fonts, &FontManager::fontChanged);
+    QFont font = fonts.getFont();
+    fonts.setFont(font);
+    QCOMPARE(changed.count(), 0);
+
+    font.setPointSize(font.pointSize() + 4);
+    fonts.setFont(font);
+    QCOMPARE(changed.count(), 1);
+    // the cached fonts of the roles are rebuilt before the signal
+    QCOMPARE(fonts.getFont(FontManager::TextFont).pointSize(), font.pointSize());
+    QCOMPARE(fonts.getFont(FontManager::BoldTextFont).pointSize(), font.pointSize());
+    QVERIFY(fonts.getFont(FontManager::BoldTextFont).bold());
+    QCOMPARE(fonts.getFont(FontManager::FormalCommentFont).pointSize(), font.pointSize());
+    QCOMPARE(fonts.getFontMetrics(FontManager::TextFont).height(), QFontMetricsF(font).height());
+}
+
+QTEST_MAIN(TestFontManager)
+#include "tst_fontmanager.moc"
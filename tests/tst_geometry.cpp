@@ -0,0 +1,192 @@
+/* -----------------------------------------------------------------------------
+ * The Cyberiada State Machine Editor
+ * -----------------------------------------------------------------------------
+ *
+ * The Editor Geometry Test
+ *
+ * Copyright (C) 2024 Alexey Fedoseev <aleksey@fedoseev.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see https://www.gnu.org/licenses/
+ *
+ * ----------------------------------------------------------------------------- */
+
+#include <QtTest>
+#include <QtMath>
+#include <QGraphicsScene>
+
+#include "cyberiadasm_editor_geometry.h"
+#include "test_item.h"
+
+static bool fuzzyCompare(const QPointF& a, const QPointF& b)
+{
+    return qAbs(a.x() - b.x()) < 1e-6 && qAbs(a.y() - b.y()) < 1e-6;
+}
+
+class TestGeometry: public QObject {
+Q_OBJECT
+
+private slots:
+    void roundedRect_data();
+    void roundedRect();
+    void circle_data();
+    void circle();
+    void polygon_data();
+    void polygon();
+    void path();
+    void itemIntersection();
+};
+
+void TestGeometry::roundedRect_data()
+{
+    QTest::addColumn<QRectF>("rect");
+    QTest::addColumn<qreal>("radius");
+    QTest::addColumn<QPointF>("start");
+    QTest::addColumn<QPointF>("dir");
+    QTest::addColumn<bool>("found");
+    QTest::addColumn<QPointF>("expected");
+
+    QTest::newRow("inside") << QRectF(0, 0, 100, 50) << qreal(0)
+                            << QPointF(70, 25) << QPointF(1, 0) << true << QPointF(100, 25);
+    QTest::newRow("outside") << QRectF(0, 0, 100, 50) << qreal(0)
+                             << QPointF(200, 25) << QPointF(-1, 0) << true << QPointF(100, 25);
+    QTest::newRow("backwards") << QRectF(0, 0, 100, 50) << qreal(0)
+                               << QPointF(200, 25) << QPointF(1, 0) << true << QPointF(100, 25);
+    QTest::newRow("side") << QRectF(0, 0, 100, 100) << qreal(20)
+                          << QPointF(50, 60) << QPointF(0, 1) << true << QPointF(50, 100);
+    qreal d = 20 - 20 / qSqrt(2);
+    QTest::newRow("corner") << QRectF(0, 0, 100, 100) << qreal(20)
+                            << QPointF(-50, -50) << QPointF(1, 1) << true << QPointF(d, d);
+    QTest::newRow("miss") << QRectF(0, 0, 100, 50) << qreal(10)
+                          << QPointF(200, 200) << QPointF(1, 0) << false << QPointF();
+}
+
+void TestGeometry::roundedRect()
+{
+    QFETCH(QRectF, rect);
+    QFETCH(qreal, radius);
+    QFETCH(QPointF, start);
+    QFETCH(QPointF, dir);
+    QFETCH(bool, found);
+    QFETCH(QPointF, expected);
+
+    QPointF point;
+    QCOMPARE(CyberiadaSMEditorGeometry::lineRoundedRect(start, dir, rect, radius, &point), found);
+    if (found) {
+        QVERIFY2(fuzzyCompare(point, expected),
+                 qPrintable(QString("(%1, %2)").arg(point.x()).arg(point.y())));
+    }
+}
+
+void TestGeometry::circle_data()
+{
+    QTest::addColumn<QPointF>("start");
+    QTest::addColumn<QPointF>("dir");
+    QTest::addColumn<bool>("found");
+    QTest::addColumn<QPointF>("expected");
+
+    QTest::newRow("outside") << QPointF(-30, 0) << QPointF(1, 0) << true << QPointF(-10, 0);
+    QTest::newRow("inside") << QPointF(0, 5) << QPointF(0, 1) << true << QPointF(0, 10);
+    QTest::newRow("tangent") << QPointF(-30, 10) << QPointF(1, 0) << true << QPointF(0, 10);
+    QTest::newRow("miss") << QPointF(0, 20) << QPointF(1, 0) << false << QPointF();
+}
+
+void TestGeometry::circle()
+{
+    QFETCH(QPointF, start);
+    QFETCH(QPointF, dir);
+    QFETCH(bool, found);
+    QFETCH(QPointF, expected);
+
+    QPointF point;
+    QCOMPARE(CyberiadaSMEditorGeometry::lineCircle(start, dir, QPointF(0, 0), 10, &point), found);
+    if (found) {
+        QVERIFY2(fuzzyCompare(point, expected),
+                 qPrintable(QString("(%1, %2)").arg(point.x()).arg(point.y())));
+    }
+}
+
+void TestGeometry::polygon_data()
+{
+    QTest::addColumn<QPointF>("start");
+    QTest::addColumn<QPointF>("dir");
+    QTest::addColumn<bool>("found");
+    QTest::addColumn<QPointF>("expected");
+
+    QTest::newRow("edge") << QPointF(30, 10) << QPointF(0, 1) << true << QPointF(30, 0);
+    QTest::newRow("hypotenuse") << QPointF(30, 60) << QPointF(0, 1) << true << QPointF(30, 70);
+    QTest::newRow("parallel") << QPointF(-10, 200) << QPointF(1, 0) << false << QPointF();
+}
+
+void TestGeometry::polygon()
+{
+    QFETCH(QPointF, start);
+    QFETCH(QPointF, dir);
+    QFETCH(bool, found);
+    QFETCH(QPointF, expected);
+
+    const QPointF triangle[] = { QPointF(0, 0), QPointF(100, 0), QPointF(0, 100) };
+    QPointF point;
+    QCOMPARE(CyberiadaSMEditorGeometry::linePolygon(start, dir, triangle, 3, &point), found);
+    if (found) {
+        QVERIFY2(fuzzyCompare(point, expected),
+                 qPrintable(QString("(%1, %2)").arg(point.x()).arg(point.y())));
+    }
+}
+
+void TestGeometry::path()
+{
+    QPainterPath rect_path;
+    rect_path.addRect(QRectF(0, 0, 100, 50));
+    QPointF point;
+    QVERIFY(CyberiadaSMEditorGeometry::linePath(QPointF(50, 40), QPointF(0, 1), rect_path, &point));
+    QVERIFY(fuzzyCompare(point, QPointF(50, 50)));
+
+    QPainterPath ellipse_path;
+    ellipse_path.addEllipse(QPointF(0, 0), 40, 20);
+    QVERIFY(CyberiadaSMEditorGeometry::linePath(QPointF(-100, 0), QPointF(1, 0), ellipse_path, &point));
+    // the ellipse is flattened
+    QVERIFY(qAbs(point.x() + 40) < 0.5 && qAbs(point.y()) < 0.5);
+    QVERIFY(!CyberiadaSMEditorGeometry::linePath(QPointF(-100, 30), QPointF(1, 0), ellipse_path, &point));
+}
+
+void TestGeometry::itemIntersection()
+{
+    QGraphicsScene scene;
+    TestItem* state = new TestItem(CyberiadaSMEditorAbstractItem::StateItem, QRectF(100, 100, 200, 100));
+    TestItem* vertex = new TestItem(CyberiadaSMEditorAbstractItem::VertexItem, QRectF(500, 100, 20, 20));
+    scene.addItem(state);
+    scene.addItem(vertex);
+
+    bool found = false;
+    QPointF point = CyberiadaSMEditorGeometry::itemIntersection(state, QPointF(250, 150), QPointF(600, 150), &found);
+    QVERIFY(found);
+    QVERIFY(fuzzyCompare(point, QPointF(300, 150)));
+
+    // the transitions are attached to the centers of the vertices
+    point = CyberiadaSMEditorGeometry::itemIntersection(vertex, QPointF(510, 110), QPointF(200, 150), &found);
+    QVERIFY(found);
+    QVERIFY(fuzzyCompare(point, QPointF(510, 110)));
+
+    // the start far from the item is not an end of the transition
+    point = CyberiadaSMEditorGeometry::itemIntersection(state, QPointF(1000, 1000), QPointF(200, 150), &found);
+    QVERIFY(!found);
+
+    // the transition of zero length has no direction
+    found = true;
+    point = CyberiadaSMEditorGeometry::itemIntersection(state, QPointF(250, 150), QPointF(250, 150), &found);
+    QVERIFY(!found);
+}
+
+QTEST_MAIN(TestGeometry)
+#include "tst_geometry.moc"
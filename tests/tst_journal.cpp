@@ -0,0 +1,198 @@
+/* -----------------------------------------------------------------------------
+ * The Cyberiada State Machine Editor
+ * -----------------------------------------------------------------------------
+ *
+ * The Model Edit Journal Test
+ *
+ * Copyright (C) 2024 Alexey Fedoseev <aleksey@fedoseev.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see https://www.gnu.org/licenses/
+ *
+ * ----------------------------------------------------------------------------- */
+
+#include <QtTest>
+#include <QTemporaryDir>
+
+#include "cyberiadasm_journal.h"
+#include "cyberiadasm_model.h"
+
+class TestJournal: public QObject {
+Q_OBJECT
+
+private slots:
+    void init();
+
+    void roundTrip();
+    void damagedRecord();
+    void truncatedTail();
+    void failedCheckpoint();
+    void finishedCheckpoint();
+    void replay();
+
+private:
+    QList<QByteArray> sampleRecords() const;
+
+    QTemporaryDir     dir;
+    QString           docPath;
+};
+
+void TestJournal::init()
+{
+    QVERIFY(dir.isValid());
+    docPath = dir.filePath("document.graphml");
+    CyberiadaSMJournal(docPath).discard();
+}
+
+QList<QByteArray> TestJournal::sampleRecords() const
+{
+    QList<QByteArray> records;
+    records.append(CyberiadaSMJournal::encode(CyberiadaSMJournal::recordTitle, Cyberiada::ID("s1"), Cyberiada::Name("First")));
+    records.append(CyberiadaSMJournal::encode(CyberiadaSMJournal::recordPoint, Cyberiada::ID("s2"), Cyberiada::Point(10, 20)));
+    records.append(CyberiadaSMJournal::encode(CyberiadaSMJournal::recordDelete, Cyberiada::ID("s3")));
+    return records;
+}
+
+void TestJournal::roundTrip()
+{
+    CyberiadaSMJournal journal(docPath);
+    QVERIFY(!journal.hasRecovery());
+    QList<QByteArray> records = sampleRecords();
+    foreach (const QByteArray& record, records) {
+        journal.append(record);
+    }
+    journal.flush();
+    QVERIFY(journal.hasRecovery());
+    QCOMPARE(journal.recoveryBase(), docPath);
+    QCOMPARE(journal.recoveryRecords(), records);
+}
+
+void TestJournal::damagedRecord()
+{
+    QList<QByteArray> records = sampleRecords();
+    {
+        CyberiadaSMJournal journal(docPath);
+        foreach (const QByteArray& record, records) {
+            journal.append(record);
+        }
+    }
+    // the last byte of the file belongs to the payload of the last record
+    QFile file(docPath + ".journal");
+    QVERIFY(file.open(QIODevice::ReadWrite));
+    QVERIFY(file.seek(file.size() - 1));
+    char c = 0;
+    QVERIFY(file.getChar(&c));
+    QVERIFY(file.seek(file.size() - 1));
+    QVERIFY(file.putChar(char(c ^ 0x5a)));
+    file.close();
+
+    CyberiadaSMJournal journal(docPath);
+    records.removeLast();
+    QCOMPARE(journal.recoveryRecords(), records);
+}
+
+void TestJournal::truncatedTail()
+{
+    QList<QByteArray> records = sampleRecords();
+    {
+        CyberiadaSMJournal journal(docPath);
+        foreach (const QByteArray& record, records) {
+            journal.append(record);
+        }
+    }
+    QFile file(docPath + ".journal");
+    QVERIFY(file.resize(file.size() - 2));
+
+    CyberiadaSMJournal journal(docPath);
+    records.removeLast();
+    QCOMPARE(journal.recoveryRecords(), records);
+    // resume drops the tail, the next records follow the valid ones
+    journal.resume();
+    QByteArray extra = CyberiadaSMJournal::encode(CyberiadaSMJournal::recordDelete, Cyberiada::ID("s4"));
+    journal.append(extra);
+    journal.flush();
+    records.append(extra);
+    QCOMPARE(journal.recoveryRecords(), records);
+}
+
+void TestJournal::failedCheckpoint()
+{
+    QList<QByteArray> records = sampleRecords();
+    CyberiadaSMJournal journal(docPath);
+    journal.append(records[0]);
+    QCOMPARE(journal.beginCheckpoint(CyberiadaSMJournal::baseSnapshot), journal.snapshotPath());
+    journal.append(records[1]);
+    journal.flush();
+    // the records made after the rotation go after the old ones
+    QCOMPARE(journal.recoveryRecords(), records.mid(0, 2));
+    journal.endCheckpoint(false);
+    QVERIFY(!QFile::exists(docPath + ".journal.prev"));
+    QCOMPARE(journal.recoveryRecords(), records.mid(0, 2));
+    QCOMPARE(journal.recoveryBase(), docPath);
+}
+
+void TestJournal::finishedCheckpoint()
+{
+    QList<QByteArray> records = sampleRecords();
+    CyberiadaSMJournal journal(docPath);
+    journal.append(records[0]);
+    QString base = journal.beginCheckpoint(CyberiadaSMJournal::baseSnapshot);
+    QFile snapshot(base);
+    QVERIFY(snapshot.open(QIODevice::WriteOnly));
+    snapshot.close();
+    journal.endCheckpoint(true);
+    journal.append(records[1]);
+    journal.flush();
+    QCOMPARE(journal.recoveryRecords(), records.mid(1, 1));
+    QCOMPARE(journal.recoveryBase(), journal.snapshotPath());
+}
+
+void TestJournal::replay()
+{
+    CyberiadaSMModel model(NULL);
+    model.setDocument(new Cyberiada::LocalDocument());
+    Cyberiada::StateMachine* sm = model.newStateMachine("SM", Cyberiada::Rect(0, 0, 400, 300));
+
+    QList<QByteArray> records;
+    records.append(CyberiadaSMJournal::encode(CyberiadaSMJournal::recordNewState, sm->get_id(), Cyberiada::ID("replayed"),
+                                              Cyberiada::Name("State"), Cyberiada::Action(),
+                                              Cyberiada::Rect(10, 10, 100, 50), Cyberiada::Rect(), Cyberiada::Color()));
+    records.append(CyberiadaSMJournal::encode(CyberiadaSMJournal::recordTitle, Cyberiada::ID("replayed"),
+                                              Cyberiada::Name("Renamed")));
+    records.append(CyberiadaSMJournal::encode(CyberiadaSMJournal::recordRect, Cyberiada::ID("replayed"),
+                                              Cyberiada::Rect(20, 30, 120, 60)));
+    {
+        CyberiadaSMJournal journal(docPath);
+        foreach (const QByteArray& record, records) {
+            journal.append(record);
+        }
+    }
+    QList<QByteArray> recovered = CyberiadaSMJournal(docPath).recoveryRecords();
+    QCOMPARE(recovered, records);
+
+    // the records are idempotent: the second replay changes nothing
+    for (int pass = 0; pass < 2; pass++) {
+        model.applyDelta(recovered);
+        QCOMPARE(int(sm->children_count()), 1);
+        const Cyberiada::Element* element = model.idToElement("replayed");
+        QVERIFY(element != NULL);
+        QVERIFY(element->get_parent() == sm);
+        QCOMPARE(QString(element->get_name().c_str()), QString("Renamed"));
+        Cyberiada::Rect r = static_cast<const Cyberiada::State*>(element)->get_geometry_rect();
+        QCOMPARE(double(r.x), 20.0);
+        QCOMPARE(double(r.width), 120.0);
+    }
+}
+
+QTEST_MAIN(TestJournal)
+#include "tst_journal.moc"
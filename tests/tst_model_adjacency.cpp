@@ -0,0 +1,154 @@
+/* -----------------------------------------------------------------------------
+ * The Cyberiada State Machine Editor
+ * -----------------------------------------------------------------------------
+ *
+ * The Model Adjacency Index Test
+ *
+ * Copyright (C) 2024 Alexey Fedoseev <aleksey@fedoseev.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see https://www.gnu.org/licenses/
+ *
+ * ----------------------------------------------------------------------------- */
+
+#include <QtTest>
+
+#include "cyberiadasm_model.h"
+#include "cyberiadasm_undo.h"
+
+class TestModelAdjacency: public QObject {
+Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+
+    void vertexTransitions();
+    void incidentTransitions();
+    void retarget();
+    void deleteSubtree();
+    void undoDeleteSubtree();
+
+private:
+    QString id(const Cyberiada::Element* element) const { return QString(element->get_id().c_str()); }
+
+    CyberiadaSMModel*         model;
+    Cyberiada::StateMachine*  sm;
+    Cyberiada::State*         parent;
+    Cyberiada::State*         first;
+    Cyberiada::State*         second;
+    Cyberiada::State*         outside;
+    Cyberiada::Transition*    inner;       // first -> second
+    Cyberiada::Transition*    incoming;    // outside -> first
+    Cyberiada::Transition*    outgoing;    // parent -> outside
+};
+
+void TestModelAdjacency::init()
+{
+    model = new CyberiadaSMModel(NULL);
+    model->setDocument(new Cyberiada::LocalDocument());
+    sm = model->newStateMachine("SM", Cyberiada::Rect(0, 0, 600, 300));
+    parent = model->newState(sm, "Parent", Cyberiada::Action(), Cyberiada::Rect(10, 10, 300, 200));
+    first = model->newState(parent, "First", Cyberiada::Action(), Cyberiada::Rect(10, 10, 100, 50));
+    second = model->newState(parent, "Second", Cyberiada::Action(), Cyberiada::Rect(150, 10, 100, 50));
+    outside = model->newState(sm, "Outside", Cyberiada::Action(), Cyberiada::Rect(400, 10, 100, 50));
+    inner = model->newTransition(sm, Cyberiada::transitionExternal, first, second, Cyberiada::Action());
+    incoming = model->newTransition(sm, Cyberiada::transitionExternal, outside, first, Cyberiada::Action());
+    outgoing = model->newTransition(sm, Cyberiada::transitionExternal, parent, outside, Cyberiada::Action());
+    model->undoStack()->reset();
+}
+
+void TestModelAdjacency::cleanup()
+{
+    delete model;
+    model = NULL;
+}
+
+void TestModelAdjacency::vertexTransitions()
+{
+    QList<Cyberiada::Element*> transitions = model->vertexTransitions(first);
+    QCOMPARE(transitions.size(), 2);
+    QVERIFY(transitions.contains(inner));
+    QVERIFY(transitions.contains(incoming));
+    transitions = model->vertexTransitions(outside);
+    QCOMPARE(transitions.size(), 2);
+    QVERIFY(transitions.contains(incoming));
+    QVERIFY(transitions.contains(outgoing));
+    QVERIFY(model->vertexTransitions(sm).isEmpty());
+}
+
+void TestModelAdjacency::incidentTransitions()
+{
+    // every transition of the subtree is listed once
+    QList<Cyberiada::Element*> transitions = model->incidentTransitions(parent);
+    QCOMPARE(transitions.size(), 3);
+    QVERIFY(transitions.contains(inner));
+    QVERIFY(transitions.contains(incoming));
+    QVERIFY(transitions.contains(outgoing));
+    transitions = model->incidentTransitions(second);
+    QCOMPARE(transitions.size(), 1);
+    QVERIFY(transitions.contains(inner));
+}
+
+void TestModelAdjacency::retarget()
+{
+    QVERIFY(model->updateGeometry(model->elementToIndex(incoming), outside->get_id(), second->get_id()));
+    QList<Cyberiada::Element*> transitions = model->vertexTransitions(first);
+    QCOMPARE(transitions.size(), 1);
+    QVERIFY(transitions.contains(inner));
+    transitions = model->vertexTransitions(second);
+    QCOMPARE(transitions.size(), 2);
+    QVERIFY(transitions.contains(incoming));
+    model->undoStack()->undo();
+    QVERIFY(model->vertexTransitions(first).contains(incoming));
+    QVERIFY(!model->vertexTransitions(second).contains(incoming));
+}
+
+void TestModelAdjacency::deleteSubtree()
+{
+    QStringList deleted;
+    deleted << id(parent) << id(first) << id(second) << id(inner) << id(incoming) << id(outgoing);
+    QList<Cyberiada::Element*> elements;
+    elements << parent << first;
+    QVERIFY(model->deleteElements(elements));
+    foreach(const QString& element_id, deleted) {
+        QVERIFY2(model->idToElement(element_id) == NULL, qPrintable(element_id));
+    }
+    QCOMPARE(model->idToElement(id(outside)), static_cast<Cyberiada::Element*>(outside));
+    QVERIFY(model->vertexTransitions(outside).isEmpty());
+    // the subtree with the connected transitions is one step of the history
+    QCOMPARE(model->undoStack()->count(), 1);
+}
+
+void TestModelAdjacency::undoDeleteSubtree()
+{
+    QString first_id = id(first), incoming_id = id(incoming), outgoing_id = id(outgoing), inner_id = id(inner);
+    QList<Cyberiada::Element*> elements;
+    elements << parent;
+    QVERIFY(model->deleteElements(elements));
+    model->undoStack()->undo();
+    // the restored elements are new objects with the same ids
+    Cyberiada::Element* restored_first = model->idToElement(first_id);
+    QVERIFY(restored_first != NULL);
+    QList<Cyberiada::Element*> transitions = model->vertexTransitions(restored_first);
+    QCOMPARE(transitions.size(), 2);
+    QVERIFY(transitions.contains(model->idToElement(inner_id)));
+    QVERIFY(transitions.contains(model->idToElement(incoming_id)));
+    transitions = model->vertexTransitions(outside);
+    QCOMPARE(transitions.size(), 2);
+    QVERIFY(transitions.contains(model->idToElement(incoming_id)));
+    QVERIFY(transitions.contains(model->idToElement(outgoing_id)));
+}
+
+QTEST_MAIN(TestModelAdjacency)
+#include "tst_model_adjacency.moc"
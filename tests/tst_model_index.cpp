@@ -0,0 +1,120 @@
+/* -----------------------------------------------------------------------------
+ * The Cyberiada State Machine Editor
+ * -----------------------------------------------------------------------------
+ *
+ * The Model ID Index Test
+ *
+ * Copyright (C) 2024 Alexey Fedoseev <aleksey@fedoseev.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see https://www.gnu.org/licenses/
+ *
+ * ----------------------------------------------------------------------------- */
+
+#include <QtTest>
+
+#include "cyberiadasm_model.h"
+
+class TestModelIndex: public QObject {
+Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+
+    void lookup();
+    void rename();
+    void renameConflict();
+    void deleteSubtree();
+    void undoDelete();
+
+private:
+    CyberiadaSMModel*         model;
+    Cyberiada::StateMachine*  sm;
+    Cyberiada::State*         parent;
+    Cyberiada::State*         child;
+    Cyberiada::State*         sibling;
+};
+
+void TestModelIndex::init()
+{
+    model = new CyberiadaSMModel(NULL);
+    model->setDocument(new Cyberiada::LocalDocument());
+    sm = model->newStateMachine("SM", Cyberiada::Rect(0, 0, 400, 300));
+    parent = model->newState(sm, "Parent", Cyberiada::Action(), Cyberiada::Rect(10, 10, 200, 100));
+    child = model->newState(parent, "Child", Cyberiada::Action(), Cyberiada::Rect(10, 10, 50, 30));
+    sibling = model->newState(sm, "Sibling", Cyberiada::Action(), Cyberiada::Rect(250, 10, 100, 50));
+}
+
+void TestModelIndex::cleanup()
+{
+    delete model;
+    model = NULL;
+}
+
+void TestModelIndex::lookup()
+{
+    QCOMPARE(model->idToElement(QString(sm->get_id().c_str())), static_cast<Cyberiada::Element*>(sm));
+    QCOMPARE(model->idToElement(QString(parent->get_id().c_str())), static_cast<Cyberiada::Element*>(parent));
+    QCOMPARE(model->idToElement(QString(child->get_id().c_str())), static_cast<Cyberiada::Element*>(child));
+    QCOMPARE(model->idToElement(QString(sibling->get_id().c_str())), static_cast<Cyberiada::Element*>(sibling));
+    QVERIFY(model->idToElement("missing") == NULL);
+}
+
+void TestModelIndex::rename()
+{
+    QString old_id(child->get_id().c_str());
+    QSignalSpy spy(model, &CyberiadaSMModel::elementIDChanged);
+    QVERIFY(model->updateID(model->elementToIndex(child), "renamed"));
+    QCOMPARE(model->idToElement("renamed"), static_cast<Cyberiada::Element*>(child));
+    QVERIFY(model->idToElement(old_id) == NULL);
+    QCOMPARE(spy.count(), 1);
+    QCOMPARE(spy.at(0).at(1).toString(), old_id);
+}
+
+void TestModelIndex::renameConflict()
+{
+    QString old_id(child->get_id().c_str());
+    QVERIFY(!model->updateID(model->elementToIndex(child), QString(sibling->get_id().c_str())));
+    QVERIFY(!model->updateID(model->elementToIndex(child), QString()));
+    QCOMPARE(model->idToElement(old_id), static_cast<Cyberiada::Element*>(child));
+    QCOMPARE(model->idToElement(QString(sibling->get_id().c_str())), static_cast<Cyberiada::Element*>(sibling));
+}
+
+void TestModelIndex::deleteSubtree()
+{
+    QString parent_id(parent->get_id().c_str());
+    QString child_id(child->get_id().c_str());
+    QVERIFY(model->deleteElement(model->elementToIndex(parent)));
+    QVERIFY(model->idToElement(parent_id) == NULL);
+    QVERIFY(model->idToElement(child_id) == NULL);
+    QCOMPARE(model->idToElement(QString(sibling->get_id().c_str())), static_cast<Cyberiada::Element*>(sibling));
+}
+
+void TestModelIndex::undoDelete()
+{
+    QString parent_id(parent->get_id().c_str());
+    QString child_id(child->get_id().c_str());
+    QVERIFY(model->deleteElement(model->elementToIndex(parent)));
+    model->undoStack()->undo();
+    // the restored elements are new objects with the same ids
+    const Cyberiada::Element* restored_parent = model->idToElement(parent_id);
+    const Cyberiada::Element* restored_child = model->idToElement(child_id);
+    QVERIFY(restored_parent != NULL);
+    QVERIFY(restored_child != NULL);
+    QVERIFY(restored_child->get_parent() == restored_parent);
+    QCOMPARE(QString(restored_child->get_name().c_str()), QString("Child"));
+}
+
+QTEST_MAIN(TestModelIndex)
+#include "tst_model_index.moc"
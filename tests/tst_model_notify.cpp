@@ -0,0 +1,194 @@
+/* -----------------------------------------------------------------------------
+ * The Cyberiada State Machine Editor
+ * -----------------------------------------------------------------------------
+ *
+ * The Model Notifications Test
+ *
+ * Copyright (C) 2024 Alexey Fedoseev <aleksey@fedoseev.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see https://www.gnu.org/licenses/
+ *
+ * ----------------------------------------------------------------------------- */
+
+#include <QtTest>
+
+#include "cyberiadasm_model.h"
+#include "cyberiadasm_undo.h"
+
+class TestModelNotify: public QObject {
+Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+
+    void coalesceTransaction();
+    void nestedTransaction();
+    void changeKinds();
+    void displayOfTransition();
+
+private:
+    // the elementChanged signals in the order of emission
+    struct Change {
+        const Cyberiada::Element*          element;
+        CyberiadaSMModel::ChangeKinds      kinds;
+    };
+
+    CyberiadaSMModel*         model;
+    Cyberiada::StateMachine*  sm;
+    Cyberiada::State*         source;
+    Cyberiada::State*         target;
+    Cyberiada::Transition*    transition;
+    QList<Change>             changes;
+};
+
+void TestModelNotify::init()
+{
+    model = new CyberiadaSMModel(NULL);
+    model->setDocument(new Cyberiada::LocalDocument());
+    sm = model->newStateMachine("SM", Cyberiada::Rect(0, 0, 400, 300));
+    source = model->newState(sm, "Source", Cyberiada::Action(), Cyberiada::Rect(10, 10, 100, 50));
+    target = model->newState(sm, "Target", Cyberiada::Action(), Cyberiada::Rect(200, 10, 100, 50));
+    transition = model->newTransition(sm, Cyberiada::transitionExternal, source, target, Cyberiada::Action());
+    model->undoStack()->reset();
+    changes.clear();
+    // the change kinds are not a registered metatype, so the signal is recorded by the lambda
+    connect(model, &CyberiadaSMModel::elementChanged,
+            [this](const QModelIndex& index, CyberiadaSMModel::ChangeKinds kinds) {
+                Change c;
+                c.element = model->indexToElement(index);
+                c.kinds = kinds;
+                changes.append(c);
+            });
+}
+
+void TestModelNotify::cleanup()
+{
+    delete model;
+    model = NULL;
+}
+
+void TestModelNotify::coalesceTransaction()
+{
+    QModelIndex source_index = model->elementToIndex(source);
+    QModelIndex target_index = model->elementToIndex(target);
+    model->beginTransaction();
+    QVERIFY(model->updateTitle(source_index, "S1"));
+    QVERIFY(model->updateGeometry(source_index, Cyberiada::Rect(20, 10, 100, 50)));
+    QVERIFY(model->updateTitle(target_index, "T1"));
+    QVERIFY(model->updateTitle(source_index, "S2"));
+    // the edits are applied at once, the notifications wait for the commit
+    QCOMPARE(QString(source->get_name().c_str()), QString("S2"));
+    QCOMPARE(changes.size(), 0);
+    model->commitTransaction();
+
+    // one signal per element in the order of the first edit with the merged kinds
+    QCOMPARE(changes.size(), 2);
+    QVERIFY(changes[0].element == source);
+    QCOMPARE(int(changes[0].kinds), int(CyberiadaSMModel::ChangeTitle | CyberiadaSMModel::ChangeGeometry));
+    QVERIFY(changes[1].element == target);
+    QCOMPARE(int(changes[1].kinds), int(CyberiadaSMModel::ChangeTitle));
+
+    // the transaction is one step of the history
+    QCOMPARE(model->undoStack()->count(), 1);
+    model->undoStack()->undo();
+    QCOMPARE(QString(source->get_name().c_str()), QString("Source"));
+    QCOMPARE(QString(target->get_name().c_str()), QString("Target"));
+    QCOMPARE(double(source->get_geometry_rect().x), 10.0);
+}
+
+void TestModelNotify::nestedTransaction()
+{
+    QModelIndex source_index = model->elementToIndex(source);
+    model->beginTransaction();
+    model->beginTransaction();
+    QVERIFY(model->updateTitle(source_index, "S1"));
+    model->commitTransaction();
+    // only the outermost commit emits the signals
+    QVERIFY(model->isInTransaction());
+    QCOMPARE(changes.size(), 0);
+    QVERIFY(model->updateGeometry(source_index, Cyberiada::Rect(20, 10, 100, 50)));
+    model->commitTransaction();
+    QVERIFY(!model->isInTransaction());
+    QCOMPARE(changes.size(), 1);
+    QCOMPARE(int(changes[0].kinds), int(CyberiadaSMModel::ChangeTitle | CyberiadaSMModel::ChangeGeometry));
+    QCOMPARE(model->undoStack()->count(), 1);
+}
+
+void TestModelNotify::changeKinds()
+{
+    QModelIndex source_index = model->elementToIndex(source);
+    QModelIndex transition_index = model->elementToIndex(transition);
+    QSignalSpy data_changed(model, SIGNAL(dataChanged(QModelIndex,QModelIndex,QVector<int>)));
+
+    // the tree is refreshed only for the edits of the shown text
+    QVERIFY(model->updateTitle(source_index, "S1"));
+    QCOMPARE(changes.size(), 1);
+    QCOMPARE(int(changes.last().kinds), int(CyberiadaSMModel::ChangeTitle));
+    QCOMPARE(data_changed.count(), 1);
+
+    QVERIFY(model->updateGeometry(source_index, Cyberiada::Rect(20, 10, 100, 50)));
+    QCOMPARE(changes.size(), 2);
+    QCOMPARE(int(changes.last().kinds), int(CyberiadaSMModel::ChangeGeometry));
+    QCOMPARE(data_changed.count(), 1);
+
+    QVERIFY(model->newAction(source_index, Cyberiada::actionEntry, "", "", "x = 1"));
+    QCOMPARE(changes.size(), 3);
+    QCOMPARE(int(changes.last().kinds), int(CyberiadaSMModel::ChangeActions));
+    QCOMPARE(data_changed.count(), 1);
+
+    QVERIFY(model->updateGeometry(transition_index, target->get_id(), source->get_id()));
+    QCOMPARE(changes.size(), 4);
+    QVERIFY(changes.last().element == transition);
+    QCOMPARE(int(changes.last().kinds), int(CyberiadaSMModel::ChangeEndpoints));
+    QCOMPARE(data_changed.count(), 2);
+
+    QVERIFY(model->updateID(source_index, "renamed"));
+    QCOMPARE(changes.size(), 5);
+    QCOMPARE(int(changes.last().kinds), int(CyberiadaSMModel::ChangeID));
+    QCOMPARE(data_changed.count(), 3);
+}
+
+void TestModelNotify::displayOfTransition()
+{
+    QModelIndex transition_index = model->elementToIndex(transition);
+    Cyberiada::State* other = model->newState(sm, "Other", Cyberiada::Action(), Cyberiada::Rect(10, 100, 100, 50));
+    QCOMPARE(model->data(transition_index, Qt::DisplayRole).toString(), QString("Source -> Target"));
+    QSignalSpy data_changed(model, SIGNAL(dataChanged(QModelIndex,QModelIndex,QVector<int>)));
+
+    // the renamed end drops the cached text of the transition and refreshes its row
+    QVERIFY(model->updateTitle(model->elementToIndex(source), "Renamed"));
+    QCOMPARE(data_changed.count(), 2);
+    QCOMPARE(data_changed.first().first().value<QModelIndex>(), transition_index);
+    QCOMPARE(model->data(transition_index, Qt::DisplayRole).toString(), QString("Renamed -> Target"));
+
+    // the state that is not connected to the transition leaves it as it is
+    data_changed.clear();
+    QVERIFY(model->updateTitle(model->elementToIndex(other), "Unrelated"));
+    QCOMPARE(data_changed.count(), 1);
+    QCOMPARE(data_changed.first().first().value<QModelIndex>(), model->elementToIndex(other));
+
+    // the old end does not refresh the transition after the ends are changed
+    QVERIFY(model->updateGeometry(transition_index, target->get_id(), other->get_id()));
+    QCOMPARE(model->data(transition_index, Qt::DisplayRole).toString(), QString("Target -> Unrelated"));
+    data_changed.clear();
+    QVERIFY(model->updateTitle(model->elementToIndex(source), "Source"));
+    QCOMPARE(data_changed.count(), 1);
+    QVERIFY(model->updateTitle(model->elementToIndex(other), "Other"));
+    QCOMPARE(data_changed.count(), 3);
+    QCOMPARE(model->data(transition_index, Qt::DisplayRole).toString(), QString("Target -> Other"));
+}
+
+QTEST_MAIN(TestModelNotify)
+#include "tst_model_notify.moc"
@@ -0,0 +1,204 @@
+/* -----------------------------------------------------------------------------
+ * The Cyberiada State Machine Editor
+ * -----------------------------------------------------------------------------
+ *
+ * The Model Row Cache Test
+ *
+ * Copyright (C) 2024 Alexey Fedoseev <aleksey@fedoseev.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see https://www.gnu.org/licenses/
+ *
+ * ----------------------------------------------------------------------------- */
+
+#include <QtTest>
+
+#include "cyberiadasm_model.h"
+
+#define TEST_STATES_COUNT 10
+
+class TestModelRows: public QObject {
+Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+
+    void rowsMatchDocument();
+    void rowsAfterDelete();
+    void rowsAfterMove();
+    void fetchInChunks();
+    void changesOfUnfetchedRows();
+    void editsOfUnfetchedRows();
+
+private:
+    // every row of the collection is the position of the element in the document
+    void verifyRows(const Cyberiada::ElementCollection* collection);
+    // the document is created aside the model like the loaded one, its rows are not fetched
+    Cyberiada::StateMachine* setLoadedDocument(QList<Cyberiada::State*>& loaded_states);
+
+    CyberiadaSMModel*              model;
+    Cyberiada::StateMachine*       sm;
+    QList<Cyberiada::State*>       states;
+};
+
+void TestModelRows::init()
+{
+    model = new CyberiadaSMModel(NULL);
+    model->setDocument(new Cyberiada::LocalDocument());
+    sm = model->newStateMachine("SM", Cyberiada::Rect(0, 0, 2000, 300));
+    states.clear();
+    for (int i = 0; i < TEST_STATES_COUNT; i++) {
+        states.append(model->newState(sm, QString("State %1").arg(i).toStdString(), Cyberiada::Action(),
+                                      Cyberiada::Rect(i * 150, 10, 100, 50)));
+    }
+}
+
+void TestModelRows::cleanup()
+{
+    delete model;
+    model = NULL;
+}
+
+void TestModelRows::verifyRows(const Cyberiada::ElementCollection* collection)
+{
+    const Cyberiada::ElementList& children = collection->get_children();
+    int row = 0;
+    for (Cyberiada::ElementList::const_iterator i = children.begin(); i != children.end(); i++, row++) {
+        QModelIndex index = model->elementToIndex(*i);
+        QCOMPARE(index.row(), row);
+        QVERIFY(model->indexToElement(index) == *i);
+        QCOMPARE(model->parent(index), model->elementToIndex(collection));
+    }
+}
+
+Cyberiada::StateMachine* TestModelRows::setLoadedDocument(QList<Cyberiada::State*>& loaded_states)
+{
+    Cyberiada::LocalDocument* doc = new Cyberiada::LocalDocument();
+    Cyberiada::StateMachine* loaded_sm = doc->new_state_machine("SM", Cyberiada::Rect(0, 0, 2000, 300));
+    for (int i = 0; i < TEST_STATES_COUNT; i++) {
+        loaded_states.append(doc->new_state(loaded_sm, QString("State %1").arg(i).toStdString(), Cyberiada::Action(),
+                                            Cyberiada::Rect(i * 150, 10, 100, 50), Cyberiada::Rect(), Cyberiada::Color()));
+    }
+    model->setDocument(doc);
+    return loaded_sm;
+}
+
+void TestModelRows::rowsMatchDocument()
+{
+    verifyRows(sm);
+    // the cached rows are returned by the second pass
+    verifyRows(sm);
+}
+
+void TestModelRows::rowsAfterDelete()
+{
+    verifyRows(sm);
+    QVERIFY(model->deleteElement(model->elementToIndex(states[3])));
+    states.removeAt(3);
+    verifyRows(sm);
+    QVERIFY(model->deleteElement(model->elementToIndex(states.first())));
+    states.removeFirst();
+    verifyRows(sm);
+}
+
+void TestModelRows::rowsAfterMove()
+{
+    verifyRows(sm);
+    Cyberiada::State* target = states.last();
+    QVERIFY(model->updateParent(model->elementToIndex(states[2]), target->get_id()));
+    verifyRows(sm);
+    verifyRows(target);
+}
+
+void TestModelRows::fetchInChunks()
+{
+    // the rows of the document set to the model are not fetched yet
+    QList<Cyberiada::State*> loaded_states;
+    Cyberiada::StateMachine* loaded_sm = setLoadedDocument(loaded_states);
+    model->setFetchChunkSize(4);
+
+    QModelIndex sm_index = model->elementToIndex(loaded_sm);
+    QCOMPARE(model->rowCount(sm_index), 0);
+    QVERIFY(model->hasChildren(sm_index));
+    QVERIFY(model->canFetchMore(sm_index));
+    model->fetchMore(sm_index);
+    QCOMPARE(model->rowCount(sm_index), 4);
+    // the selected element is exposed together with the rows before it
+    model->fetchUpTo(model->elementToIndex(loaded_states[6]));
+    QCOMPARE(model->rowCount(sm_index), 7);
+    model->fetchMore(sm_index);
+    QCOMPARE(model->rowCount(sm_index), TEST_STATES_COUNT);
+    QVERIFY(!model->canFetchMore(sm_index));
+    QVERIFY(model->index(TEST_STATES_COUNT - 1, 0, sm_index).internalPointer() == loaded_states.last());
+    verifyRows(loaded_sm);
+}
+
+void TestModelRows::changesOfUnfetchedRows()
+{
+    QList<Cyberiada::State*> loaded_states;
+    Cyberiada::StateMachine* loaded_sm = setLoadedDocument(loaded_states);
+    model->setFetchChunkSize(4);
+    QModelIndex sm_index = model->elementToIndex(loaded_sm);
+    model->fetchMore(sm_index);
+
+    int changed = 0;
+    connect(model, &CyberiadaSMModel::elementChanged, [&changed]() { changed++; });
+    QSignalSpy data_changed(model, SIGNAL(dataChanged(QModelIndex,QModelIndex,QVector<int>)));
+    // the views are told only about the rows within rowCount()
+    QVERIFY(model->updateTitle(model->elementToIndex(loaded_states[8]), "Hidden"));
+    QCOMPARE(changed, 1);
+    QCOMPARE(data_changed.count(), 0);
+    QVERIFY(model->updateTitle(model->elementToIndex(loaded_states[2]), "Shown"));
+    QCOMPARE(changed, 2);
+    QCOMPARE(data_changed.count(), 1);
+    QCOMPARE(data_changed.first().first().value<QModelIndex>().row(), 2);
+    // the row exposed later shows the new title
+    model->fetchUpTo(model->elementToIndex(loaded_states[8]));
+    QCOMPARE(model->data(model->index(8, 0, sm_index), Qt::DisplayRole).toString(), QString("Hidden"));
+}
+
+void TestModelRows::editsOfUnfetchedRows()
+{
+    QList<Cyberiada::State*> loaded_states;
+    Cyberiada::StateMachine* loaded_sm = setLoadedDocument(loaded_states);
+    model->setFetchChunkSize(4);
+    QModelIndex sm_index = model->elementToIndex(loaded_sm);
+    model->fetchMore(sm_index);
+
+    QSignalSpy inserted(model, SIGNAL(rowsInserted(QModelIndex,int,int)));
+    QSignalSpy removed(model, SIGNAL(rowsRemoved(QModelIndex,int,int)));
+    // the rows after the fetched ones are announced by fetchMore only
+    Cyberiada::State* added = model->newState(loaded_sm, "Added", Cyberiada::Action(),
+                                              Cyberiada::Rect(0, 100, 100, 50));
+    QVERIFY(added != NULL);
+    QCOMPARE(inserted.count(), 0);
+    QCOMPARE(model->rowCount(sm_index), 4);
+    QVERIFY(model->deleteElement(model->elementToIndex(loaded_states[7])));
+    QCOMPARE(removed.count(), 0);
+    QCOMPARE(model->rowCount(sm_index), 4);
+    // the fetched rows are removed as usual
+    QVERIFY(model->deleteElement(model->elementToIndex(loaded_states[1])));
+    QCOMPARE(removed.count(), 1);
+    QCOMPARE(model->rowCount(sm_index), 3);
+
+    while (model->canFetchMore(sm_index)) {
+        model->fetchMore(sm_index);
+    }
+    QCOMPARE(model->rowCount(sm_index), TEST_STATES_COUNT - 1);
+    QVERIFY(model->index(TEST_STATES_COUNT - 2, 0, sm_index).internalPointer() == added);
+    verifyRows(loaded_sm);
+}
+
+QTEST_MAIN(TestModelRows)
+#include "tst_model_rows.moc"
@@ -0,0 +1,317 @@
+/* -----------------------------------------------------------------------------
+ * The Cyberiada State Machine Editor
+ * -----------------------------------------------------------------------------
+ *
+ * The Editor Scene Test
+ *
+ * Copyright (C) 2024 Alexey Fedoseev <aleksey@fedoseev.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see https://www.gnu.org/licenses/
+ *
+ * ----------------------------------------------------------------------------- */
+
+#include <QtTest>
+#include <QGraphicsView>
+
+#include "cyberiadasm_model.h"
+#include "cyberiadasm_editor_scene.h"
+#include "cyberiadasm_editor_state_item.h"
+#include "cyberiadasm_editor_transition_item.h"
+#include "dotsignal.h"
+
+#define TEST_WAIT_MSEC 10000
+// more than the scene keeps in the pool
+#define TEST_DOTS_COUNT 100
+
+class TestScene: public QObject {
+Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+
+    void transitionPathCached();
+    void transitionFollowsMovedEnd();
+    void transitionFollowsNewEnd();
+    void transitionFollowsMovedParent();
+    void noDotsUntilShown();
+    void dotPoolReuse();
+    void dotPoolOverflow();
+    void pageSwitchKeepsItems();
+    void actionItemsReused();
+
+private:
+    int dotsCount(const QGraphicsItem* owner) const;
+    QList<StateAction*> actionItems(const QGraphicsItem* owner) const;
+    QGraphicsItem* item(const Cyberiada::Element* element) { return scene->getRegistry().value(element->get_id()); }
+    CyberiadaSMEditorTransitionItem* transitionItem()
+    {
+        return dynamic_cast<CyberiadaSMEditorTransitionItem*>(item(transition));
+    }
+
+    CyberiadaSMModel*         model;
+    CyberiadaSMEditorScene*   scene;
+    QGraphicsView*            view;
+    Cyberiada::StateMachine*  sm;
+    Cyberiada::State*         source;
+    Cyberiada::State*         target;
+    Cyberiada::State*         other;
+    Cyberiada::Transition*    transition;
+    Cyberiada::State*         composite;
+    Cyberiada::State*         child;
+    Cyberiada::Transition*    nested;      // child -> target
+    Cyberiada::StateMachine*  secondSM;
+};
+
+void TestScene::init()
+{
+    model = new CyberiadaSMModel(NULL);
+    model->setDocument(new Cyberiada::LocalDocument());
+    sm = model->newStateMachine("SM", Cyberiada::Rect(0, 0, 600, 400));
+    source = model->newState(sm, "Source", Cyberiada::Action(), Cyberiada::Rect(10, 10, 100, 50));
+    target = model->newState(sm, "Target", Cyberiada::Action(), Cyberiada::Rect(300, 10, 100, 50));
+    other = model->newState(sm, "Other", Cyberiada::Action(), Cyberiada::Rect(300, 300, 100, 50));
+    transition = model->newTransition(sm, Cyberiada::transitionExternal, source, target, Cyberiada::Action());
+    composite = model->newState(sm, "Composite", Cyberiada::Action(), Cyberiada::Rect(10, 150, 200, 120));
+    child = model->newState(composite, "Child", Cyberiada::Action(), Cyberiada::Rect(10, 30, 80, 40));
+    nested = model->newTransition(sm, Cyberiada::transitionExternal, child, target, Cyberiada::Action());
+    // the second page of the document
+    secondSM = model->newStateMachine("Second SM", Cyberiada::Rect(0, 0, 300, 200));
+    model->newState(secondSM, "Second", Cyberiada::Action(), Cyberiada::Rect(10, 10, 100, 50));
+
+    scene = new CyberiadaSMEditorScene(model);
+    view = new QGraphicsView(scene);
+    view->resize(800, 600);
+    QSignalSpy finished(scene, &CyberiadaSMEditorScene::buildFinished);
+    scene->loadScene();
+    // the small document is built by the first slice
+    if (finished.isEmpty()) {
+        QVERIFY(finished.wait(TEST_WAIT_MSEC));
+    }
+    QVERIFY(transitionItem() != NULL);
+}
+
+void TestScene::cleanup()
+{
+    delete view;
+    view = NULL;
+    delete scene;
+    scene = NULL;
+    delete model;
+    model = NULL;
+}
+
+void TestScene::transitionPathCached()
+{
+    CyberiadaSMEditorTransitionItem* trans = transitionItem();
+    QPainterPath path = trans->path();
+    QRectF bounds = trans->boundingRect();
+    // the moves of the unrelated items do not change the path
+    item(other)->moveBy(0, 20);
+    QApplication::processEvents();
+    QVERIFY(trans->path() == path);
+    QCOMPARE(trans->boundingRect(), bounds);
+    QVERIFY(trans->shape().contains(path.pointAtPercent(0.5)));
+}
+
+void TestScene::transitionFollowsMovedEnd()
+{
+    CyberiadaSMEditorTransitionItem* trans = transitionItem();
+    QRectF before = trans->sceneBoundingRect();
+    item(target)->moveBy(0, 200);
+    // the scene is told about the new rect at once, before the queued update of the label and the dots
+    QRectF after = trans->sceneBoundingRect();
+    QVERIFY(after.bottom() > before.bottom() + 100);
+    QRectF added(after.left(), before.bottom() + 1, after.width(), after.bottom() - before.bottom() - 1);
+    QVERIFY(scene->items(added, Qt::IntersectsItemBoundingRect).contains(trans));
+    QVERIFY(trans->path().boundingRect().bottom() > before.bottom());
+    QApplication::processEvents();
+    QCOMPARE(trans->sceneBoundingRect(), after);
+}
+
+void TestScene::transitionFollowsNewEnd()
+{
+    CyberiadaSMEditorTransitionItem* trans = transitionItem();
+    QRectF before = trans->sceneBoundingRect();
+    QVERIFY(model->updateGeometry(model->elementToIndex(transition), source->get_id(), other->get_id()));
+    QApplication::processEvents();
+    QRectF after = trans->sceneBoundingRect();
+    // the path is rebuilt for the new end
+    QVERIFY(after.bottom() > before.bottom() + 100);
+    QVERIFY(after.intersects(item(other)->sceneBoundingRect()));
+}
+
+void TestScene::transitionFollowsMovedParent()
+{
+    CyberiadaSMEditorTransitionItem* trans = dynamic_cast<CyberiadaSMEditorTransitionItem*>(item(nested));
+    QVERIFY(trans != NULL);
+    QRectF before = trans->sceneBoundingRect();
+    // the moves of one drag event are flushed to the nested items and the transitions together
+    for (int i = 0; i < 10; i++) {
+        item(composite)->moveBy(0, 10);
+    }
+    QApplication::processEvents();
+    QRectF after = trans->sceneBoundingRect();
+    QVERIFY(after.bottom() > before.bottom() + 50);
+    QVERIFY(after.intersects(item(child)->sceneBoundingRect()));
+    QVERIFY(trans->path().boundingRect().bottom() > before.bottom() + 50);
+}
+
+int TestScene::dotsCount(const QGraphicsItem* owner) const
+{
+    int count = 0;
+    foreach(QGraphicsItem* child, owner->childItems()) {
+        if (dynamic_cast<DotSignal*>(child)) {
+            count++;
+        }
+    }
+    return count;
+}
+
+void TestScene::noDotsUntilShown()
+{
+    QCOMPARE(dotsCount(item(source)), 0);
+    QCOMPARE(dotsCount(item(target)), 0);
+    QCOMPARE(dotsCount(item(transition)), 0);
+}
+
+void TestScene::dotPoolReuse()
+{
+    QGraphicsItem* owner = item(source);
+    DotSignal* dot = scene->acquireDot(owner, QPointF(5, 5));
+    QVERIFY(dot->parentItem() == owner);
+    QVERIFY(dot->scene() == scene);
+    QCOMPARE(dot->pos(), QPointF(5, 5));
+    scene->releaseDot(dot);
+    // the pooled dot is out of the scene index
+    QVERIFY(dot->scene() == NULL);
+    QVERIFY(dot->parentItem() == NULL);
+    QCOMPARE(dotsCount(owner), 0);
+
+    QGraphicsItem* another = item(target);
+    DotSignal* again = scene->acquireDot(another, QPointF(10, 10));
+    QVERIFY(again == dot);
+    QVERIFY(again->parentItem() == another);
+    QVERIFY(again->scene() == scene);
+    QVERIFY(again->isVisible());
+    QCOMPARE(again->pos(), QPointF(10, 10));
+    scene->releaseDot(again);
+}
+
+void TestScene::dotPoolOverflow()
+{
+    QGraphicsItem* owner = item(source);
+    QList<QPointer<DotSignal> > dots;
+    for (int i = 0; i < TEST_DOTS_COUNT; i++) {
+        dots.append(scene->acquireDot(owner));
+    }
+    QCOMPARE(dotsCount(owner), TEST_DOTS_COUNT);
+    for (int i = 0; i < dots.size(); i++) {
+        scene->releaseDot(dots[i]);
+        // the surplus dots are removed from the scene before they are deleted
+        QVERIFY(dots[i]->scene() == NULL);
+    }
+    QCOMPARE(dotsCount(owner), 0);
+    QCoreApplication::sendPostedEvents(NULL, QEvent::DeferredDelete);
+    int pooled = 0;
+    for (int i = 0; i < dots.size(); i++) {
+        if (dots[i]) {
+            pooled++;
+        }
+    }
+    QVERIFY(pooled > 0);
+    QVERIFY(pooled < TEST_DOTS_COUNT);
+    // the pooled dots are given out again
+    for (int i = 0; i < pooled; i++) {
+        DotSignal* dot = scene->acquireDot(owner);
+        QVERIFY(dots.contains(dot));
+    }
+}
+
+void TestScene::pageSwitchKeepsItems()
+{
+    QGraphicsItem* sm_item = item(sm);
+    QGraphicsItem* source_item = item(source);
+    view->scale(2, 2);
+    view->centerOn(item(target));
+    QTransform transform = view->transform();
+
+    QSignalSpy finished(scene, &CyberiadaSMEditorScene::buildFinished);
+    scene->activateStateMachine(secondSM);
+    if (finished.isEmpty()) {
+        QVERIFY(finished.wait(TEST_WAIT_MSEC));
+    }
+    QVERIFY(item(secondSM) != NULL);
+    QVERIFY(item(secondSM)->isVisible());
+    // the page left is hidden, not rebuilt
+    QVERIFY(item(sm) == sm_item);
+    QVERIFY(!sm_item->isVisible());
+    QVERIFY(!source_item->isVisible());
+    QVERIFY(!transitionItem()->isVisible());
+
+    finished.clear();
+    scene->activateStateMachine(sm);
+    if (finished.isEmpty()) {
+        QVERIFY(finished.wait(TEST_WAIT_MSEC));
+    }
+    QVERIFY(item(source) == source_item);
+    QVERIFY(sm_item->isVisible());
+    QVERIFY(source_item->isVisible());
+    QVERIFY(transitionItem()->isVisible());
+    QVERIFY(!item(secondSM)->isVisible());
+    // the page is shown with the zoom it was left with
+    QCOMPARE(view->transform(), transform);
+}
+
+QList<StateAction*> TestScene::actionItems(const QGraphicsItem* owner) const
+{
+    QList<StateAction*> actions;
+    foreach(QGraphicsItem* child, owner->childItems()) {
+        StateAction* action = dynamic_cast<StateAction*>(child);
+        if (action) {
+            actions.append(action);
+        }
+    }
+    return actions;
+}
+
+void TestScene::actionItemsReused()
+{
+    QModelIndex index = model->elementToIndex(source);
+    QVERIFY(model->newAction(index, Cyberiada::actionEntry, "", "", "x = 1"));
+    QList<StateAction*> actions = actionItems(item(source));
+    QCOMPARE(actions.size(), 1);
+    StateAction* entry = actions.first();
+
+    // the item of the existing action is kept when the next one is added
+    QVERIFY(model->newAction(index, Cyberiada::actionExit, "", "", "y = 2"));
+    actions = actionItems(item(source));
+    QCOMPARE(actions.size(), 2);
+    QVERIFY(actions.contains(entry));
+
+    QVERIFY(model->updateGeometry(index, Cyberiada::Rect(20, 20, 100, 50)));
+    QCOMPARE(actionItems(item(source)), actions);
+
+    QVERIFY(model->updateAction(index, 0, "", "", "x = 2"));
+    QCOMPARE(actionItems(item(source)), actions);
+    QCOMPARE(entry->getBehavior(), QString("x = 2"));
+
+    QVERIFY(model->deleteAction(index, 1));
+    actions = actionItems(item(source));
+    QCOMPARE(actions.size(), 1);
+    QVERIFY(actions.first() == entry);
+}
+
+QTEST_MAIN(TestScene)
+#include "tst_scene.moc"
@@ -0,0 +1,164 @@
+/* -----------------------------------------------------------------------------
+ * The Cyberiada State Machine Editor
+ * -----------------------------------------------------------------------------
+ *
+ * The Editor Spatial Index Test
+ *
+ * Copyright (C) 2024 Alexey Fedoseev <aleksey@fedoseev.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see https://www.gnu.org/licenses/
+ *
+ * ----------------------------------------------------------------------------- */
+
+#include <QtTest>
+#include <QGraphicsScene>
+
+#include "cyberiadasm_editor_spatial_index.h"
+#include "test_item.h"
+
+#define TEST_GRID_SIZE 20
+
+class TestSpatialIndex: public QObject {
+Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+
+    void innermostContainer();
+    void ignoredSubtree();
+    void connectableItems();
+    void movedItem();
+    void removedItem();
+    void hiddenItem();
+    void manyItems();
+
+private:
+    TestItem* addItem(int item_type, const QRectF& r, QGraphicsItem* parent = NULL);
+
+    QGraphicsScene*               scene;
+    CyberiadaSMEditorSpatialIndex* index;
+    TestItem*                     sm;
+    TestItem*                     outer;
+    TestItem*                     inner;
+};
+
+TestItem* TestSpatialIndex::addItem(int item_type, const QRectF& r, QGraphicsItem* parent)
+{
+    TestItem* item = new TestItem(item_type, r, parent);
+    if (!parent) {
+        scene->addItem(item);
+    }
+    index->insert(item);
+    return item;
+}
+
+void TestSpatialIndex::init()
+{
+    scene = new QGraphicsScene();
+    index = new CyberiadaSMEditorSpatialIndex();
+    sm = addItem(CyberiadaSMEditorAbstractItem::SMItem, QRectF(0, 0, 1000, 1000));
+    outer = addItem(CyberiadaSMEditorAbstractItem::CompositeStateItem, QRectF(100, 100, 400, 400), sm);
+    inner = addItem(CyberiadaSMEditorAbstractItem::StateItem, QRectF(50, 50, 100, 100), outer);
+}
+
+void TestSpatialIndex::cleanup()
+{
+    delete index;
+    index = NULL;
+    delete scene;
+    scene = NULL;
+}
+
+void TestSpatialIndex::innermostContainer()
+{
+    QVERIFY(index->containerAt(QPointF(200, 200)) == inner);
+    QVERIFY(index->containerAt(QPointF(400, 400)) == outer);
+    QVERIFY(index->containerAt(QPointF(800, 800)) == sm);
+    QVERIFY(index->containerAt(QPointF(-10, -10)) == NULL);
+}
+
+void TestSpatialIndex::ignoredSubtree()
+{
+    QVERIFY(index->containerAt(QPointF(200, 200), inner) == outer);
+    // the children of the ignored item are skipped too
+    QVERIFY(index->containerAt(QPointF(200, 200), outer) == sm);
+}
+
+void TestSpatialIndex::connectableItems()
+{
+    TestItem* vertex = addItem(CyberiadaSMEditorAbstractItem::VertexItem, QRectF(10, 10, 20, 20), inner);
+    // the vertex is not a container, the state machine is not connectable
+    QVERIFY(index->containerAt(QPointF(170, 170)) == inner);
+    QVERIFY(index->connectableAt(QPointF(170, 170)) == vertex);
+    QVERIFY(index->connectableAt(QPointF(200, 200)) == inner);
+    QVERIFY(index->connectableAt(QPointF(800, 800)) == NULL);
+}
+
+void TestSpatialIndex::movedItem()
+{
+    QVERIFY(index->containerAt(QPointF(200, 200)) == inner);
+    inner->setPos(250, 250);
+    index->markDirty(inner);
+    QVERIFY(index->containerAt(QPointF(200, 200)) == outer);
+    QVERIFY(index->containerAt(QPointF(400, 400)) == inner);
+}
+
+void TestSpatialIndex::removedItem()
+{
+    index->remove(inner);
+    QVERIFY(index->containerAt(QPointF(200, 200)) == outer);
+    index->remove(outer);
+    QVERIFY(index->containerAt(QPointF(200, 200)) == sm);
+}
+
+void TestSpatialIndex::hiddenItem()
+{
+    outer->setVisible(false);
+    QVERIFY(index->containerAt(QPointF(200, 200)) == sm);
+    outer->setVisible(true);
+    QVERIFY(index->containerAt(QPointF(200, 200)) == inner);
+}
+
+void TestSpatialIndex::manyItems()
+{
+    // enough states to split the nodes of the tree several times
+    QList<TestItem*> states;
+    for (int i = 0; i < TEST_GRID_SIZE; i++) {
+        for (int j = 0; j < TEST_GRID_SIZE; j++) {
+            states.append(addItem(CyberiadaSMEditorAbstractItem::StateItem,
+                                  QRectF(550 + i * 20, 550 + j * 20, 12, 12), sm));
+        }
+    }
+    // the moved items are indexed again by the next query
+    sm->setPos(-1000, 0);
+    for (int i = 0; i < states.size(); i++) {
+        index->markDirty(states[i]);
+    }
+    index->markDirty(sm);
+    index->markDirty(outer);
+    index->markDirty(inner);
+    for (int i = 0; i < TEST_GRID_SIZE; i++) {
+        for (int j = 0; j < TEST_GRID_SIZE; j++) {
+            TestItem* expected = states[i * TEST_GRID_SIZE + j];
+            QVERIFY(index->containerAt(expected->sceneBoundingRect().center()) == expected);
+            // the gaps between the states belong to the state machine
+            QVERIFY(index->containerAt(expected->sceneBoundingRect().bottomRight() + QPointF(4, 4)) == sm);
+        }
+    }
+    QVERIFY(index->containerAt(QPointF(-800, 200)) == inner);
+}
+
+QTEST_MAIN(TestSpatialIndex)
+#include "tst_spatial_index.moc"
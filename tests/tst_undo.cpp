@@ -0,0 +1,171 @@
+/* -----------------------------------------------------------------------------
+ * The Cyberiada State Machine Editor
+ * -----------------------------------------------------------------------------
+ *
+ * The Undo Stack Test
+ *
+ * Copyright (C) 2024 Alexey Fedoseev <aleksey@fedoseev.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see https://www.gnu.org/licenses/
+ *
+ * ----------------------------------------------------------------------------- */
+
+#include <QtTest>
+
+#include "cyberiadasm_model.h"
+#include "cyberiadasm_undo.h"
+
+#define TEST_EDITS_COUNT 100
+
+class TestUndo: public QObject {
+Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+
+    void mergeDrag();
+    void sealedDrag();
+    void differentElements();
+    void trim();
+    void trimKeepsRedo();
+    void transitionAction();
+
+private:
+    QString title() const { return QString(state->get_name().c_str()); }
+    Cyberiada::Rect rect() const { return state->get_geometry_rect(); }
+
+    CyberiadaSMModel*         model;
+    CyberiadaSMUndoStack*     stack;
+    Cyberiada::StateMachine*  sm;
+    Cyberiada::State*         state;
+    Cyberiada::State*         other;
+};
+
+void TestUndo::init()
+{
+    model = new CyberiadaSMModel(NULL);
+    model->setDocument(new Cyberiada::LocalDocument());
+    sm = model->newStateMachine("SM", Cyberiada::Rect(0, 0, 400, 300));
+    state = model->newState(sm, "State", Cyberiada::Action(), Cyberiada::Rect(10, 10, 100, 50));
+    other = model->newState(sm, "Other", Cyberiada::Action(), Cyberiada::Rect(200, 10, 100, 50));
+    stack = model->undoStack();
+    stack->reset();
+}
+
+void TestUndo::cleanup()
+{
+    delete model;
+    model = NULL;
+}
+
+void TestUndo::mergeDrag()
+{
+    QModelIndex index = model->elementToIndex(state);
+    for (int i = 1; i <= 10; i++) {
+        QVERIFY(model->updateGeometry(index, Cyberiada::Rect(10 + i, 10, 100, 50)));
+    }
+    // the drag is one step of the history
+    QCOMPARE(stack->count(), 1);
+    QCOMPARE(double(rect().x), 20.0);
+    stack->undo();
+    QCOMPARE(double(rect().x), 10.0);
+    stack->redo();
+    QCOMPARE(double(rect().x), 20.0);
+}
+
+void TestUndo::sealedDrag()
+{
+    QModelIndex index = model->elementToIndex(state);
+    QVERIFY(model->updateGeometry(index, Cyberiada::Rect(20, 10, 100, 50)));
+    QVERIFY(model->updateGeometry(index, Cyberiada::Rect(30, 10, 100, 50)));
+    stack->seal();
+    QVERIFY(model->updateGeometry(index, Cyberiada::Rect(40, 10, 100, 50)));
+    QCOMPARE(stack->count(), 2);
+    stack->undo();
+    QCOMPARE(double(rect().x), 30.0);
+    stack->undo();
+    QCOMPARE(double(rect().x), 10.0);
+}
+
+void TestUndo::differentElements()
+{
+    QVERIFY(model->updateGeometry(model->elementToIndex(state), Cyberiada::Rect(20, 10, 100, 50)));
+    QVERIFY(model->updateGeometry(model->elementToIndex(other), Cyberiada::Rect(210, 10, 100, 50)));
+    // the title is not a geometry edit and is never merged
+    QVERIFY(model->updateTitle(model->elementToIndex(state), "First"));
+    QVERIFY(model->updateTitle(model->elementToIndex(state), "Second"));
+    QCOMPARE(stack->count(), 4);
+}
+
+void TestUndo::trim()
+{
+    stack->setMemoryLimit(4096);
+    QModelIndex index = model->elementToIndex(state);
+    for (int i = 0; i < TEST_EDITS_COUNT; i++) {
+        QVERIFY(model->updateTitle(index, QString("Title %1").arg(i)));
+        QVERIFY(stack->memoryUsage() <= stack->memoryLimit());
+    }
+    int kept = stack->count();
+    QVERIFY(kept > 1);
+    QVERIFY(kept < TEST_EDITS_COUNT);
+    QCOMPARE(stack->index(), kept);
+    // every step left in the history changes the model
+    for (int i = 0; i < kept; i++) {
+        QVERIFY(stack->canUndo());
+        QString before = title();
+        stack->undo();
+        QVERIFY(title() != before);
+    }
+    QVERIFY(!stack->canUndo());
+    QCOMPARE(title(), QString("Title %1").arg(TEST_EDITS_COUNT - kept - 1));
+}
+
+void TestUndo::trimKeepsRedo()
+{
+    QModelIndex index = model->elementToIndex(state);
+    for (int i = 0; i < TEST_EDITS_COUNT; i++) {
+        QVERIFY(model->updateTitle(index, QString("Title %1").arg(i)));
+    }
+    for (int i = 0; i < 5; i++) {
+        stack->undo();
+    }
+    stack->setMemoryLimit(4096);
+    QVERIFY(stack->count() < TEST_EDITS_COUNT);
+    QCOMPARE(stack->count() - stack->index(), 5);
+    QCOMPARE(title(), QString("Title %1").arg(TEST_EDITS_COUNT - 6));
+    while (stack->canRedo()) {
+        stack->redo();
+    }
+    QCOMPARE(title(), QString("Title %1").arg(TEST_EDITS_COUNT - 1));
+}
+
+void TestUndo::transitionAction()
+{
+    Cyberiada::Transition* transition = model->newTransition(sm, Cyberiada::transitionExternal, state, other,
+                                                             Cyberiada::Action("", "", "x = 1"));
+    stack->reset();
+    QModelIndex index = model->elementToIndex(transition);
+    QVERIFY(model->updateAction(index, -1, "tick", "", "x = 2"));
+    QCOMPARE(QString(transition->get_action().get_trigger().c_str()), QString("tick"));
+    // the action without the trigger is restored as it was
+    stack->undo();
+    QCOMPARE(QString(transition->get_action().get_trigger().c_str()), QString());
+    QCOMPARE(QString(transition->get_action().get_behavior().c_str()), QString("x = 1"));
+    stack->redo();
+    QCOMPARE(QString(transition->get_action().get_behavior().c_str()), QString("x = 2"));
+}
+
+QTEST_MAIN(TestUndo)
+#include "tst_undo.moc"